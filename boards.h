@@ -0,0 +1,145 @@
+/*
+MIT No Attribution
+
+Copyright 2022 Thomas Dettbarn (dettus@dettus.net)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this
+software and associated documentation files (the "Software"), to deal in the Software
+without restriction, including without limitation the rights to use, copy, modify,
+merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+// the pin maps of the development boards, shared by all the programs.
+// include it before the PIN_ definitions, which look into physicalmapping.
+#ifndef	BOARDS_H
+#define	BOARDS_H
+
+// the boards this runs on. a board is the GPIO number behind each pin of
+// its header, -1 for power and ground. one of them can be chosen at compile
+// time (lines 21-26 of each program), or when starting the program with -w.
+#define	BOARD_JETSONNANO	0
+#define	BOARD_BANANAPI		1
+#define	BOARD_RASPBERRYPI	2
+#define	BOARD_NUM		3
+typedef struct _tBoard
+{
+	const char* name;
+	short physicalmapping[41];
+} tBoard;
+static const tBoard boards[BOARD_NUM]={
+	// Jetson Nano
+	// source: https://maker.pro/nvidia-jetson/tutorial/how-to-use-gpio-pins-on-jetson-nano-developer-kit
+	{"jetsonnano",{
+		0,	// placeholder. there is no PIN0
+		 -1, -1,// PIN1 =3.3V DC, PIN2 =5V DC
+		 -1, -1,// 3,4
+		 -1, -1,// 5,6
+		216, -1, //PIN7 = AUDIO_MCLK
+		 -1, -1, //9,10
+		 50, 79, //PIN11=UART_2_RTS,PIN12=I2S_4_CLK
+		 14, -1, //13,14
+		194,232, //15,16
+		 -1, 15, //17,18
+		 16, -1, //19,20
+		 17, 13, //21,22
+		 18, 19, //23,24
+		 -1, 20, //25,26
+		 -1, -1, //27,28
+		149, -1, //29,30
+		200,168, //31,32
+		 38, -1, //33,34
+		 76, 51, //35,36
+		 12, 77, //37,38
+		 -1, 78  //39,40
+	}},
+	// source: https://wiki.fw-web.de/doku.php?id=en:bpi-r64:gpio
+	{"bananapi",{
+		0,	// placeholder. there is no PIN0
+		 -1, -1,// PIN1 =3.3V DC, PIN2 =5V DC
+		 56, -1,// 3,4
+		 55, -1,// 5,6
+		101, 59, //PIN7 = PWM7,8
+		 -1, 60,// 9,10
+		 51, -1, //PIN11=UART_2_RTS,PIN12=I2S_4_CLK
+		 52, -1, //13,14
+		 98, 61, //15,16
+		 -1, 62, //17,18
+		 68, -1, //19,20
+		 69, 63, //21,22
+		 67, 70, //23,24
+		 -1, 66, //25,26
+		 58, 57, //27,28
+		 85, -1, //29,30
+		 82, 64, //31,32
+		 -1, -1, //33,34
+		 -1, 65, //35,36
+		 86, -1, //37,38
+		 -1, -1  //39,40
+	}},
+	// source: https://www.theengineeringprojects.com/wp-content/uploads/2021/03/raspberry-pi-zero-5.png
+	// NOTE: GPIO16 was actually missing in the diagram.
+	{"raspberrypi",{
+		0,	// placeholder. there is no PIN0
+		 -1, -1,// PIN1 =3.3V DC, PIN2 =5V DC
+		  2, -1,// 3,4
+		  3, -1,// 5,6
+		  4, 14, //PIN7 = PWM7,8
+		 -1, 15,// 9,10
+		 17, 18, //PIN11=UART_2_RTS,PIN12=I2S_4_CLK
+		 27, -1, //13,14
+		 22, 23, //15,16
+		 -1, 24, //17,18
+		 10, -1, //19,20
+		  9, 25, //21,22
+		 11,  8, //23,24
+		 -1,  7, //25,26
+		  0,  1, //27,28
+		  5, -1, //29,30
+		  6, 12, //31,32
+		 13, -1, //33,34
+		 19, 16, //35,36	
+		 26, 20, //37,38
+		 -1, 21  //39,40
+	}}
+};
+#if defined(PINOUT_JETSONNANO)
+#warning "This mapping is for the Jetson Nano board."
+#define	BOARD_DEFAULT	BOARD_JETSONNANO
+#elif defined(PINOUT_BANANAPI)
+#warning "This mapping is for the Banana Pi board."
+#define	BOARD_DEFAULT	BOARD_BANANAPI
+#elif defined(PINOUT_RASPBERRYPI) 
+#warning "This mapping is for the Raspberry Pi (Zero) board"
+#define	BOARD_DEFAULT	BOARD_RASPBERRYPI
+#else
+#define	BOARD_DEFAULT	-1	// has to be chosen with -w
+#endif
+#define	BOARD_BENCH	BOARD_RASPBERRYPI	// for the modes without the display, when there is no board
+#define	BOARD_NAMES	"jetsonnano, bananapi or raspberrypi"
+// the message when there is no board. the option is the one which chooses it
+#define	BOARD_MISSING	"The physical pins need to be mapped to the GPIO numbers. For some reason, those numbers are different for each board out there. So please choose one with %s " BOARD_NAMES ", or have a look at the sourcecode, lines 21-26.\n"
+static const short* physicalmapping=NULL;	// of the chosen board
+
+// chooses the board by its name. returns its number, or -1 when there is no board with this name
+static int board_select(const char* name)
+{
+	int i;
+	for (i=0;i<BOARD_NUM;i++)
+	{
+		if (strcmp(name,boards[i].name)==0)
+		{
+			physicalmapping=boards[i].physicalmapping;
+			return i;
+		}
+	}
+	return -1;
+}
+#endif
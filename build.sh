@@ -19,6 +19,10 @@
 gcc -O3 -o oledtest.app oledtest.c
 gcc -O3 -o keytest.app keytest.c
 gcc -O3 -o texttest.app texttest.c
+gcc -O3 -o oledd.app oledd.c
+gcc -O3 -o oledclient.app oledclient.c
+gcc -O3 -o fontc.app fontc.c
 echo "please run them as root (Or use sudo)"
-ls -l oledtest.app keytest.app texttest.app
+echo "(except for oledclient.app, this one only needs oledd.app to be running)"
+ls -l oledtest.app keytest.app texttest.app oledd.app oledclient.app fontc.app
 
@@ -0,0 +1,356 @@
+/*
+MIT No Attribution
+
+Copyright 2022 Thomas Dettbarn (dettus@dettus.net)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this
+software and associated documentation files (the "Software"), to deal in the Software
+without restriction, including without limitation the rights to use, copy, modify,
+merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+
+// the font compiler. it reads a BDF or a PSF font, and writes a C header with
+// the glyphs in the page format of the display: one byte is a column of 8
+// pixels, bit 0 on top. a font which is higher than 8 pixels covers several
+// pages, and every glyph is stored one page after the other. this way, a
+// renderer only has to copy bytes. (see font_txn() and font_blit() in texttest.c)
+//
+// ./fontc.app -n segment24 fonts/segment24.bdf > fonts/segment24.h
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#define	RETVAL_OK	0
+#define	RETVAL_NOK	-1
+
+#define	FONT_MAXHEIGHT	64	// 8 pages
+#define	FONT_MAXWIDTH	64
+#define	FONT_MAXCHARS	256
+#define	PSF_MAXGLYPHS	65536	// more than that is a broken header, not a font
+#define	MAXLINELEN	1024
+
+// a glyph while it is being compiled: one byte per pixel, in a cell of the full font height
+typedef struct _tCell
+{
+	int defined;
+	int width;
+	unsigned char pixels[FONT_MAXHEIGHT][FONT_MAXWIDTH];
+} tCell;
+
+typedef struct _tFontSource
+{
+	int height;
+	tCell cells[FONT_MAXCHARS];
+} tFontSource;
+
+int hexdigit(int c)
+{
+	if (c>='0' && c<='9') return c-'0';
+	if (c>='a' && c<='f') return c-'a'+10;
+	if (c>='A' && c<='F') return c-'A'+10;
+	return -1;
+}
+
+// BDF is text. the glyph bitmaps are rows of hex digits, placed relative to the baseline with BBX.
+int bdf_load(tFontSource* font,FILE* f)
+{
+	char line[MAXLINELEN];
+	int ascent,descent;
+	int encoding;
+	int dwidth;
+	int bbw,bbh,bbx,bby;
+	int row;
+	int inbitmap;
+
+	ascent=descent=-1;
+	encoding=-1;
+	dwidth=0;
+	bbw=bbh=bbx=bby=0;
+	row=0;
+	inbitmap=0;
+	while (fgets(line,sizeof(line),f)!=NULL)
+	{
+		if (inbitmap)
+		{
+			if (strncmp(line,"ENDCHAR",7)==0)
+			{
+				inbitmap=0;
+				continue;
+			}
+			if (encoding>=0 && encoding<FONT_MAXCHARS)
+			{
+				tCell* cell;
+				int y;
+				int x;
+				cell=&font->cells[encoding];
+				y=ascent-(bby+bbh)+row;
+				for (x=0;x<bbw;x++)
+				{
+					int nibble;
+					int cx;
+					nibble=hexdigit(line[x/4]);
+					cx=bbx+x;
+					if (nibble<0) break;
+					if (y>=0 && y<font->height && cx>=0 && cx<cell->width && (nibble&(8>>(x%4))))
+					{
+						cell->pixels[y][cx]=1;
+					}
+				}
+			}
+			row++;
+		}
+		else if (strncmp(line,"FONTBOUNDINGBOX ",16)==0)
+		{
+			int w,h,x,y;
+			if (sscanf(line+16,"%d %d %d %d",&w,&h,&x,&y)==4 && ascent<0)
+			{
+				// until FONT_ASCENT and FONT_DESCENT say otherwise
+				ascent=h+y;
+				descent=-y;
+			}
+		}
+		else if (strncmp(line,"FONT_ASCENT ",12)==0) ascent=atoi(line+12);
+		else if (strncmp(line,"FONT_DESCENT ",13)==0) descent=atoi(line+13);
+		else if (strncmp(line,"STARTCHAR",9)==0)
+		{
+			encoding=-1;
+			dwidth=0;
+			bbw=bbh=bbx=bby=0;
+		}
+		else if (strncmp(line,"ENCODING ",9)==0) encoding=atoi(line+9);
+		else if (strncmp(line,"DWIDTH ",7)==0) dwidth=atoi(line+7);
+		else if (strncmp(line,"BBX ",4)==0) sscanf(line+4,"%d %d %d %d",&bbw,&bbh,&bbx,&bby);
+		else if (strncmp(line,"BITMAP",6)==0)
+		{
+			if (ascent<0 || descent<0)
+			{
+				fprintf(stderr,"the font has no ascent and descent\n");
+				return RETVAL_NOK;
+			}
+			font->height=ascent+descent;
+			if (font->height>FONT_MAXHEIGHT)
+			{
+				fprintf(stderr,"the font is %d pixels high. the maximum is %d\n",font->height,FONT_MAXHEIGHT);
+				return RETVAL_NOK;
+			}
+			if (dwidth==0) dwidth=bbx+bbw;
+			if (dwidth>FONT_MAXWIDTH) dwidth=FONT_MAXWIDTH;
+			if (encoding>=0 && encoding<FONT_MAXCHARS)
+			{
+				font->cells[encoding].defined=1;
+				font->cells[encoding].width=dwidth;
+			}
+			row=0;
+			inbitmap=1;
+		}
+	}
+	return (font->height>0)?RETVAL_OK:RETVAL_NOK;
+}
+
+// PSF is what the linux console uses. version 1 is always 8 pixels wide,
+// version 2 has a header with the size. glyph n is character n.
+int psf_load(tFontSource* font,FILE* f)
+{
+	unsigned char header[32];
+	unsigned char glyph[FONT_MAXHEIGHT*FONT_MAXWIDTH/8];
+	int glyphs;
+	int width,height;
+	int rowbytes;
+	int i;
+
+	if (fread(header,1,4,f)!=4) return RETVAL_NOK;
+	if (header[0]==0x36 && header[1]==0x04)
+	{
+		glyphs=(header[2]&1)?512:256;
+		width=8;
+		height=header[3];
+	}
+	else if (header[0]==0x72 && header[1]==0xb5 && header[2]==0x4a && header[3]==0x86)
+	{
+		unsigned int headersize;
+		unsigned int n,w,h;
+		if (fread(&header[4],1,28,f)!=28) return RETVAL_NOK;
+		#define	LE32(p)	((unsigned int)(p)[0]|((unsigned int)(p)[1]<<8)|((unsigned int)(p)[2]<<16)|((unsigned int)(p)[3]<<24))
+		headersize=LE32(&header[8]);
+		n=LE32(&header[16]);
+		h=LE32(&header[24]);
+		w=LE32(&header[28]);
+		// the sizes are checked while they are still unsigned
+		if (headersize<32 || n<1 || n>PSF_MAXGLYPHS || h<1 || h>FONT_MAXHEIGHT || w<1 || w>FONT_MAXWIDTH)
+		{
+			fprintf(stderr,"the PSF2 header is broken, or the font is larger than %dx%d\n",FONT_MAXWIDTH,FONT_MAXHEIGHT);
+			return RETVAL_NOK;
+		}
+		glyphs=n;
+		height=h;
+		width=w;
+		if (headersize>32) fseek(f,headersize,SEEK_SET);
+	} else {
+		return RETVAL_NOK;
+	}
+	if (height<1 || height>FONT_MAXHEIGHT || width>FONT_MAXWIDTH)
+	{
+		fprintf(stderr,"the font is %dx%d pixels. the maximum is %dx%d\n",width,height,FONT_MAXWIDTH,FONT_MAXHEIGHT);
+		return RETVAL_NOK;
+	}
+	font->height=height;
+	rowbytes=(width+7)/8;
+	for (i=0;i<glyphs;i++)
+	{
+		int x,y;
+		if (fread(glyph,rowbytes,height,f)!=height) return RETVAL_NOK;
+		if (i>=FONT_MAXCHARS) continue;
+		font->cells[i].defined=1;
+		font->cells[i].width=width;
+		for (y=0;y<height;y++)
+		{
+			for (x=0;x<width;x++)
+			{
+				font->cells[i].pixels[y][x]=(glyph[y*rowbytes+x/8]>>(7-(x%8)))&1;
+			}
+		}
+	}
+	return RETVAL_OK;
+}
+
+// characters which are not in the font get the glyph of the fallback, or nothing.
+void font_write(tFontSource* font,const char* name,const char* source,int first,int last,int fallback)
+{
+	int pages;
+	int offset;
+	int c;
+	int n;
+
+	pages=(font->height+7)/8;
+	printf("// generated by fontc from %s. do not edit.\n",source);
+	printf("// %d pixels high, %d pages, characters %d..%d\n",font->height,pages,first,last);
+	printf("#ifndef	FONT_TYPES\n");
+	printf("#define	FONT_TYPES\n");
+	printf("typedef struct _tGlyph\n{\n\tunsigned int offset;\t// into the bitmaps: the first page, then the second...\n\tunsigned char width;\n} tGlyph;\n");
+	printf("typedef struct _tFont\n{\n\tint height;\n\tint pages;\n\tint first;\n\tint last;\n\tconst tGlyph* glyphs;\n\tconst unsigned char* bitmaps;\n} tFont;\n");
+	printf("#endif\n\n");
+
+	printf("static const unsigned char %s_bitmaps[]={",name);
+	n=0;
+	for (c=first;c<=last;c++)
+	{
+		tCell* cell;
+		int page;
+		int x;
+		cell=&font->cells[font->cells[c].defined?c:fallback];
+		if (!cell->defined) continue;
+		printf("\n\t// %d",c);
+		if (c>32 && c<127) printf(" '%c'",c);
+		for (page=0;page<pages;page++)
+		{
+			printf("\n\t");
+			for (x=0;x<cell->width;x++)
+			{
+				unsigned char byte;
+				int j;
+				byte=0;
+				for (j=0;j<8 && page*8+j<font->height;j++)
+				{
+					if (cell->pixels[page*8+j][x]) byte|=(1<<j);
+				}
+				printf("0x%02x,",byte);
+				n++;
+			}
+		}
+	}
+	if (n==0) printf("0");
+	printf("\n};\n");
+
+	printf("static const tGlyph %s_glyphs[]={\n",name);
+	offset=0;
+	for (c=first;c<=last;c++)
+	{
+		tCell* cell;
+		cell=&font->cells[font->cells[c].defined?c:fallback];
+		if (!cell->defined)
+		{
+			printf("\t{%5d,%2d},\n",offset,0);
+			continue;
+		}
+		printf("\t{%5d,%2d},",offset,cell->width);
+		if (c>32 && c<127) printf("\t// '%c'",c);
+		printf("\n");
+		offset+=cell->width*pages;
+	}
+	printf("};\n");
+	printf("static const tFont %s={%d,%d,%d,%d,%s_glyphs,%s_bitmaps};\n",name,font->height,pages,first,last,name,name);
+}
+
+int main(int argc,char** argv)
+{
+	static tFontSource font;
+	const char* name;
+	const char* source;
+	int first,last;
+	int fallback;
+	int opt;
+	FILE* f;
+
+	name="font";
+	first=32;
+	last=126;
+	fallback='?';
+	while ((opt=getopt(argc,argv,"n:r:"))!=-1)
+	{
+		switch (opt)
+		{
+			case 'n':	name=optarg;break;
+			case 'r':
+				if (sscanf(optarg,"%d-%d",&first,&last)!=2 || first<0 || last>=FONT_MAXCHARS || first>last)
+				{
+					fprintf(stderr,"the range has to be first-last, within 0-%d\n",FONT_MAXCHARS-1);
+					return 1;
+				}
+				break;
+			default:
+				fprintf(stderr,"usage: %s [-n name] [-r first-last] font.bdf|font.psf > font.h\n",argv[0]);
+				fprintf(stderr,"  -n name        name of the font in the header (default font)\n");
+				fprintf(stderr,"  -r first-last  range of characters (default 32-126)\n");
+				return 1;
+		}
+	}
+	if (optind>=argc)
+	{
+		fprintf(stderr,"please tell me which font to compile\n");
+		return 1;
+	}
+	source=argv[optind];
+	f=fopen(source,"rb");
+	if (f==NULL)
+	{
+		fprintf(stderr,"unable to open %s\n",source);
+		return 1;
+	}
+	if (psf_load(&font,f)!=RETVAL_OK)
+	{
+		memset(&font,0,sizeof(font));
+		rewind(f);
+		if (bdf_load(&font,f)!=RETVAL_OK)
+		{
+			fprintf(stderr,"%s is neither a PSF nor a BDF font\n",source);
+			fclose(f);
+			return 1;
+		}
+	}
+	fclose(f);
+	if (strrchr(source,'/')!=NULL) source=strrchr(source,'/')+1;
+	font_write(&font,name,source,first,last,fallback);
+	return 0;
+}
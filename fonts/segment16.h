@@ -0,0 +1,94 @@
+// generated by fontc from segment16.bdf. do not edit.
+// 16 pixels high, 2 pages, characters 32..58
+#ifndef	FONT_TYPES
+#define	FONT_TYPES
+typedef struct _tGlyph
+{
+	unsigned int offset;	// into the bitmaps: the first page, then the second...
+	unsigned char width;
+} tGlyph;
+typedef struct _tFont
+{
+	int height;
+	int pages;
+	int first;
+	int last;
+	const tGlyph* glyphs;
+	const unsigned char* bitmaps;
+} tFont;
+#endif
+
+static const unsigned char segment16_bitmaps[]={
+	// 32
+	0x00,0x00,0x00,0x00,0x00,0x00,
+	0x00,0x00,0x00,0x00,0x00,0x00,
+	// 45 '-'
+	0x00,0x80,0x80,0x80,0x80,0x80,0x80,0x80,0x00,0x00,0x00,
+	0x00,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x00,0x00,0x00,
+	// 46 '.'
+	0x00,0x00,0x00,0x00,
+	0xc0,0xc0,0x00,0x00,
+	// 48 '0'
+	0x7e,0x7f,0x03,0x03,0x03,0x03,0x03,0x7f,0x7e,0x00,0x00,
+	0x7e,0xfe,0xc0,0xc0,0xc0,0xc0,0xc0,0xfe,0x7e,0x00,0x00,
+	// 49 '1'
+	0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x7e,0x7e,0x00,0x00,
+	0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x7e,0x7e,0x00,0x00,
+	// 50 '2'
+	0x00,0x83,0x83,0x83,0x83,0x83,0x83,0xff,0x7e,0x00,0x00,
+	0x7e,0xff,0xc1,0xc1,0xc1,0xc1,0xc1,0xc1,0x00,0x00,0x00,
+	// 51 '3'
+	0x00,0x83,0x83,0x83,0x83,0x83,0x83,0xff,0x7e,0x00,0x00,
+	0x00,0xc1,0xc1,0xc1,0xc1,0xc1,0xc1,0xff,0x7e,0x00,0x00,
+	// 52 '4'
+	0x7e,0xfe,0x80,0x80,0x80,0x80,0x80,0xfe,0x7e,0x00,0x00,
+	0x00,0x01,0x01,0x01,0x01,0x01,0x01,0x7f,0x7e,0x00,0x00,
+	// 53 '5'
+	0x7e,0xff,0x83,0x83,0x83,0x83,0x83,0x83,0x00,0x00,0x00,
+	0x00,0xc1,0xc1,0xc1,0xc1,0xc1,0xc1,0xff,0x7e,0x00,0x00,
+	// 54 '6'
+	0x7e,0xff,0x83,0x83,0x83,0x83,0x83,0x83,0x00,0x00,0x00,
+	0x7e,0xff,0xc1,0xc1,0xc1,0xc1,0xc1,0xff,0x7e,0x00,0x00,
+	// 55 '7'
+	0x00,0x03,0x03,0x03,0x03,0x03,0x03,0x7f,0x7e,0x00,0x00,
+	0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x7e,0x7e,0x00,0x00,
+	// 56 '8'
+	0x7e,0xff,0x83,0x83,0x83,0x83,0x83,0xff,0x7e,0x00,0x00,
+	0x7e,0xff,0xc1,0xc1,0xc1,0xc1,0xc1,0xff,0x7e,0x00,0x00,
+	// 57 '9'
+	0x7e,0xff,0x83,0x83,0x83,0x83,0x83,0xff,0x7e,0x00,0x00,
+	0x00,0xc1,0xc1,0xc1,0xc1,0xc1,0xc1,0xff,0x7e,0x00,0x00,
+	// 58 ':'
+	0x30,0x30,0x00,0x00,
+	0x06,0x06,0x00,0x00,
+};
+static const tGlyph segment16_glyphs[]={
+	{    0, 6},
+	{   12, 0},
+	{   12, 0},
+	{   12, 0},
+	{   12, 0},
+	{   12, 0},
+	{   12, 0},
+	{   12, 0},
+	{   12, 0},
+	{   12, 0},
+	{   12, 0},
+	{   12, 0},
+	{   12, 0},
+	{   12,11},	// '-'
+	{   34, 4},	// '.'
+	{   42, 0},
+	{   42,11},	// '0'
+	{   64,11},	// '1'
+	{   86,11},	// '2'
+	{  108,11},	// '3'
+	{  130,11},	// '4'
+	{  152,11},	// '5'
+	{  174,11},	// '6'
+	{  196,11},	// '7'
+	{  218,11},	// '8'
+	{  240,11},	// '9'
+	{  262, 4},	// ':'
+};
+static const tFont segment16={16,2,32,58,segment16_glyphs,segment16_bitmaps};
@@ -0,0 +1,108 @@
+// generated by fontc from segment24.bdf. do not edit.
+// 24 pixels high, 3 pages, characters 32..58
+#ifndef	FONT_TYPES
+#define	FONT_TYPES
+typedef struct _tGlyph
+{
+	unsigned int offset;	// into the bitmaps: the first page, then the second...
+	unsigned char width;
+} tGlyph;
+typedef struct _tFont
+{
+	int height;
+	int pages;
+	int first;
+	int last;
+	const tGlyph* glyphs;
+	const unsigned char* bitmaps;
+} tFont;
+#endif
+
+static const unsigned char segment24_bitmaps[]={
+	// 32
+	0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+	0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+	0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+	// 45 '-'
+	0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+	0x00,0x38,0x38,0x38,0x38,0x38,0x38,0x38,0x38,0x38,0x38,0x38,0x00,0x00,0x00,0x00,
+	0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+	// 46 '.'
+	0x00,0x00,0x00,0x00,0x00,0x00,
+	0x00,0x00,0x00,0x00,0x00,0x00,
+	0xe0,0xe0,0xe0,0x00,0x00,0x00,
+	// 48 '0'
+	0xfe,0xff,0xff,0x07,0x07,0x07,0x07,0x07,0x07,0x07,0xff,0xff,0xfe,0x00,0x00,0x00,
+	0xc7,0xc7,0xc7,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0xc7,0xc7,0xc7,0x00,0x00,0x00,
+	0x7f,0xff,0xff,0xe0,0xe0,0xe0,0xe0,0xe0,0xe0,0xe0,0xff,0xff,0x7f,0x00,0x00,0x00,
+	// 49 '1'
+	0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0xfe,0xfe,0xfe,0x00,0x00,0x00,
+	0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0xc7,0xc7,0xc7,0x00,0x00,0x00,
+	0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x7f,0x7f,0x7f,0x00,0x00,0x00,
+	// 50 '2'
+	0x00,0x07,0x07,0x07,0x07,0x07,0x07,0x07,0x07,0x07,0xff,0xff,0xfe,0x00,0x00,0x00,
+	0xc0,0xf8,0xf8,0x38,0x38,0x38,0x38,0x38,0x38,0x38,0x3f,0x3f,0x07,0x00,0x00,0x00,
+	0x7f,0xff,0xff,0xe0,0xe0,0xe0,0xe0,0xe0,0xe0,0xe0,0xe0,0xe0,0x00,0x00,0x00,0x00,
+	// 51 '3'
+	0x00,0x07,0x07,0x07,0x07,0x07,0x07,0x07,0x07,0x07,0xff,0xff,0xfe,0x00,0x00,0x00,
+	0x00,0x38,0x38,0x38,0x38,0x38,0x38,0x38,0x38,0x38,0xff,0xff,0xc7,0x00,0x00,0x00,
+	0x00,0xe0,0xe0,0xe0,0xe0,0xe0,0xe0,0xe0,0xe0,0xe0,0xff,0xff,0x7f,0x00,0x00,0x00,
+	// 52 '4'
+	0xfe,0xfe,0xfe,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0xfe,0xfe,0xfe,0x00,0x00,0x00,
+	0x07,0x3f,0x3f,0x38,0x38,0x38,0x38,0x38,0x38,0x38,0xff,0xff,0xc7,0x00,0x00,0x00,
+	0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x7f,0x7f,0x7f,0x00,0x00,0x00,
+	// 53 '5'
+	0xfe,0xff,0xff,0x07,0x07,0x07,0x07,0x07,0x07,0x07,0x07,0x07,0x00,0x00,0x00,0x00,
+	0x07,0x3f,0x3f,0x38,0x38,0x38,0x38,0x38,0x38,0x38,0xf8,0xf8,0xc0,0x00,0x00,0x00,
+	0x00,0xe0,0xe0,0xe0,0xe0,0xe0,0xe0,0xe0,0xe0,0xe0,0xff,0xff,0x7f,0x00,0x00,0x00,
+	// 54 '6'
+	0xfe,0xff,0xff,0x07,0x07,0x07,0x07,0x07,0x07,0x07,0x07,0x07,0x00,0x00,0x00,0x00,
+	0xc7,0xff,0xff,0x38,0x38,0x38,0x38,0x38,0x38,0x38,0xf8,0xf8,0xc0,0x00,0x00,0x00,
+	0x7f,0xff,0xff,0xe0,0xe0,0xe0,0xe0,0xe0,0xe0,0xe0,0xff,0xff,0x7f,0x00,0x00,0x00,
+	// 55 '7'
+	0x00,0x07,0x07,0x07,0x07,0x07,0x07,0x07,0x07,0x07,0xff,0xff,0xfe,0x00,0x00,0x00,
+	0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0xc7,0xc7,0xc7,0x00,0x00,0x00,
+	0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x7f,0x7f,0x7f,0x00,0x00,0x00,
+	// 56 '8'
+	0xfe,0xff,0xff,0x07,0x07,0x07,0x07,0x07,0x07,0x07,0xff,0xff,0xfe,0x00,0x00,0x00,
+	0xc7,0xff,0xff,0x38,0x38,0x38,0x38,0x38,0x38,0x38,0xff,0xff,0xc7,0x00,0x00,0x00,
+	0x7f,0xff,0xff,0xe0,0xe0,0xe0,0xe0,0xe0,0xe0,0xe0,0xff,0xff,0x7f,0x00,0x00,0x00,
+	// 57 '9'
+	0xfe,0xff,0xff,0x07,0x07,0x07,0x07,0x07,0x07,0x07,0xff,0xff,0xfe,0x00,0x00,0x00,
+	0x07,0x3f,0x3f,0x38,0x38,0x38,0x38,0x38,0x38,0x38,0xff,0xff,0xc7,0x00,0x00,0x00,
+	0x00,0xe0,0xe0,0xe0,0xe0,0xe0,0xe0,0xe0,0xe0,0xe0,0xff,0xff,0x7f,0x00,0x00,0x00,
+	// 58 ':'
+	0x80,0x80,0x80,0x00,0x00,0x00,
+	0x83,0x83,0x83,0x00,0x00,0x00,
+	0x03,0x03,0x03,0x00,0x00,0x00,
+};
+static const tGlyph segment24_glyphs[]={
+	{    0, 9},
+	{   27, 0},
+	{   27, 0},
+	{   27, 0},
+	{   27, 0},
+	{   27, 0},
+	{   27, 0},
+	{   27, 0},
+	{   27, 0},
+	{   27, 0},
+	{   27, 0},
+	{   27, 0},
+	{   27, 0},
+	{   27,16},	// '-'
+	{   75, 6},	// '.'
+	{   93, 0},
+	{   93,16},	// '0'
+	{  141,16},	// '1'
+	{  189,16},	// '2'
+	{  237,16},	// '3'
+	{  285,16},	// '4'
+	{  333,16},	// '5'
+	{  381,16},	// '6'
+	{  429,16},	// '7'
+	{  477,16},	// '8'
+	{  525,16},	// '9'
+	{  573, 6},	// ':'
+};
+static const tFont segment24={24,3,32,58,segment24_glyphs,segment24_bitmaps};
@@ -32,6 +32,11 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <unistd.h>
 #include <sys/types.h>
 #include <fcntl.h>
+#include <string.h>
+#include <time.h>
+#include <dirent.h>
+#include <sys/ioctl.h>
+#include <linux/gpio.h>
 
 #define	RETVAL_OK	0
 #define	RETVAL_NOK	-1
@@ -51,100 +56,31 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #define	SPI_LSBFIRST	0
 #define	SPI_MSBFIRST	1
-#define SPI_DELAY	//DELAY_US(1)
+#define SPI_DELAY	do {} while (0)	//DELAY_US(1)
 
 #define	BITMAP_HEIGHT	64
 #define	BITMAP_WIDTH	128
 
+#define	KEYS_NUM	8
+
+#define	SCAN_CDEV	0	// all the lines of a gpiochip in one ioctl
+#define	SCAN_SYSFS	1	// one pread() per key on the value files, which stay open
+
+#define	SCAN_FAST_US		2000	// scan interval right after a key has changed
+#define	SCAN_IDLE_US		50000	// scan interval when nothing is happening
+#define	SCAN_HOLD_US		1000000	// stay fast for this long after the last change
+#define	SCAN_REPORT_SECONDS	10
+
+#define	KEYTRACE_MAGIC		"OKT1"
+#define	KEYTRACE_HEADER		8	// magic, the levels of the keys at the start, 3 bytes reserved
+#define	KEYTRACE_RECORD		6	// microseconds since the previous record (32 bit LE), key, level
+
 //// depends on the development board
 
 // the way I understand this is, that the physical pins are mapped into
 // the system memory. to accces those, there is some sort of memory
 // offset maybe
-#if defined(PINOUT_JETSONNANO)
-#warning "This mapping is for the Jetson Nano board."
-// Jetson Nano
-// source: https://maker.pro/nvidia-jetson/tutorial/how-to-use-gpio-pins-on-jetson-nano-developer-kit
-const short physicalmapping[41]={
-	0,	// placeholder. there is no PIN0
-	 -1, -1,// PIN1 =3.3V DC, PIN2 =5V DC
-	 -1, -1,// 3,4
-	 -1, -1,// 5,6
-	216, -1, //PIN7 = AUDIO_MCLK
-	 -1, -1, //9,10
-	 50, 79, //PIN11=UART_2_RTS,PIN12=I2S_4_CLK
-	 14, -1, //13,14
-	194,232, //15,16
-	 -1, 15, //17,18
-	 16, -1, //19,20
-	 17, 13, //21,22
-	 18, 19, //23,24
-	 -1, 20, //25,26
-	 -1, -1, //27,28
-	149, -1, //29,30
-	200,168, //31,32
-	 38, -1, //33,34
-	 76, 51, //35,36
-	 12, 77, //37,38
-	 -1, 78  //39,40
-};
-#elif defined(PINOUT_BANANAPI)
-#warning "This mapping is for the Banana Pi board."
-// source: https://wiki.fw-web.de/doku.php?id=en:bpi-r64:gpio
-const short physicalmapping[41]={
-	0,	// placeholder. there is no PIN0
-	 -1, -1,// PIN1 =3.3V DC, PIN2 =5V DC
-	 56, -1,// 3,4
-	 55, -1,// 5,6
-	101, 59, //PIN7 = PWM7,8
-	 -1, 60,// 9,10
-	 51, -1, //PIN11=UART_2_RTS,PIN12=I2S_4_CLK
-	 52, -1, //13,14
-	 98, 61, //15,16
-	 -1, 62, //17,18
-	 68, -1, //19,20
-	 69, 63, //21,22
-	 67, 70, //23,24
-	 -1, 66, //25,26
-	 58, 57, //27,28
-	 85, -1, //29,30
-	 82, 64, //31,32
-	 -1, -1, //33,34
-	 -1, 65, //35,36
-	 86, -1, //37,38
-	 -1, -1  //39,40
-};
-#elif defined(PINOUT_RASPBERRYPI) 
-#warning "This mapping is for the Raspberry Pi (Zero) board"
-// source: https://www.theengineeringprojects.com/wp-content/uploads/2021/03/raspberry-pi-zero-5.png
-// NOTE: GPIO16 was actually missing in the diagram.
-const short physicalmapping[41]={
-	0,	// placeholder. there is no PIN0
-	 -1, -1,// PIN1 =3.3V DC, PIN2 =5V DC
-	  2, -1,// 3,4
-	  3, -1,// 5,6
-	  4, 14, //PIN7 = PWM7,8
-	 -1, 15,// 9,10
-	 17, 18, //PIN11=UART_2_RTS,PIN12=I2S_4_CLK
-	 27, -1, //13,14
-	 22, 23, //15,16
-	 -1, 24, //17,18
-	 10, -1, //19,20
-	  9, 25, //21,22
-	 11,  8, //23,24
-	 -1,  7, //25,26
-	  0,  1, //27,28
-	  5, -1, //29,30
-	  6, 12, //31,32
-	 13, -1, //33,34
-	 19, 16, //35,36	
-	 26, 20, //37,38
-	 -1, 21  //39,40
-};
-#else
-#error "The physical pins need to be mapped to the GPIO numbers. For some reason, those numbers are different for each board out there. So please have a look at the sourcecode, lines 21-26, and select the one that works best for you."
-const int physicalmapping[41]={0};
-#endif
+#include "boards.h"
 
 // this is the GPIO pinout for the waveshare OLED 1.3 SH1106 hat
 // source: https://www.waveshare.com/1.3inch-oled-hat.htm
@@ -339,47 +275,415 @@ int gpio_pins_down()
 	return retval;
 }
 
-int sh1106_up()
+double timestamp()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return ts.tv_sec+ts.tv_nsec*1e-9;
+}
+
+int sysfs_readattr(const char* path,char* buffer,int len)
+{
+	int fd;
+	int n;
+	fd=open(path,O_RDONLY);
+	if (fd<0) return RETVAL_NOK;
+	n=read(fd,buffer,len-1);
+	close(fd);
+	if (n<=0) return RETVAL_NOK;
+	buffer[n]=0;
+	if (buffer[n-1]=='\n') buffer[n-1]=0;
+	return RETVAL_OK;
+}
+// the sysfs GPIO numbers are the base of a gpiochip plus the offset of the
+// line. the label of the chip is the same for the character device.
+int gpio_cdev_lookup(int pin,char* label,int labellen,int* offset)
 {
+	DIR* dir;
+	struct dirent* entry;
 	int retval;
-	retval=RETVAL_OK;
-	retval|=gpio_pins_up();
+
+	retval=RETVAL_NOK;
+	dir=opendir("/sys/class/gpio");
+	if (dir==NULL) return RETVAL_NOK;
+	while (retval!=RETVAL_OK && (entry=readdir(dir))!=NULL)
+	{
+		char path[MAXBUFLEN+256];
+		char buffer[MAXBUFLEN];
+		int base;
+		int ngpio;
+		if (strncmp(entry->d_name,"gpiochip",8)!=0) continue;
+		snprintf(path,sizeof(path),"/sys/class/gpio/%s/base",entry->d_name);
+		if (sysfs_readattr(path,buffer,MAXBUFLEN)!=RETVAL_OK) continue;
+		base=atoi(buffer);
+		snprintf(path,sizeof(path),"/sys/class/gpio/%s/ngpio",entry->d_name);
+		if (sysfs_readattr(path,buffer,MAXBUFLEN)!=RETVAL_OK) continue;
+		ngpio=atoi(buffer);
+		if (pin<base || pin>=base+ngpio) continue;
+		snprintf(path,sizeof(path),"/sys/class/gpio/%s/label",entry->d_name);
+		if (sysfs_readattr(path,label,labellen)!=RETVAL_OK) continue;
+		*offset=pin-base;
+		retval=RETVAL_OK;
+	}
+	closedir(dir);
 	return retval;
 }
-int sh1106_down()
+int gpio_cdev_open(const char* label)
+{
+	int i;
+	for (i=0;i<64;i++)
+	{
+		char path[MAXBUFLEN];
+		struct gpiochip_info info;
+		int fd;
+		snprintf(path,MAXBUFLEN,"/dev/gpiochip%d",i);
+		fd=open(path,O_RDONLY|O_CLOEXEC);
+		if (fd<0) continue;
+		if (ioctl(fd,GPIO_GET_CHIPINFO_IOCTL,&info)==0 && strncmp(info.label,label,sizeof(info.label))==0)
+		{
+			return fd;
+		}
+		close(fd);
+	}
+	return -1;
+}
+
+// the key scanner takes a snapshot of all the keys at once. bit i of the
+// packed state is the level of the line of key i. the scan interval is short
+// right after a change, and grows up to the idle interval when nothing happens.
+typedef struct _tKeyScanner
+{
+	int mode;
+	int chips;
+	int linefd[KEYS_NUM];		// SCAN_CDEV: one line handle per gpiochip
+	int lines[KEYS_NUM];
+	int linekey[KEYS_NUM][KEYS_NUM];	// which key is which line of the handle
+	int valuefd[KEYS_NUM];		// SCAN_SYSFS
+	unsigned char keys;
+	double timestamp;		// of the snapshot
+	double changed[KEYS_NUM];	// the last time the key has changed
+	double lastactivity;
+	int fast_us;
+	int idle_us;
+	int interval_us;
+	// statistics
+	unsigned long scans;
+	double scantime;
+	double reporttime;
+} tKeyScanner;
+
+int keyscan_open_cdev(tKeyScanner* scanner,int* pins)
 {
+	char labels[KEYS_NUM][32];
+	struct gpiohandle_request req[KEYS_NUM];
+	int i;
+	int j;
+
+	scanner->chips=0;
+	memset(req,0,sizeof(req));
+	for (i=0;i<KEYS_NUM;i++)
+	{
+		char label[32];
+		int offset;
+		if (gpio_cdev_lookup(pins[i],label,sizeof(label),&offset)!=RETVAL_OK) return RETVAL_NOK;
+		for (j=0;j<scanner->chips;j++)
+		{
+			if (strcmp(labels[j],label)==0) break;
+		}
+		if (j==scanner->chips)
+		{
+			strcpy(labels[j],label);
+			scanner->lines[j]=0;
+			scanner->chips++;
+		}
+		req[j].lineoffsets[scanner->lines[j]]=offset;
+		scanner->linekey[j][scanner->lines[j]]=i;
+		scanner->lines[j]++;
+	}
+	for (j=0;j<scanner->chips;j++)
+	{
+		int fd;
+		fd=gpio_cdev_open(labels[j]);
+		if (fd<0) break;
+		req[j].flags=GPIOHANDLE_REQUEST_INPUT;
+		req[j].lines=scanner->lines[j];
+		snprintf(req[j].consumer_label,sizeof(req[j].consumer_label),"keytest");
+		if (ioctl(fd,GPIO_GET_LINEHANDLE_IOCTL,&req[j])<0)
+		{
+			close(fd);
+			break;
+		}
+		close(fd);
+		scanner->linefd[j]=req[j].fd;
+	}
+	if (j!=scanner->chips)
+	{
+		while (j--) close(scanner->linefd[j]);
+		return RETVAL_NOK;
+	}
+	scanner->mode=SCAN_CDEV;
+	return RETVAL_OK;
+}
+int keyscan_open_sysfs(tKeyScanner* scanner,int* pins)
+{
+	int i;
+	if (gpio_pins_up()!=RETVAL_OK) return RETVAL_NOK;
+	for (i=0;i<KEYS_NUM;i++)
+	{
+		char buffer[MAXBUFLEN];
+		snprintf(buffer,MAXBUFLEN,"/sys/class/gpio/gpio%d/value",pins[i]);
+		scanner->valuefd[i]=open(buffer,O_RDONLY|O_CLOEXEC);
+		if (scanner->valuefd[i]<0)
+		{
+			fprintf(stderr,"Cannot access GPIO pin %d\n",pins[i]);
+			while (i--) close(scanner->valuefd[i]);
+			return RETVAL_NOK;
+		}
+	}
+	scanner->mode=SCAN_SYSFS;
+	return RETVAL_OK;
+}
+int keyscan_snapshot(tKeyScanner* scanner)
+{
+	unsigned char keys;
+	double t0;
+	double t1;
+	int i;
+	int j;
+
+	t0=timestamp();
+	keys=0;
+	if (scanner->mode==SCAN_CDEV)
+	{
+		for (j=0;j<scanner->chips;j++)
+		{
+			struct gpiohandle_data data;
+			if (ioctl(scanner->linefd[j],GPIOHANDLE_GET_LINE_VALUES_IOCTL,&data)<0)
+			{
+				fprintf(stderr,"Unable to read the keys\n");
+				return RETVAL_NOK;
+			}
+			for (i=0;i<scanner->lines[j];i++)
+			{
+				if (data.values[i]) keys|=(1<<scanner->linekey[j][i]);
+			}
+		}
+	} else {
+		for (i=0;i<KEYS_NUM;i++)
+		{
+			char buffer[4];
+			if (pread(scanner->valuefd[i],buffer,sizeof(buffer),0)<=0)
+			{
+				fprintf(stderr,"Unable to read the keys\n");
+				return RETVAL_NOK;
+			}
+			if (buffer[0]=='1') keys|=(1<<i);
+		}
+	}
+	t1=timestamp();
+	scanner->scans++;
+	scanner->scantime+=t1-t0;
+
+	if (keys!=scanner->keys)
+	{
+		for (i=0;i<KEYS_NUM;i++)
+		{
+			if ((keys^scanner->keys)&(1<<i)) scanner->changed[i]=t1;
+		}
+		scanner->lastactivity=t1;
+		scanner->interval_us=scanner->fast_us;
+	} else if ((t1-scanner->lastactivity)*1e6>=SCAN_HOLD_US && scanner->interval_us<scanner->idle_us) {
+		scanner->interval_us*=2;
+		if (scanner->interval_us>scanner->idle_us) scanner->interval_us=scanner->idle_us;
+	}
+	scanner->keys=keys;
+	scanner->timestamp=t1;
+	return RETVAL_OK;
+}
+int keyscan_open(tKeyScanner* scanner,int* pins,int fast_us,int idle_us,int forcesysfs)
+{
+	memset(scanner,0,sizeof(tKeyScanner));
+	if (forcesysfs || keyscan_open_cdev(scanner,pins)!=RETVAL_OK)
+	{
+		if (keyscan_open_sysfs(scanner,pins)!=RETVAL_OK) return RETVAL_NOK;
+	}
+	scanner->fast_us=fast_us;
+	scanner->idle_us=idle_us;
+	scanner->interval_us=idle_us;
+	scanner->reporttime=timestamp();
+	if (keyscan_snapshot(scanner)!=RETVAL_OK) return RETVAL_NOK;
+	scanner->scans=0;
+	scanner->scantime=0;
+	return RETVAL_OK;
+}
+int keyscan_close(tKeyScanner* scanner)
+{
+	int i;
+	if (scanner->mode==SCAN_CDEV)
+	{
+		for (i=0;i<scanner->chips;i++) close(scanner->linefd[i]);
+		return RETVAL_OK;
+	}
+	for (i=0;i<KEYS_NUM;i++) close(scanner->valuefd[i]);
 	return gpio_pins_down();
 }
+void keyscan_report(tKeyScanner* scanner,int force)
+{
+	double elapsed;
+	elapsed=scanner->timestamp-scanner->reporttime;
+	if (!force && elapsed<SCAN_REPORT_SECONDS) return;
+	if (elapsed<=0 || scanner->scans==0) return;
+	printf("%s: %.1f scans/s, %.1f us per scan, interval now %d us\n",
+		(scanner->mode==SCAN_CDEV)?"gpiochip":"sysfs",
+		scanner->scans/elapsed,scanner->scantime*1e6/scanner->scans,scanner->interval_us);
+	scanner->scans=0;
+	scanner->scantime=0;
+	scanner->reporttime=scanner->timestamp;
+}
+
+// the key trace: every change of a key, with the time since the one before.
+// oledd.app -k replays it.
+typedef struct _tKeyTrace
+{
+	FILE* f;
+	double last;
+	unsigned long records;
+} tKeyTrace;
+
+int keytrace_open(tKeyTrace* trace,const char* path,unsigned char keys,double now)
+{
+	unsigned char header[KEYTRACE_HEADER];
+	trace->f=fopen(path,"wb");
+	if (trace->f==NULL)
+	{
+		fprintf(stderr,"unable to write the key trace to %s\n",path);
+		return RETVAL_NOK;
+	}
+	memset(header,0,sizeof(header));
+	memcpy(header,KEYTRACE_MAGIC,4);
+	header[4]=keys;
+	fwrite(header,1,sizeof(header),trace->f);
+	trace->last=now;
+	trace->records=0;
+	return RETVAL_OK;
+}
+void keytrace_record(tKeyTrace* trace,int key,int level,double when)
+{
+	unsigned char record[KEYTRACE_RECORD];
+	unsigned long long us;
+	if (trace->f==NULL) return;
+	us=(when-trace->last)*1e6;
+	if (us>0xffffffffULL) us=0xffffffffULL;
+	record[0]=us;
+	record[1]=us>>8;
+	record[2]=us>>16;
+	record[3]=us>>24;
+	record[4]=key;
+	record[5]=level;
+	fwrite(record,1,sizeof(record),trace->f);
+	trace->last=when;
+	trace->records++;
+}
+void keytrace_close(tKeyTrace* trace)
+{
+	if (trace->f==NULL) return;
+	fclose(trace->f);
+	trace->f=NULL;
+	printf("%lu key changes recorded\n",trace->records);
+}
+
+tKeyScanner scanner;
+tKeyTrace keytrace;
 void graceFulExit(int signal_number)
 {
 	printf("shutting down ...\n");
-	sh1106_down();
+	keyscan_report(&scanner,1);
+	keytrace_close(&keytrace);
+	keyscan_close(&scanner);
 	exit(0);
 }
 int main(int argc,char** argv)
 {
 	char *names[8]={"LEFT","UP","FIRE","DOWN","RIGHT","KEY1","KEY2","KEY3"};
-	int pins[8]={PIN_LEFT,PIN_UP,PIN_FIRE,PIN_DOWN,PIN_RIGHT,PIN_KEY1,PIN_KEY2,PIN_KEY3};
-	int lastval[8]={0};
+	int pins[8];
+	int fast_us;
+	int idle_us;
+	int forcesysfs;
+	const char* tracepath;
+	int opt;
+
+	tracepath=NULL;
+	fast_us=SCAN_FAST_US;
+	idle_us=SCAN_IDLE_US;
+	forcesysfs=0;
+	if (BOARD_DEFAULT>=0) board_select(boards[BOARD_DEFAULT].name);
+	while ((opt=getopt(argc,argv,"f:i:sr:w:"))!=-1)
+	{
+		switch (opt)
+		{
+			case 'f':	fast_us=atoi(optarg)*1000;break;
+			case 'i':	idle_us=atoi(optarg)*1000;break;
+			case 's':	forcesysfs=1;break;
+			case 'r':	tracepath=optarg;break;
+			case 'w':
+				if (board_select(optarg)<0)
+				{
+					fprintf(stderr,"unknown board %s\n",optarg);
+					return 1;
+				}
+				break;
+			default:
+				fprintf(stderr,"usage: %s [-f ms] [-i ms] [-s] [-r file] [-w board]\n",argv[0]);
+				fprintf(stderr,"  -f ms   scan interval right after a key press (default %d)\n",SCAN_FAST_US/1000);
+				fprintf(stderr,"  -i ms   scan interval when idle (default %d)\n",SCAN_IDLE_US/1000);
+				fprintf(stderr,"  -s      use the sysfs value files, even if there is a gpiochip device\n");
+				fprintf(stderr,"  -r file record the key changes, to replay them with oledd.app -k file\n");
+				fprintf(stderr,"  -w board %s, instead of the one from the sourcecode\n",BOARD_NAMES);
+				return 1;
+		}
+	}
+	if (physicalmapping==NULL)
+	{
+		fprintf(stderr,BOARD_MISSING,"-w");
+		return 1;
+	}
+	pins[0]=PIN_LEFT;
+	pins[1]=PIN_UP;
+	pins[2]=PIN_FIRE;
+	pins[3]=PIN_DOWN;
+	pins[4]=PIN_RIGHT;
+	pins[5]=PIN_KEY1;
+	pins[6]=PIN_KEY2;
+	pins[7]=PIN_KEY3;
+	if (fast_us<1) fast_us=1;
+	if (idle_us<fast_us) idle_us=fast_us;
 	signal(SIGINT, graceFulExit);
-	if (sh1106_up())
+	if (keyscan_open(&scanner,pins,fast_us,idle_us,forcesysfs))
 	{
 		fprintf(stderr,"unable to start up pins. sorry.\n");
 		return 1;
 	}
+	if (tracepath!=NULL && keytrace_open(&keytrace,tracepath,scanner.keys,scanner.timestamp)!=RETVAL_OK)
+	{
+		keyscan_close(&scanner);
+		return 1;
+	}
 	while (1)
 	{
+		unsigned char lastkeys;
 		int i;
-		for (i=0;i<8;i++) 
+		lastkeys=scanner.keys;
+		usleep(scanner.interval_us);
+		if (keyscan_snapshot(&scanner)!=RETVAL_OK) break;
+		for (i=0;i<KEYS_NUM;i++) 
 		{
-			int val;
-			gpio_read(pins[i],&val);
-			if (val!=lastval[i])
+			if ((lastkeys^scanner.keys)&(1<<i))
 			{
-				printf("%8s %d->%d\n",names[i],lastval[i],val);
+				printf("%8s %d->%d  at %.6f\n",names[i],(lastkeys>>i)&1,(scanner.keys>>i)&1,scanner.changed[i]);
+				keytrace_record(&keytrace,i,(scanner.keys>>i)&1,scanner.changed[i]);
 			}
-			lastval[i]=val;
 		}
+		keyscan_report(&scanner,0);
 	}	
 	graceFulExit(0);
 
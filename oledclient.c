@@ -0,0 +1,202 @@
+/*
+MIT No Attribution
+
+Copyright 2022 Thomas Dettbarn (dettus@dettus.net)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this
+software and associated documentation files (the "Software"), to deal in the Software
+without restriction, including without limitation the rights to use, copy, modify,
+merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+
+// a client for oledd. it does not need to be root, and it does not need to
+// know anything about the board. the framebuffer is shared memory, so drawing
+// is nothing more than writing to memory. once a frame is finished, the
+// client tells the daemon which pages have changed.
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "oledd.h"
+
+#define	RETVAL_OK	0
+#define	RETVAL_NOK	-1
+
+#define	CANVAS_WIDTH	SHAREDFB_WIDTH
+#define	CANVAS_PAGES	SHAREDFB_PAGES
+
+typedef struct _tClient
+{
+	tSharedFB* fb;
+	int commitfd;
+} tClient;
+
+int client_connect(tClient* client,const char* path)
+{
+	struct sockaddr_un addr;
+	struct msghdr msg;
+	struct iovec iov;
+	struct cmsghdr* cmsg;
+	char control[CMSG_SPACE(2*sizeof(int))];
+	unsigned int magic;
+	int fds[2];
+	int sock;
+
+	sock=socket(AF_UNIX,SOCK_STREAM|SOCK_CLOEXEC,0);
+	if (sock<0) return RETVAL_NOK;
+	memset(&addr,0,sizeof(addr));
+	addr.sun_family=AF_UNIX;
+	snprintf(addr.sun_path,sizeof(addr.sun_path),"%s",path);
+	if (connect(sock,(struct sockaddr*)&addr,sizeof(addr))<0)
+	{
+		fprintf(stderr,"Unable to connect to %s. Is oledd running?\n",path);
+		close(sock);
+		return RETVAL_NOK;
+	}
+	iov.iov_base=&magic;
+	iov.iov_len=sizeof(magic);
+	memset(&msg,0,sizeof(msg));
+	msg.msg_iov=&iov;
+	msg.msg_iovlen=1;
+	msg.msg_control=control;
+	msg.msg_controllen=sizeof(control);
+	if (recvmsg(sock,&msg,MSG_CMSG_CLOEXEC)!=sizeof(magic) || magic!=SHAREDFB_MAGIC)
+	{
+		fprintf(stderr,"The daemon did not send a framebuffer\n");
+		close(sock);
+		return RETVAL_NOK;
+	}
+	close(sock);
+	cmsg=CMSG_FIRSTHDR(&msg);
+	if (cmsg==NULL || cmsg->cmsg_type!=SCM_RIGHTS || cmsg->cmsg_len!=CMSG_LEN(sizeof(fds)))
+	{
+		fprintf(stderr,"The daemon did not send a framebuffer\n");
+		return RETVAL_NOK;
+	}
+	memcpy(fds,CMSG_DATA(cmsg),sizeof(fds));
+	client->fb=(tSharedFB*)mmap(NULL,sizeof(tSharedFB),PROT_READ|PROT_WRITE,MAP_SHARED,fds[0],0);
+	close(fds[0]);
+	if (client->fb==MAP_FAILED || client->fb->width!=CANVAS_WIDTH || client->fb->pages!=CANVAS_PAGES)
+	{
+		fprintf(stderr,"Unable to map the framebuffer\n");
+		close(fds[1]);
+		return RETVAL_NOK;
+	}
+	client->commitfd=fds[1];
+	return RETVAL_OK;
+}
+void client_disconnect(tClient* client)
+{
+	munmap(client->fb,sizeof(tSharedFB));
+	close(client->commitfd);
+}
+// pages is a bitmask of the pages that have changed since the last commit
+void client_commit(tClient* client,unsigned int pages)
+{
+	unsigned long long one;
+	if (!pages) return;
+	__atomic_fetch_or(&client->fb->dirty,pages,__ATOMIC_RELEASE);
+	one=1;
+	write(client->commitfd,&one,sizeof(one));
+}
+
+// returns the bitmask of the pages that have been changed
+unsigned int draw_pixel(tSharedFB* fb,int x,int y,int value)
+{
+	unsigned char* byte;
+	unsigned char bit;
+	if (x<0 || x>=CANVAS_WIDTH || y<0 || y>=CANVAS_PAGES*8) return 0;
+	byte=&fb->canvas[(y/8)*CANVAS_WIDTH+x];
+	bit=1<<(y%8);
+	if (((*byte&bit)!=0)==(value!=0)) return 0;
+	*byte^=bit;
+	return 1<<(y/8);
+}
+
+int main(int argc,char** argv)
+{
+	tClient client;
+	const char* path;
+	int frames;
+	int interval;
+	int opt;
+	int frame;
+	int x,y;
+
+	path=OLEDD_SOCKET;
+	frames=1000;
+	interval=20;
+	while ((opt=getopt(argc,argv,"s:n:i:"))!=-1)
+	{
+		switch (opt)
+		{
+			case 's':	path=optarg;break;
+			case 'n':	frames=atoi(optarg);break;
+			case 'i':	interval=atoi(optarg);break;
+			default:
+				fprintf(stderr,"usage: %s [-s socket] [-n frames] [-i milliseconds]\n",argv[0]);
+				fprintf(stderr,"  -s socket       where oledd is listening (default %s)\n",OLEDD_SOCKET);
+				fprintf(stderr,"  -n frames       number of frames to draw (default 1000)\n");
+				fprintf(stderr,"  -i milliseconds time between two frames (default 20)\n");
+				return 1;
+		}
+	}
+	if (client_connect(&client,path)!=RETVAL_OK)
+	{
+		return 1;
+	}
+
+	// clear the screen, then let a box bounce around. only the pages the box
+	// touches are sent to the display.
+	memset(client.fb->canvas,0,sizeof(client.fb->canvas));
+	client_commit(&client,(1<<CANVAS_PAGES)-1);
+	x=0;
+	y=0;
+	for (frame=0;frame<frames;frame++)
+	{
+		unsigned int dirty;
+		int i,j;
+		int nx,ny;
+
+		nx=frame%(2*(CANVAS_WIDTH-12));
+		if (nx>=CANVAS_WIDTH-12) nx=2*(CANVAS_WIDTH-12)-nx;
+		ny=(frame*3)%(2*(CANVAS_PAGES*8-12));
+		if (ny>=CANVAS_PAGES*8-12) ny=2*(CANVAS_PAGES*8-12)-ny;
+		dirty=0;
+		for (i=0;i<12;i++)
+		{
+			for (j=0;j<12;j++)
+			{
+				dirty|=draw_pixel(client.fb,x+i,y+j,0);
+			}
+		}
+		for (i=0;i<12;i++)
+		{
+			for (j=0;j<12;j++)
+			{
+				dirty|=draw_pixel(client.fb,nx+i,ny+j,1);
+			}
+		}
+		x=nx;
+		y=ny;
+		client_commit(&client,dirty);
+		usleep(interval*1000);
+	}
+	client_disconnect(&client);
+	return 0;
+}
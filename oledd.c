@@ -0,0 +1,2606 @@
+/*
+MIT No Attribution
+
+Copyright 2022 Thomas Dettbarn (dettus@dettus.net)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this
+software and associated documentation files (the "Software"), to deal in the Software
+without restriction, including without limitation the rights to use, copy, modify,
+merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+// Configuration starts here
+//#define PATCHED_WIRING		// comment in if you did the EXACT SAME wiring as I did ;)
+//#define PINOUT_JETSONNANO		// comment in if you connected the SH1106 directly to a Jetson Nano
+//#define PINOUT_BANANAPI		// comment in if you connected the SH1106 directly to a Banana Pi Zero
+//#define PINOUT_RASPBERRYPI		// comment in if you connected the SH1106 directly to a Raspberry Pi (Zero)
+// Configuration ends here
+
+
+#define	_GNU_SOURCE		// memfd_create(), accept4()
+#include <stdlib.h>
+#include <signal.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <fcntl.h>
+#include <string.h>
+#include <stddef.h>
+#include <time.h>
+#include <errno.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "oledd.h"
+
+#define	RETVAL_OK	0
+#define	RETVAL_NOK	-1
+#define	GPIO_INPUT	0
+#define	GPIO_OUTPUT	1
+#define	GPIO_OUTPUT_HIGH	2	// output, starting with 1. for the reset pin, so that it does not glitch
+
+
+#define	MAXBUFLEN	64
+
+#define	DELAY_US(us)	usleep((us));
+#define	DELAY_MS(ms)	usleep((ms)*1000);
+
+#define	SPI_MODE0	0
+#define	SPI_MODE1	1
+#define	SPI_MODE2	2
+#define	SPI_MODE3	3
+
+#define	SPI_LSBFIRST	0
+#define	SPI_MSBFIRST	1
+#define SPI_DELAY	do {} while (0)	//DELAY_US(1)
+
+#define	WAVE_MOSI	0x00	// a step of a waveform: bit 1 is the pin, bit 0 the level
+#define	WAVE_SCLK	0x02
+#define	WAVE_MAXSTEPS	25	// 8 bits with 3 steps each, and the clock back to idle
+
+#define	TRACE_SIZE	65536	// pin changes in the trace ring, a power of 2
+
+#define	TXN_COMMAND	0
+#define	TXN_DATA	1
+#define	TXN_MAXLEN	2048
+#define	TXN_MAXRUNS	64
+
+#define	OLED_COLUMN_OFFSET	2	// the SH1106 has 132 columns of RAM, the panel shows columns 2..129
+#define	OLED_RAM_COLUMNS	132
+
+#define	ORIENT_FLIPX		1	// segment remap
+#define	ORIENT_FLIPY		2	// reversed COM scan
+#define	ORIENT_0		0
+#define	ORIENT_180		(ORIENT_FLIPX|ORIENT_FLIPY)
+
+#define	KEYS_NUM	8
+
+#define	CANVAS_WIDTH	128
+#define	CANVAS_PAGES	8
+
+#define	OLED_CONTRAST_NORMAL	0xa0	// the value oled_init() sets
+#define	OLED_CONTRAST_DIMMED	0x01
+
+#define	IDLE_ACTIVE	0
+#define	IDLE_DIMMED	1
+#define	IDLE_OFF	2
+
+#define	IDLE_DIM_SECONDS	30
+#define	IDLE_OFF_SECONDS	120
+#define	IDLE_FALLBACK_MS	50	// poll interval when the kernel does not report edges on the key pins
+#define	STATS_INTERVAL		60	// seconds between the cpu/wakeup reports
+
+#define	FLUSH_DEFERRED	0	// after all the pending events have been handled
+#define	FLUSH_IMMEDIATE	1	// as soon as something has been drawn
+#define	FLUSH_TICK	2	// at the next tick of a fixed frame rate
+#define	FLUSH_TICK_MS	16
+
+// rough costs of one pin change, for the simulated transports
+#define	TRANSPORT_SYSFS_NS	15000	// open, write, close
+#define	TRANSPORT_CHARDEV_NS	2000	// one ioctl on /dev/gpiochip
+#define	TRANSPORT_MMAP_NS	50	// writing to the GPIO registers
+
+#define	LATENCY_EVENTS		400	// key presses and releases from the injector
+#define	LATENCY_MAXPENDING	64
+#define	KEYTRACE_MAGIC		"OKT1"	// the key trace, as keytest.app -r writes it
+#define	KEYTRACE_HEADER		8	// magic, the levels of the keys at the start, 3 bytes reserved
+#define	KEYTRACE_RECORD		6	// microseconds since the previous record (32 bit LE), key, level
+#define	LATENCY_PAGES		((1<<5)|(1<<6))	// the lines oledd_keys() draws
+
+#define	SCHED_PRIO_NORMAL	1	// the higher, the sooner a page is sent
+#define	SCHED_PRIO_CLOCK	2
+#define	SCHED_PRIO_MAX		9
+#define	SCHED_ADDRESS_BYTES	3	// the cost of sending a page, on top of its columns
+#define	LOAD_INTERVAL_MS	50	// -a: how often the upper half of the display is redrawn
+
+#define	LOOP_MAXSOURCES	32
+#define	LOOP_MAXEVENTS	16
+#define	LOOP_MAXWORK	16
+#define	BENCH_DRAIN_BUDGET	160
+#define	BENCH_DRAIN_MS		300
+
+#define	OLEDD_CONTROL	"/run/oledd.ctl"
+#define	STATE_MAGIC	0x4f535431	// "OST1"
+#define	BOOTID_LEN	36
+#define	CONTROL_MAXLEN	256
+
+
+//// depends on the development board
+
+// the way I understand this is, that the physical pins are mapped into
+// the system memory. to accces those, there is some sort of memory
+// offset maybe
+#include "boards.h"
+
+// this is the GPIO pinout for the waveshare OLED 1.3 SH1106 hat
+// source: https://www.waveshare.com/1.3inch-oled-hat.htm
+
+#ifdef	PATCHED_WIRING
+// Apparently, not every Key was mapped to a working GPIO pin. 
+// So I did some rewiring. This is a setup that works
+#define	PIN_LEFT	(physicalmapping[ 3])	// OLED pin 29
+#define	PIN_UP		(physicalmapping[ 5])	// OLED pin 31
+#define	PIN_FIRE	(physicalmapping[ 7])	// OLED pin 33
+#define	PIN_DOWN	(physicalmapping[29])	// OLED pin 35
+#define	PIN_RIGHT	(physicalmapping[31])	// OLED pin 37
+
+#define	PIN_KEY1	(physicalmapping[27])	// OLED pin 36
+#define	PIN_KEY2	(physicalmapping[24])	// OLED pin 38
+#define	PIN_KEY3	(physicalmapping[26])	// OLED pin 40
+
+#define	PIN_BL		(physicalmapping[16])	// OLED pin 12
+#define	PIN_DC		(physicalmapping[18])
+#define	PIN_RST		(physicalmapping[22])
+#define PIN_CS		(physicalmapping[28])	// OLED pin 24
+
+#define	PIN_MOSI	(physicalmapping[19])
+#define	PIN_MISO	(physicalmapping[21])
+#define	PIN_SCLK	(physicalmapping[23])
+
+#else
+#define	PIN_LEFT	(physicalmapping[29])
+#define	PIN_UP		(physicalmapping[31])
+#define	PIN_FIRE	(physicalmapping[33])
+#define	PIN_DOWN	(physicalmapping[35])
+#define	PIN_RIGHT	(physicalmapping[37])
+
+#define	PIN_KEY1	(physicalmapping[36])
+#define	PIN_KEY2	(physicalmapping[38])
+#define	PIN_KEY3	(physicalmapping[40])
+
+#define	PIN_BL		(physicalmapping[12])
+#define	PIN_DC		(physicalmapping[18])
+#define	PIN_RST		(physicalmapping[22])
+#define PIN_CS		(physicalmapping[24])
+
+#define	PIN_MOSI	(physicalmapping[19])
+#define	PIN_MISO	(physicalmapping[21])
+#define	PIN_SCLK	(physicalmapping[23])
+#endif
+
+
+
+int gpio_export(int pin)
+{
+	int fd;
+	char buffer[MAXBUFLEN];
+	int len;
+	fd=open("/sys/class/gpio/export", O_WRONLY);
+	if (fd<0)
+	{
+		fprintf(stderr,"GPIO export for pin %d failed\n",pin);
+		return RETVAL_NOK;
+	}
+	len=snprintf(buffer,MAXBUFLEN,"%d",pin);
+	write(fd,buffer,len);
+	close(fd);
+	return RETVAL_OK;
+}
+
+
+int gpio_unexport(int pin)
+{
+	int fd;
+	char buffer[MAXBUFLEN];
+	int len;
+	fd=open("/sys/class/gpio/unexport", O_WRONLY);
+	if (fd<0)
+	{
+		fprintf(stderr,"GPIO unexport for pin %d failed\n",pin);
+		return RETVAL_NOK;
+	}
+	len=snprintf(buffer,MAXBUFLEN,"%d",pin);
+	write(fd,buffer,len);
+	close(fd);
+	return RETVAL_OK;
+}
+
+int gpio_direction(int pin,int direction)
+{
+	int fd;
+	char buffer[MAXBUFLEN];
+	snprintf(buffer,MAXBUFLEN,"/sys/class/gpio/gpio%d/direction",pin);
+	fd=open(buffer,O_WRONLY);
+	if (fd<0)
+	{
+		fprintf(stderr,"GPIO direction for pin %d cannot be set\n",pin);
+		return RETVAL_NOK;
+	}
+	if (direction==GPIO_INPUT)
+	{
+		write(fd,"in",2);
+	} else if (direction==GPIO_OUTPUT) {
+		write(fd,"out",3);
+	} else if (direction==GPIO_OUTPUT_HIGH) {
+		write(fd,"high",4);
+	} else {
+		fprintf(stderr,"Type error for direction for pin %d (%d unknown)\n",pin,direction);
+	}
+	close(fd);
+		
+	
+	return RETVAL_OK;
+}
+// the trace remembers the last TRACE_SIZE pin changes with a timestamp, in a
+// ring. writing to it is one atomic increment and a few stores, so it can
+// stay on while the display is running. the ring can then be written as a VCD
+// file, and looked at with GTKWave.
+typedef struct _tTraceEvent
+{
+	unsigned long long ns;
+	int pin;
+	int value;
+} tTraceEvent;
+typedef struct _tTrace
+{
+	unsigned long head;	// the number of events so far. the ring has the last TRACE_SIZE of them
+	tTraceEvent events[TRACE_SIZE];
+} tTrace;
+tTrace* gpio_trace=NULL;
+
+void trace_record(tTrace* trace,int pin,int value)
+{
+	struct timespec ts;
+	tTraceEvent* ev;
+	unsigned long idx;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	idx=__atomic_fetch_add(&trace->head,1,__ATOMIC_RELAXED);
+	ev=&trace->events[idx&(TRACE_SIZE-1)];
+	ev->ns=ts.tv_sec*1000000000ULL+ts.tv_nsec;
+	ev->pin=pin;
+	ev->value=value;
+}
+int trace_vcd(tTrace* trace,const char* path)
+{
+	const struct
+	{
+		int pin;
+		const char* name;
+	} signals[]={
+		{PIN_MOSI,"mosi"},{PIN_SCLK,"sclk"},{PIN_DC,"dc"},{PIN_CS,"cs"},{PIN_RST,"rst"},{PIN_BL,"bl"}
+	};
+	#define	TRACE_SIGNALS	((int)(sizeof(signals)/sizeof(signals[0])))
+	unsigned long head;
+	unsigned long first;
+	unsigned long long start;
+	unsigned long long last;
+	unsigned long i;
+	int s;
+	FILE* f;
+
+	head=__atomic_load_n(&trace->head,__ATOMIC_ACQUIRE);
+	first=(head>TRACE_SIZE)?head-TRACE_SIZE:0;
+	if (first==head)
+	{
+		fprintf(stderr,"the trace is empty\n");
+		return RETVAL_NOK;
+	}
+	f=fopen(path,"w");
+	if (f==NULL)
+	{
+		fprintf(stderr,"unable to write the trace to %s\n",path);
+		return RETVAL_NOK;
+	}
+	start=trace->events[first&(TRACE_SIZE-1)].ns;
+	fprintf(f,"$comment %lu pin changes, %lu lost before the start of the ring $end\n",head-first,first);
+	fprintf(f,"$timescale 1ns $end\n");
+	fprintf(f,"$scope module sh1106 $end\n");
+	for (s=0;s<TRACE_SIGNALS;s++)
+	{
+		fprintf(f,"$var wire 1 %c %s $end\n",'A'+s,signals[s].name);
+	}
+	fprintf(f,"$upscope $end\n");
+	fprintf(f,"$enddefinitions $end\n");
+	fprintf(f,"#0\n$dumpvars\n");
+	for (s=0;s<TRACE_SIGNALS;s++)
+	{
+		fprintf(f,"x%c\n",'A'+s);	// unknown until the first write
+	}
+	fprintf(f,"$end\n");
+	last=0;
+	for (i=first;i<head;i++)
+	{
+		tTraceEvent* ev;
+		ev=&trace->events[i&(TRACE_SIZE-1)];
+		for (s=0;s<TRACE_SIGNALS;s++)
+		{
+			if (signals[s].pin==ev->pin) break;
+		}
+		if (s==TRACE_SIGNALS) continue;
+		if (ev->ns-start!=last)
+		{
+			last=ev->ns-start;
+			fprintf(f,"#%llu\n",last);
+		}
+		fprintf(f,"%d%c\n",ev->value?1:0,'A'+s);
+	}
+	fclose(f);
+	printf("%lu pin changes written to %s\n",head-first,path);
+	return RETVAL_OK;
+}
+int wave_mosi=-1;		// the current level of MOSI, -1 when unknown
+// for the latency measurement, the pins can be simulated: every write just
+// takes as long as it would with a real transport.
+int gpio_simulated_ns=-1;
+long gpio_simulated_writes=0;
+int gpio_write(int pin,int value)
+{
+	int fd;
+	char buffer[MAXBUFLEN];
+	if (pin==PIN_MOSI) wave_mosi=-1;	// spi_writebuf() sets it again after its last write
+	if (gpio_trace!=NULL) trace_record(gpio_trace,pin,value);
+	if (gpio_simulated_ns>=0)
+	{
+		struct timespec ts;
+		long long until;
+		gpio_simulated_writes++;
+		clock_gettime(CLOCK_MONOTONIC,&ts);
+		until=ts.tv_sec*1000000000LL+ts.tv_nsec+gpio_simulated_ns;
+		do
+		{
+			clock_gettime(CLOCK_MONOTONIC,&ts);
+		} while (ts.tv_sec*1000000000LL+ts.tv_nsec<until);
+		return RETVAL_OK;
+	}
+	snprintf(buffer,MAXBUFLEN,"/sys/class/gpio/gpio%d/value",pin);
+	fd=open(buffer,O_WRONLY);
+	if (fd<0)
+	{
+		fprintf(stderr,"Cannot access GPIO pin %d\n",pin);
+		return RETVAL_NOK;
+	}
+	write(fd,value?"1":"0",1);
+	close(fd);
+	return RETVAL_OK;
+}
+
+int gpio_read(int pin,int* value)
+{
+	int fd;
+	char buffer[MAXBUFLEN];
+	int len;
+	snprintf(buffer,MAXBUFLEN,"/sys/class/gpio/gpio%d/value",pin);
+	fd=open(buffer,O_RDONLY);
+	if (fd<0)
+	{
+		fprintf(stderr,"Cannot access GPIO pin %d\n",pin);
+		return RETVAL_NOK;
+	}
+	len=read(fd,buffer,3);
+	if (len<0)
+	{
+		fprintf(stderr,"Unable to read from pin %d\n",pin);
+		close(fd);
+		return RETVAL_NOK;		
+	}
+	*value=atoi(buffer);
+	close(fd);
+	return RETVAL_OK;
+}
+
+int gpio_edge(int pin,const char* edge)
+{
+	int fd;
+	char buffer[MAXBUFLEN];
+	snprintf(buffer,MAXBUFLEN,"/sys/class/gpio/gpio%d/edge",pin);
+	fd=open(buffer,O_WRONLY);
+	if (fd<0)
+	{
+		fprintf(stderr,"GPIO edge for pin %d cannot be set\n",pin);
+		return RETVAL_NOK;
+	}
+	if (write(fd,edge,strlen(edge))<0)
+	{
+		fprintf(stderr,"GPIO pin %d does not support edge %s\n",pin,edge);
+		close(fd);
+		return RETVAL_NOK;
+	}
+	close(fd);
+	return RETVAL_OK;
+}
+// the value file stays open, so that poll() can wait for the edge interrupts.
+int gpio_open_value(int pin)
+{
+	int fd;
+	char buffer[MAXBUFLEN];
+	snprintf(buffer,MAXBUFLEN,"/sys/class/gpio/gpio%d/value",pin);
+	fd=open(buffer,O_RDONLY);
+	if (fd<0)
+	{
+		fprintf(stderr,"Cannot access GPIO pin %d\n",pin);
+	}
+	return fd;
+}
+int gpio_read_fd(int fd,int* value)
+{
+	char buffer[4];
+	int len;
+	len=pread(fd,buffer,sizeof(buffer)-1,0);
+	if (len<=0)
+	{
+		return RETVAL_NOK;
+	}
+	*value=(buffer[0]=='1');
+	return RETVAL_OK;
+}
+
+int gpio_pins_up()
+{
+	int retval;
+
+	retval=RETVAL_OK;
+	// start with the GPIO configuration
+	retval|=gpio_export(PIN_RST);	
+	retval|=gpio_export(PIN_DC);	
+	retval|=gpio_export(PIN_BL);	
+	retval|=gpio_export(PIN_CS);	
+
+	retval|=gpio_direction(PIN_RST, GPIO_OUTPUT_HIGH);
+	retval|=gpio_direction(PIN_DC,  GPIO_OUTPUT);
+	retval|=gpio_direction(PIN_BL,  GPIO_OUTPUT_HIGH);
+	retval|=gpio_direction(PIN_CS,  GPIO_OUTPUT);
+
+
+	// continue with the SPI pins
+	retval|=gpio_export(PIN_SCLK);
+	retval|=gpio_export(PIN_MOSI);
+	retval|=gpio_export(PIN_MISO);
+	
+	retval|=gpio_direction(PIN_SCLK, GPIO_OUTPUT);
+	retval|=gpio_direction(PIN_MOSI, GPIO_OUTPUT);
+	retval|=gpio_direction(PIN_MISO, GPIO_INPUT);
+	wave_mosi=-1;
+
+	// and the keys
+	retval|=gpio_export(PIN_LEFT);
+	retval|=gpio_export(PIN_UP);
+	retval|=gpio_export(PIN_FIRE);
+	retval|=gpio_export(PIN_DOWN);
+	retval|=gpio_export(PIN_RIGHT);
+	retval|=gpio_export(PIN_KEY1);
+	retval|=gpio_export(PIN_KEY2);
+	retval|=gpio_export(PIN_KEY3);
+
+	retval|=gpio_direction(PIN_LEFT,  GPIO_INPUT);
+	retval|=gpio_direction(PIN_UP,    GPIO_INPUT);
+	retval|=gpio_direction(PIN_FIRE,  GPIO_INPUT);
+	retval|=gpio_direction(PIN_DOWN,  GPIO_INPUT);
+	retval|=gpio_direction(PIN_RIGHT, GPIO_INPUT);
+	retval|=gpio_direction(PIN_KEY1,  GPIO_INPUT);
+	retval|=gpio_direction(PIN_KEY2,  GPIO_INPUT);
+	retval|=gpio_direction(PIN_KEY3,  GPIO_INPUT);
+
+	return retval;
+}
+
+int gpio_pins_down()
+{
+	int retval;
+
+	retval=RETVAL_OK;
+	unlink(OLEDD_STATE);	// the display is about to forget everything
+	retval|=gpio_write(PIN_RST,0);
+	retval|=gpio_write(PIN_DC,0);
+	retval|=gpio_write(PIN_BL,0);
+	
+	retval|=gpio_unexport(PIN_RST);	
+	retval|=gpio_unexport(PIN_DC);	
+	retval|=gpio_unexport(PIN_BL);	
+	retval|=gpio_unexport(PIN_CS);	
+
+	retval|=gpio_write(PIN_SCLK,0);
+	retval|=gpio_write(PIN_MOSI,0);
+		
+	retval|=gpio_unexport(PIN_SCLK);
+	retval|=gpio_unexport(PIN_MOSI);
+	retval|=gpio_unexport(PIN_MISO);
+
+	retval|=gpio_unexport(PIN_LEFT);
+	retval|=gpio_unexport(PIN_UP);
+	retval|=gpio_unexport(PIN_FIRE);
+	retval|=gpio_unexport(PIN_DOWN);
+	retval|=gpio_unexport(PIN_RIGHT);
+	retval|=gpio_unexport(PIN_KEY1);
+	retval|=gpio_unexport(PIN_KEY2);
+	retval|=gpio_unexport(PIN_KEY3);
+
+	return retval;
+}
+
+// the bit-banged SPI is table driven. for every mode and bit order, the
+// sequence of pin changes for each byte value is computed once. writes to
+// MOSI which would not change its level are left out. since that depends on
+// the last bit of the previous byte, there are two tables.
+typedef struct _tWaveform
+{
+	int valid;
+	int cpol0;				// the idle level of the clock
+	unsigned char num[2][256];		// [MOSI level before the byte][byte]
+	unsigned char steps[2][256][WAVE_MAXSTEPS];
+} tWaveform;
+tWaveform waveforms[4][2];
+
+tWaveform* wave_get(int mode,int msbfirst)
+{
+	tWaveform* wave;
+	int cpha;
+	int prev;
+	int byte;
+
+	mode&=3;
+	msbfirst=(msbfirst==SPI_MSBFIRST);
+	wave=&waveforms[mode][msbfirst];
+	if (wave->valid) return wave;
+	switch (mode)
+	{
+		default:
+		case SPI_MODE0:	wave->cpol0=0;cpha=0;break;
+		case SPI_MODE1:	wave->cpol0=0;cpha=1;break;
+		case SPI_MODE2:	wave->cpol0=1;cpha=0;break;
+		case SPI_MODE3:	wave->cpol0=1;cpha=1;break;
+	}
+	for (prev=0;prev<2;prev++)
+	{
+		for (byte=0;byte<256;byte++)
+		{
+			unsigned char* steps;
+			int num;
+			int mosi;
+			int cpol;
+			int bits;
+			int b;
+
+			steps=wave->steps[prev][byte];
+			num=0;
+			mosi=prev;
+			b=byte;
+			cpol=wave->cpol0;
+			if (!cpha) cpol=1-cpol;	// when CPHA=1, the new value is being sampled at the first clock edge
+			for (bits=0;bits<8;bits++)
+			{
+				int bit;
+				if (msbfirst)
+				{
+					bit=(b>>7)&1;
+					b<<=1;
+				} else {
+					bit=b&1;
+					b>>=1;
+				}
+				if (bit!=mosi) steps[num++]=WAVE_MOSI|bit;	// set the value
+				mosi=bit;
+				steps[num++]=WAVE_SCLK|cpol;	// 1st clock edge
+				cpol=1-cpol;
+				steps[num++]=WAVE_SCLK|cpol;	// 2nd clock edge
+				cpol=1-cpol;
+			}
+			if (cpha) steps[num++]=WAVE_SCLK|wave->cpol0;	// make sure that the SPI clk is the same as before. with CPHA=0, it already is.
+			wave->num[prev][byte]=num;
+		}
+	}
+	wave->valid=1;
+	return wave;
+}
+
+// sends a buffer over the bit-banged SPI.
+void spi_writebuf(unsigned char* buf,int len,int mode,int msbfirst)
+{
+	tWaveform* wave;
+	int pins[2];
+	int mosi;
+	int i;
+
+	wave=wave_get(mode,msbfirst);
+	pins[0]=PIN_MOSI;
+	pins[1]=PIN_SCLK;
+	gpio_write(PIN_SCLK,wave->cpol0);
+	mosi=wave_mosi;
+	if (mosi<0)
+	{
+		mosi=0;
+		gpio_write(PIN_MOSI,mosi);
+	}
+	for (i=0;i<len;i++)
+	{
+		unsigned char* steps;
+		int num;
+		int j;
+		steps=wave->steps[mosi][buf[i]];
+		num=wave->num[mosi][buf[i]];
+		for (j=0;j<num;j++)
+		{
+			gpio_write(pins[steps[j]>>1],steps[j]&1);
+			if (steps[j]&WAVE_SCLK) SPI_DELAY;
+		}
+		mosi=(msbfirst==SPI_MSBFIRST)?(buf[i]&1):(buf[i]>>7);
+	}
+	wave_mosi=mosi;
+}
+void spi_writebyte(unsigned char byte,int mode,int msbfirst)
+{
+	spi_writebuf(&byte,1,mode,msbfirst);
+}
+
+// a transaction collects command and data bytes for the display in one buffer.
+// consecutive bytes of the same kind form a run, and the DC line only has to
+// be switched between runs. a whole frame is handed over with one call to
+// txn_submit().
+typedef struct _tTransaction
+{
+	int len;
+	int runs;
+	int runstart[TXN_MAXRUNS];
+	int rundc[TXN_MAXRUNS];		// level of the DC pin: TXN_COMMAND or TXN_DATA
+	unsigned char buf[TXN_MAXLEN];
+} tTransaction;
+
+void txn_init(tTransaction* txn)
+{
+	txn->len=0;
+	txn->runs=0;
+}
+int txn_append(tTransaction* txn,int dc,const unsigned char* bytes,int len)
+{
+	if (txn->runs==0 || txn->rundc[txn->runs-1]!=dc)
+	{
+		if (txn->runs==TXN_MAXRUNS)
+		{
+			fprintf(stderr,"Too many runs in transaction\n");
+			return RETVAL_NOK;
+		}
+		txn->runstart[txn->runs]=txn->len;
+		txn->rundc[txn->runs]=dc;
+		txn->runs++;
+	}
+	if (txn->len+len>TXN_MAXLEN)
+	{
+		fprintf(stderr,"Transaction buffer overflow\n");
+		return RETVAL_NOK;
+	}
+	memcpy(&txn->buf[txn->len],bytes,len);
+	txn->len+=len;
+	return RETVAL_OK;
+}
+int txn_command(tTransaction* txn,unsigned char byte)
+{
+	return txn_append(txn,TXN_COMMAND,&byte,1);
+}
+int txn_data(tTransaction* txn,const unsigned char* bytes,int len)
+{
+	return txn_append(txn,TXN_DATA,bytes,len);
+}
+// what the controller has been told, so that it can be saved for a warm restart
+typedef struct _tPanel
+{
+	int contrast;
+	int power;
+	int orientation;
+	int columnoffset;	// where column 0 of the canvas is in the display RAM
+} tPanel;
+tPanel panel;
+
+// all the SH1106 commands for addressing are one byte each.
+int txn_address(tTransaction* txn,int page,int column)
+{
+	int retval;
+	column+=panel.columnoffset;
+	retval=RETVAL_OK;
+	retval|=txn_command(txn,0xb0+page);		// set page address
+	retval|=txn_command(txn,0x00|(column&0xf));	// set low column address
+	retval|=txn_command(txn,0x10|(column>>4));	// set high column address
+	return retval;
+}
+void txn_submit(tTransaction* txn)
+{
+	int i;
+	for (i=0;i<txn->runs;i++)
+	{
+		int end;
+		end=(i+1<txn->runs)?txn->runstart[i+1]:txn->len;
+		gpio_write(PIN_DC,txn->rundc[i]);
+		spi_writebuf(&txn->buf[txn->runstart[i]],end-txn->runstart[i],SPI_MODE0,SPI_MSBFIRST);
+	}
+	txn->len=0;
+	txn->runs=0;
+}
+void oled_reset()
+{
+	gpio_write(PIN_DC,0);		
+	gpio_write(PIN_RST,1);
+	DELAY_MS(200);
+	gpio_write(PIN_RST,0);
+	DELAY_MS(200);
+	gpio_write(PIN_RST,1);
+	DELAY_MS(200);
+}
+void oled_init()
+{
+	const unsigned char oled_commands[]={
+		0xae,0x02,0x10,0x40, 0x81,0xa0,0xc0,0xa6,	// turn off oled panel, set low column addr, set high column addr, set start line, set contrast control register,   set SEG/Column Mapping, Set COM/ROW scan direction, set normal display
+		0xa8,0x3f,0xd3,0x00, 0xd5,0x80,0xd9,0xf1,	// set multiplex ration 1:64, 1/64 duty, set display offset, not offset, set display clock, set divide clock as 100frames/sec, set pre-charge period, set pre-chare as 15 clocks & discarge as 1 clock
+		0xda,0x12,0xdb,0x40, 0x20,0x02,0xa4,0xa6,	// set com pins hardare, ???, set vcomh, set vcom deselect level, set page addr mode, ???, disable entire display on, disable inverse display on, 
+		0xaf	// turn on oled panel
+	};
+	tTransaction txn;
+	txn_init(&txn);
+	txn_append(&txn,TXN_COMMAND,oled_commands,sizeof(oled_commands));
+	txn_submit(&txn);
+	panel.contrast=OLED_CONTRAST_NORMAL;
+	panel.power=1;
+	panel.orientation=ORIENT_0;
+	panel.columnoffset=OLED_COLUMN_OFFSET;
+}
+// upside down or mirrored, without any work per frame. with the segment
+// remap, the panel sees the other end of the RAM, so the offset changes.
+void oled_orientation(int orientation)
+{
+	tTransaction txn;
+	panel.orientation=orientation;
+	panel.columnoffset=(orientation&ORIENT_FLIPX)?OLED_RAM_COLUMNS-CANVAS_WIDTH-OLED_COLUMN_OFFSET:OLED_COLUMN_OFFSET;
+	txn_init(&txn);
+	txn_command(&txn,(orientation&ORIENT_FLIPX)?0xa1:0xa0);	// set SEG/Column Mapping
+	txn_command(&txn,(orientation&ORIENT_FLIPY)?0xc8:0xc0);	// set COM/ROW scan direction
+	txn_submit(&txn);
+}
+
+void oled_contrast(int contrast)
+{
+	tTransaction txn;
+	panel.contrast=contrast;
+	txn_init(&txn);
+	txn_command(&txn,0x81);		// set contrast control register
+	txn_command(&txn,contrast);
+	txn_submit(&txn);
+}
+void oled_power(int on)
+{
+	tTransaction txn;
+	panel.power=on;
+	txn_init(&txn);
+	txn_command(&txn,on?0xaf:0xae);	// turn on/off oled panel. the display RAM is kept while it is off
+	txn_submit(&txn);
+}
+
+// renders one line of text into a page of the canvas
+void text_render(unsigned char* page,const char* text,int inverted)
+{
+	const unsigned long long font[95]={
+		0x0000000000000000,//  
+		0x0000065f5f060000,// !
+		0x0000030300030300,// "
+		0x00147f7f147f7f14,// #
+		0x0000123a6b6b2e24,// $
+		0x0062660c18306646,// %
+		0x00487a375d4f7a30,// &
+		0x0000000000030704,// '
+		0x00000041633e1c00,// (
+		0x0000001c3e634100,// )
+		0x082a3e1c1c3e2a08,// *
+		0x000008083e3e0808,// +
+		0x0000000060e08000,// ,
+		0x0000080808080808,// -
+		0x0000000060600000,// .
+		0x000103060c183060,// /
+		0x003e7f4d59717f3e,// 0
+		0x000040407f7f4240,// 1
+		0x0000666f49597362,// 2
+		0x0000367f49496322,// 3
+		0x00507f7f53161c18,// 4
+		0x0000397d45456727,// 5
+		0x00003079494b7e3c,// 6
+		0x0000070f79710303,// 7
+		0x0000367f49497f36,// 8
+		0x00001e3f69494f06,// 9
+		0x0000000066660000,// :
+		0x0000000066e68000,// ;
+		0x0000004163361c08,// <
+		0x0000242424242424,// =
+		0x0000081c36634100,// >
+		0x0000060f59510302,// ?
+		0x001e1f5d5d417f3e,// @
+		0x00007c7e13137e7c,// A
+		0x00367f49497f7f41,// B
+		0x0022634141633e1c,// C
+		0x001c3e63417f7f41,// D
+		0x0063415d497f7f41,// E
+		0x0003011d497f7f41,// F
+		0x0072735141633e1c,// G
+		0x00007f7f08087f7f,// H
+		0x000000417f7f4100,// I
+		0x00013f7f41407030,// J
+		0x0063771c087f7f41,// K
+		0x00706040417f7f41,// L
+		0x007f7f0e1c0e7f7f,// M
+		0x007f7f180c067f7f,// N
+		0x001c3e6341633e1c,// O
+		0x00060f09497f7f41,// P
+		0x00005e7f71213f1e,// Q
+		0x00667f19097f7f41,// R
+		0x00003273594d6f26,// S
+		0x000003417f7f4103,// T
+		0x00007f7f40407f7f,// U
+		0x00001f3f60603f1f,// V
+		0x007f7f3018307f7f,// W
+		0x0043673c183c6743,// X
+		0x0000074f78784f07,// Y
+		0x0073674d59716347,// Z
+		0x00000041417f7f00,// [
+		0x006030180c060301,// 
+		0x0000007f7f414100,// ]
+		0x00080c0603060c08,// ^
+		0x8080808080808080,// _
+		0x0000000407030000,// `
+		0x0040783c54547420,// a
+		0x00307848483f7f41,// b
+		0x0000286c44447c38,// c
+		0x00407f3f49487830,// d
+		0x0000185c54547c38,// e
+		0x00000203497f7e48,// f
+		0x00047cf8a4a4bc98,// g
+		0x00787c04087f7f41,// h
+		0x000000407d7d4400,// i
+		0x00007dfd8080e060,// j
+		0x00446c38107f7f41,// k
+		0x000000407f7f4100,// l
+		0x00787c1c38187c7c,// m
+		0x0000787c04047c7c,// n
+		0x0000387c44447c38,// o
+		0x00183c24a4f8fc84,// p
+		0x0084fcf8a4243c18,// q
+		0x00181c044c787c44,// r
+		0x0000247454545c48,// s
+		0x000024447f3e0400,// t
+		0x00407c3c40407c3c,// u
+		0x00001c3c60603c1c,// v
+		0x003c7c7038707c3c,// w
+		0x00446c3810386c44,// x
+		0x00007cfca0a0bc9c,// y
+		0x0000644c5c74644c,// z
+		0x00004141773e0808,// {
+		0x0000007777000000,// |
+		0x000008083e774141,// }
+		0x0001030203010302,// ~
+	};
+	#define	TEXT_WIDTH	16
+	#define	FONT_XRES	8
+	int i;
+	int j;
+
+	for (i=0;i<TEXT_WIDTH;i++)
+	{
+		unsigned long long x;
+		unsigned char c;
+		c=text[i];
+		if (c<' ' || c>'~') c='?';	// the text comes from the control fifo
+		x=font[c-' '];
+		if (inverted) x=~x;
+		for (j=0;j<FONT_XRES;j++)
+		{
+			*page++=x&0xff;
+			x>>=8;
+		}
+	}
+}
+
+
+// the idle manager dims the panel after a while without activity, and turns
+// it off a while later. since the SH1106 keeps its RAM, waking it up again
+// only takes the two commands, not a redraw.
+typedef struct _tIdle
+{
+	int state;
+	double lastactivity;
+	double dimafter;
+	double offafter;
+	int contrast;
+} tIdle;
+
+double timestamp()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return ts.tv_sec+ts.tv_nsec*1e-9;
+}
+
+void idle_init(tIdle* idle,double dimafter,double offafter,int contrast)
+{
+	idle->state=IDLE_ACTIVE;
+	idle->lastactivity=timestamp();
+	idle->dimafter=dimafter;
+	idle->offafter=offafter;
+	idle->contrast=contrast;
+}
+// returns the state before the activity, so that the caller knows whether the
+// user has just woken up the panel.
+int idle_activity(tIdle* idle)
+{
+	int state;
+	state=idle->state;
+	idle->lastactivity=timestamp();
+	if (state==IDLE_OFF)
+	{
+		oled_contrast(OLED_CONTRAST_NORMAL);
+		oled_power(1);
+	} else if (state==IDLE_DIMMED) {
+		oled_contrast(OLED_CONTRAST_NORMAL);
+	}
+	idle->state=IDLE_ACTIVE;
+	return state;
+}
+void idle_check(tIdle* idle)
+{
+	double idletime;
+	idletime=timestamp()-idle->lastactivity;
+	if (idle->state==IDLE_ACTIVE && idletime>=idle->dimafter)
+	{
+		oled_contrast(idle->contrast);
+		idle->state=IDLE_DIMMED;
+	}
+	if (idle->state==IDLE_DIMMED && idletime>=idle->offafter)
+	{
+		oled_power(0);
+		idle->state=IDLE_OFF;
+	}
+}
+// how long the process may sleep until the next state change. -1 means forever.
+int idle_timeout_ms(tIdle* idle)
+{
+	double deadline;
+	double remaining;
+	switch (idle->state)
+	{
+		case IDLE_ACTIVE:	deadline=idle->lastactivity+idle->dimafter;break;
+		case IDLE_DIMMED:	deadline=idle->lastactivity+idle->offafter;break;
+		default:		return -1;
+	}
+	remaining=deadline-timestamp();
+	if (remaining<0) return 0;
+	return (int)(remaining*1000)+1;
+}
+
+// cpu time and wakeups, to compare the blocking wait to busy polling
+typedef struct _tStats
+{
+	unsigned long wakeups;		// the wakeup counter of the loop at the beginning of the interval
+	double walltime;
+	double cputime;
+} tStats;
+
+double stats_cputime()
+{
+	struct rusage usage;
+	getrusage(RUSAGE_SELF,&usage);
+	return usage.ru_utime.tv_sec+usage.ru_utime.tv_usec*1e-6+usage.ru_stime.tv_sec+usage.ru_stime.tv_usec*1e-6;
+}
+void stats_init(tStats* stats,unsigned long wakeups)
+{
+	stats->wakeups=wakeups;
+	stats->walltime=timestamp();
+	stats->cputime=stats_cputime();
+}
+void stats_report(tStats* stats,unsigned long wakeups,int force)
+{
+	double walltime;
+	double cputime;
+	walltime=timestamp()-stats->walltime;
+	if (!force && walltime<STATS_INTERVAL) return;
+	if (walltime<=0) return;
+	cputime=stats_cputime()-stats->cputime;
+	wakeups-=stats->wakeups;
+	printf("%.1f s: %lu wakeups (%.1f per minute), cpu %.3f s (%.2f%%)\n",
+		walltime,wakeups,wakeups*60.0/walltime,cputime,cputime*100.0/walltime);
+	stats_init(stats,wakeups+stats->wakeups);
+}
+
+// a single threaded event loop. file descriptors (keys, timers, pipes) are
+// watched with epoll, and their handlers are called when something happens.
+// handlers can schedule work items, for example a display flush. those run
+// after all the pending events have been handled, so that several updates
+// end up in a single flush. when there is no work, the loop sleeps in
+// epoll_wait() until the next event.
+typedef void (*tLoopHandler)(void* context,int fd,unsigned int events);
+typedef void (*tLoopWork)(void* context);
+
+typedef struct _tLoopSource
+{
+	int fd;				// -1 when the slot is free
+	tLoopHandler handler;
+	void* context;
+} tLoopSource;
+
+typedef struct _tLoop
+{
+	int epfd;
+	int running;
+	unsigned long wakeups;
+	tLoopSource sources[LOOP_MAXSOURCES];
+	int worknum;
+	tLoopWork work[LOOP_MAXWORK];
+	void* workcontext[LOOP_MAXWORK];
+	tLoopWork after;		// called after every iteration, may be NULL
+	void* aftercontext;
+} tLoop;
+
+int loop_init(tLoop* loop)
+{
+	int i;
+	memset(loop,0,sizeof(tLoop));
+	for (i=0;i<LOOP_MAXSOURCES;i++)
+	{
+		loop->sources[i].fd=-1;
+	}
+	loop->epfd=epoll_create1(EPOLL_CLOEXEC);
+	if (loop->epfd<0)
+	{
+		fprintf(stderr,"Unable to create the event loop\n");
+		return RETVAL_NOK;
+	}
+	return RETVAL_OK;
+}
+void loop_close(tLoop* loop)
+{
+	int i;
+	for (i=0;i<LOOP_MAXSOURCES;i++)
+	{
+		if (loop->sources[i].fd>=0) close(loop->sources[i].fd);
+		loop->sources[i].fd=-1;
+	}
+	close(loop->epfd);
+}
+int loop_add(tLoop* loop,int fd,unsigned int events,tLoopHandler handler,void* context)
+{
+	struct epoll_event ev;
+	int i;
+	for (i=0;i<LOOP_MAXSOURCES;i++)
+	{
+		if (loop->sources[i].fd<0) break;
+	}
+	if (i==LOOP_MAXSOURCES)
+	{
+		fprintf(stderr,"Too many file descriptors in the event loop\n");
+		return RETVAL_NOK;
+	}
+	memset(&ev,0,sizeof(ev));
+	ev.events=events;
+	ev.data.ptr=&loop->sources[i];
+	if (epoll_ctl(loop->epfd,EPOLL_CTL_ADD,fd,&ev)<0)
+	{
+		fprintf(stderr,"Unable to watch file descriptor %d\n",fd);
+		return RETVAL_NOK;
+	}
+	loop->sources[i].fd=fd;
+	loop->sources[i].handler=handler;
+	loop->sources[i].context=context;
+	return RETVAL_OK;
+}
+// stops watching fd and closes it.
+void loop_remove(tLoop* loop,int fd)
+{
+	int i;
+	for (i=0;i<LOOP_MAXSOURCES;i++)
+	{
+		if (loop->sources[i].fd==fd)
+		{
+			epoll_ctl(loop->epfd,EPOLL_CTL_DEL,fd,NULL);
+			close(fd);
+			loop->sources[i].fd=-1;
+		}
+	}
+}
+// the timers are disarmed when they are created. returns the fd, or -1.
+int loop_timer(tLoop* loop,tLoopHandler handler,void* context)
+{
+	int fd;
+	fd=timerfd_create(CLOCK_MONOTONIC,TFD_NONBLOCK|TFD_CLOEXEC);
+	if (fd<0)
+	{
+		fprintf(stderr,"Unable to create timer\n");
+		return -1;
+	}
+	if (loop_add(loop,fd,EPOLLIN,handler,context)!=RETVAL_OK)
+	{
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+// first_ms<0 disarms the timer. interval_ms=0 makes it a one-shot.
+void loop_timer_set(int fd,int first_ms,int interval_ms)
+{
+	struct itimerspec its;
+	memset(&its,0,sizeof(its));
+	if (first_ms>=0)
+	{
+		if (first_ms==0) first_ms=1;	// 0 would disarm it
+		its.it_value.tv_sec=first_ms/1000;
+		its.it_value.tv_nsec=(first_ms%1000)*1000000L;
+		its.it_interval.tv_sec=interval_ms/1000;
+		its.it_interval.tv_nsec=(interval_ms%1000)*1000000L;
+	}
+	timerfd_settime(fd,0,&its,NULL);
+}
+// has to be called by the timer handlers. returns the number of expirations
+unsigned long long loop_timer_ack(int fd)
+{
+	unsigned long long expirations;
+	if (read(fd,&expirations,sizeof(expirations))!=sizeof(expirations)) return 0;
+	return expirations;
+}
+// the same work item is only queued once.
+int loop_schedule(tLoop* loop,tLoopWork work,void* context)
+{
+	int i;
+	for (i=0;i<loop->worknum;i++)
+	{
+		if (loop->work[i]==work && loop->workcontext[i]==context) return RETVAL_OK;
+	}
+	if (loop->worknum==LOOP_MAXWORK)
+	{
+		fprintf(stderr,"Too much work in the event loop\n");
+		return RETVAL_NOK;
+	}
+	loop->work[loop->worknum]=work;
+	loop->workcontext[loop->worknum]=context;
+	loop->worknum++;
+	return RETVAL_OK;
+}
+void loop_stop(tLoop* loop)
+{
+	loop->running=0;
+}
+int loop_run(tLoop* loop)
+{
+	struct epoll_event events[LOOP_MAXEVENTS];
+	tLoopWork work[LOOP_MAXWORK];
+	void* workcontext[LOOP_MAXWORK];
+	loop->running=1;
+	while (loop->running)
+	{
+		int n;
+		int i;
+		int worknum;
+
+		// with work pending, only pick up what has happened in the meantime
+		n=epoll_wait(loop->epfd,events,LOOP_MAXEVENTS,loop->worknum?0:-1);
+		if (n<0)
+		{
+			if (errno==EINTR) continue;
+			fprintf(stderr,"epoll_wait failed\n");
+			return RETVAL_NOK;
+		}
+		loop->wakeups++;
+		for (i=0;i<n;i++)
+		{
+			tLoopSource* source;
+			source=(tLoopSource*)events[i].data.ptr;
+			if (source->fd>=0) source->handler(source->context,source->fd,events[i].events);
+		}
+
+		// work which is scheduled by the work items runs in the next iteration.
+		// the batch is taken off the queue first, so that a work item can schedule itself again.
+		worknum=loop->worknum;
+		memcpy(work,loop->work,worknum*sizeof(tLoopWork));
+		memcpy(workcontext,loop->workcontext,worknum*sizeof(void*));
+		loop->worknum=0;
+		for (i=0;i<worknum;i++)
+		{
+			work[i](workcontext[i]);
+		}
+		if (loop->after) loop->after(loop->aftercontext);
+	}
+	return RETVAL_OK;
+}
+
+// with warm set, the controller is expected to be initialized already, and
+// still showing what it showed when the last instance quit.
+int sh1106_up(int warm)
+{
+	int retval;
+	retval=RETVAL_OK;
+	retval|=gpio_pins_up();
+	// spi mode 0
+	// spi master
+	// spi clock div 2
+	// spi msbfirst
+
+	// ?? tell the device it should take orders from SPI??
+	retval|=gpio_write(PIN_BL,1);
+	retval|=gpio_write(PIN_CS,0);
+	
+	if (retval==RETVAL_OK && !warm)
+	{	
+		oled_reset();
+		oled_init();
+	}
+	return retval;
+}
+int sh1106_down()
+{
+	return gpio_pins_down();
+}
+
+// the shared framebuffer (tSharedFB) is in oledd.h
+int sharedfb_create(tSharedFB** fb)
+{
+	int fd;
+	fd=memfd_create("oledd",MFD_CLOEXEC|MFD_ALLOW_SEALING);
+	if (fd<0)
+	{
+		fprintf(stderr,"Unable to create the shared framebuffer\n");
+		return -1;
+	}
+	if (ftruncate(fd,sizeof(tSharedFB))<0)
+	{
+		close(fd);
+		return -1;
+	}
+	// a client could otherwise shrink it, and the daemon would crash when flushing
+	fcntl(fd,F_ADD_SEALS,F_SEAL_SHRINK|F_SEAL_GROW|F_SEAL_SEAL);
+	*fb=(tSharedFB*)mmap(NULL,sizeof(tSharedFB),PROT_READ|PROT_WRITE,MAP_SHARED,fd,0);
+	if (*fb==MAP_FAILED)
+	{
+		close(fd);
+		return -1;
+	}
+	(*fb)->magic=SHAREDFB_MAGIC;
+	(*fb)->width=CANVAS_WIDTH;
+	(*fb)->pages=CANVAS_PAGES;
+	(*fb)->dirty=0;
+	return fd;
+}
+// with a slow transport, a full frame takes longer than a flush cycle. so
+// every cycle gets a budget of bytes, and the dirty pages are sent by
+// priority, and the oldest first. whatever does not fit rolls over to the
+// next cycle, so that a small update (the clock) does not have to wait for
+// a large one.
+typedef struct _tSched
+{
+	int budget;			// bytes per flush, 0 for no limit
+	unsigned int pending;		// pages which are dirty, but have not been sent yet
+	int priority[CANVAS_PAGES];
+	double since[CANVAS_PAGES];	// when the page became dirty. 0 while it is clean
+	// how long the pages had to wait for the display
+	unsigned long sent[CANVAS_PAGES];
+	double stalesum[CANVAS_PAGES];
+	double stalemax[CANVAS_PAGES];
+	unsigned long cycles;
+	unsigned long rollovers;	// pages which had to wait for another cycle
+} tSched;
+
+void sched_init(tSched* sched,int budget)
+{
+	int i;
+	memset(sched,0,sizeof(tSched));
+	sched->budget=budget;
+	for (i=0;i<CANVAS_PAGES;i++)
+	{
+		sched->priority[i]=SCHED_PRIO_NORMAL;
+	}
+}
+// the age of a page starts when it is first marked as dirty
+void sched_mark(tSched* sched,unsigned int dirty)
+{
+	double now;
+	int i;
+	now=timestamp();
+	for (i=0;i<CANVAS_PAGES;i++)
+	{
+		if ((dirty&(1<<i)) && sched->since[i]==0) sched->since[i]=now;
+	}
+}
+// the page which should be sent next: the highest priority, and then the oldest. -1 when there is none.
+int sched_next(tSched* sched,unsigned int pages)
+{
+	int best;
+	int i;
+	best=-1;
+	for (i=0;i<CANVAS_PAGES;i++)
+	{
+		if (!(pages&(1<<i))) continue;
+		if (best<0 || sched->priority[i]>sched->priority[best] ||
+			(sched->priority[i]==sched->priority[best] && sched->since[i]<sched->since[best])) best=i;
+	}
+	return best;
+}
+void sched_report(tSched* sched)
+{
+	int i;
+	if (!sched->cycles) return;
+	printf("%lu flushes, %lu pages rolled over (budget: ",sched->cycles,sched->rollovers);
+	if (sched->budget) printf("%d bytes)\n",sched->budget);
+	else printf("none)\n");
+	for (i=0;i<CANVAS_PAGES;i++)
+	{
+		if (!sched->sent[i]) continue;
+		printf("  page %d, priority %d: sent %lu times, stale for %.1f ms on average, %.1f ms at most\n",
+			i,sched->priority[i],sched->sent[i],sched->stalesum[i]*1000/sched->sent[i],sched->stalemax[i]*1000);
+	}
+}
+// only the pages which have been marked as dirty are sent to the display.
+// the shadow is what the display is currently showing. within a dirty page,
+// only the columns from the first to the last change are sent. returns the
+// number of bytes that have been sent. pages which did not fit into the
+// budget stay in sched->pending.
+int sharedfb_flush(tSharedFB* fb,unsigned char* shadow,tSched* sched)
+{
+	tTransaction txn;
+	unsigned int dirty;
+	double now;
+	int i;
+	dirty=__atomic_exchange_n(&fb->dirty,0,__ATOMIC_ACQ_REL);
+	sched_mark(sched,dirty);	// in case a client has marked it after the commit
+	sched->pending|=dirty;
+	if (!sched->pending) return 0;
+	sched->cycles++;
+	now=timestamp();
+	txn_init(&txn);
+	while ((i=sched_next(sched,sched->pending))>=0)
+	{
+		unsigned char* src;
+		unsigned char* dst;
+		int first;
+		int last;
+		src=&fb->canvas[i*CANVAS_WIDTH];
+		dst=&shadow[i*CANVAS_WIDTH];
+		for (first=0;first<CANVAS_WIDTH && src[first]==dst[first];first++);
+		if (first<CANVAS_WIDTH)
+		{
+			for (last=CANVAS_WIDTH-1;src[last]==dst[last];last--);
+			// the first page is always sent, so that there is progress
+			if (sched->budget && txn.len && txn.len+SCHED_ADDRESS_BYTES+last-first+1>sched->budget) break;
+			// the clients might still be drawing. what is sent is what the shadow says.
+			memcpy(&dst[first],&src[first],last-first+1);
+			txn_address(&txn,i,first);
+			txn_data(&txn,&dst[first],last-first+1);
+			sched->sent[i]++;
+			sched->stalesum[i]+=now-sched->since[i];
+			if (now-sched->since[i]>sched->stalemax[i]) sched->stalemax[i]=now-sched->since[i];
+		}
+		sched->pending&=~(1<<i);
+		sched->since[i]=0;
+	}
+	for (i=0;i<CANVAS_PAGES;i++)
+	{
+		if (sched->pending&(1<<i)) sched->rollovers++;
+	}
+	i=txn.len;
+	if (i) txn_submit(&txn);
+	return i;
+}
+void oled_flush(unsigned char* canvas)
+{
+	tTransaction txn;
+	int i;
+	txn_init(&txn);
+	for (i=0;i<CANVAS_PAGES;i++)
+	{
+		txn_address(&txn,i,0);
+		txn_data(&txn,&canvas[i*CANVAS_WIDTH],CANVAS_WIDTH);
+	}
+	txn_submit(&txn);
+}
+
+// the state file allows a restart without resetting the display. it has a
+// copy of the display RAM and the controller settings, and is written after
+// every flush. it is only valid for the same boot, and when the checksum is ok.
+typedef struct _tState
+{
+	unsigned int magic;
+	unsigned int size;
+	char bootid[BOOTID_LEN+1];
+	tPanel panel;
+	unsigned char canvas[CANVAS_PAGES*CANVAS_WIDTH];
+	unsigned int checksum;
+} tState;
+
+unsigned int state_checksum(tState* state)
+{
+	unsigned char* ptr;
+	unsigned int hash;
+	size_t i;
+	ptr=(unsigned char*)state;
+	hash=2166136261u;		// FNV-1a
+	for (i=0;i<offsetof(tState,checksum);i++)
+	{
+		hash^=ptr[i];
+		hash*=16777619u;
+	}
+	return hash;
+}
+void state_bootid(char* bootid)
+{
+	int fd;
+	memset(bootid,0,BOOTID_LEN+1);
+	fd=open("/proc/sys/kernel/random/boot_id",O_RDONLY);
+	if (fd<0) return;
+	read(fd,bootid,BOOTID_LEN);
+	close(fd);
+}
+int state_load(const char* path,tState* state)
+{
+	char bootid[BOOTID_LEN+1];
+	int fd;
+	int n;
+	fd=open(path,O_RDONLY);
+	if (fd<0) return RETVAL_NOK;
+	n=read(fd,state,sizeof(tState));
+	close(fd);
+	state_bootid(bootid);
+	if (n!=sizeof(tState) || state->magic!=STATE_MAGIC || state->size!=sizeof(tState)
+		|| strcmp(state->bootid,bootid)!=0 || state->checksum!=state_checksum(state))
+	{
+		return RETVAL_NOK;
+	}
+	return RETVAL_OK;
+}
+// the display only keeps its RAM while the reset pin stays high. once another
+// program has reset it, or unexported the pin, the state file is stale.
+int state_rst_high(const char* gpioroot,int pin)
+{
+	char buffer[MAXBUFLEN];
+	char value;
+	int fd;
+	int n;
+	snprintf(buffer,MAXBUFLEN,"%s/gpio%d/value",gpioroot,pin);
+	fd=open(buffer,O_RDONLY);
+	if (fd<0) return 0;
+	n=read(fd,&value,1);
+	close(fd);
+	return (n==1 && value=='1');
+}
+// a warm restart needs both: a state file, and a display which still has it
+int state_valid(const char* path,tState* state,const char* gpioroot)
+{
+	if (state_load(path,state)!=RETVAL_OK) return 0;
+	return state_rst_high(gpioroot,PIN_RST);
+}
+// whoever resets the display, or lets go of the pins, removes the state
+void state_forget(const char* path)
+{
+	unlink(path);
+}
+void state_save(int fd,unsigned char* shadow)
+{
+	tState state;
+	if (fd<0) return;
+	memset(&state,0,sizeof(state));
+	state.magic=STATE_MAGIC;
+	state.size=sizeof(tState);
+	state_bootid(state.bootid);
+	state.panel=panel;
+	memcpy(state.canvas,shadow,sizeof(state.canvas));
+	state.checksum=state_checksum(&state);
+	pwrite(fd,&state,sizeof(state),0);
+}
+
+typedef struct _tOledd
+{
+	tLoop loop;
+	tIdle idle;
+	tStats stats;
+	int busypoll;
+	int pins[KEYS_NUM];
+	int keyfds[KEYS_NUM];
+	int lastval[KEYS_NUM];
+	int presses;
+	int waking;
+	int idletimer;
+	int clocktimer;
+	int clockarmed;
+	double started;
+	int controlfd;
+	int controllen;
+	char control[CONTROL_MAXLEN];
+	int memfd;
+	int commitfd;			// eventfd, the clients write to it after drawing
+	int clientmode;			// once a client has drawn, the daemon stops drawing its own lines
+	tSharedFB* fb;
+	tSched sched;
+	unsigned char shadow[CANVAS_PAGES*CANVAS_WIDTH];	// what the display is showing
+	int statefd;			// -1 without warm restarts
+	tPanel savedpanel;
+	// the text lines the daemon has drawn, so that unchanged lines are not drawn again
+	char screen[CANVAS_PAGES][TEXT_WIDTH+1];
+	int inverted[CANVAS_PAGES];
+	int flushpolicy;
+	int flushtimer;
+	int flusharmed;
+	// key-to-photon latency: every key event gets the time it happened as a
+	// tag. the tags wait here until the flush which shows the event is done.
+	int injectfd;			// the synthetic keys, -1 for the real ones
+	int injected[KEYS_NUM];
+	double injecttag;
+	int pendingtags;
+	double tags[LATENCY_MAXPENDING];
+	double* latencies;		// NULL when not measuring
+	int latencynum;
+	int latencymax;
+	int loadframe;
+} tOledd;
+
+tOledd oledd;
+const char *keynames[KEYS_NUM]={"LEFT","UP","FIRE","DOWN","RIGHT","KEY1","KEY2","KEY3"};
+
+void graceFulExit(int signal_number)
+{
+	printf("shutting down display...\n");
+	stats_report(&oledd.stats,oledd.loop.wakeups,1);
+	sched_report(&oledd.sched);
+	if (oledd.statefd>=0)
+	{
+		// the reset pin has to stay high, or the display would forget everything
+		printf("leaving the display on for a warm restart\n");
+		state_save(oledd.statefd,oledd.shadow);
+		close(oledd.statefd);
+		exit(0);
+	}
+	sh1106_down();
+	exit(0);
+}
+
+void oledd_rearm(tOledd* d)
+{
+	int timeout;
+	timeout=idle_timeout_ms(&d->idle);
+	loop_timer_set(d->idletimer,timeout,0);
+	// the clock only ticks while the panel is fully on
+	if (d->idle.state==IDLE_ACTIVE && !d->clockarmed)
+	{
+		loop_timer_set(d->clocktimer,1000,1000);
+		d->clockarmed=1;
+	} else if (d->idle.state!=IDLE_ACTIVE && d->clockarmed) {
+		loop_timer_set(d->clocktimer,-1,0);
+		d->clockarmed=0;
+	}
+	if (memcmp(&panel,&d->savedpanel,sizeof(tPanel))!=0)
+	{
+		state_save(d->statefd,d->shadow);
+		d->savedpanel=panel;
+	}
+}
+int oledd_activity(tOledd* d)
+{
+	int state;
+	state=idle_activity(&d->idle);
+	oledd_rearm(d);
+	return state;
+}
+void oledd_dirty(tOledd* d);
+void oledd_flush(void* context)
+{
+	tOledd* d=(tOledd*)context;
+	if (sharedfb_flush(d->fb,d->shadow,&d->sched))
+	{
+		state_save(d->statefd,d->shadow);
+		// the events are shown once the lines for them have been sent
+		if (d->latencies!=NULL && !(d->sched.pending&LATENCY_PAGES))
+		{
+			double now;
+			int i;
+			now=timestamp();
+			for (i=0;i<d->pendingtags && d->latencynum<d->latencymax;i++)
+			{
+				d->latencies[d->latencynum++]=now-d->tags[i];
+			}
+			d->pendingtags=0;
+		}
+	}
+	// the rest has to wait for the next cycle
+	if (d->sched.pending)
+	{
+		if (d->flushpolicy==FLUSH_TICK) oledd_dirty(d);
+		else loop_schedule(&d->loop,oledd_flush,d);
+	}
+}
+// something has been drawn. when it is sent depends on the flush policy.
+void oledd_dirty(tOledd* d)
+{
+	sched_mark(&d->sched,__atomic_load_n(&d->fb->dirty,__ATOMIC_ACQUIRE));
+	switch (d->flushpolicy)
+	{
+		case FLUSH_IMMEDIATE:
+			oledd_flush(d);
+			break;
+		case FLUSH_TICK:
+			if (!d->flusharmed)
+			{
+				int ms;
+				ms=FLUSH_TICK_MS-((long long)(timestamp()*1000)%FLUSH_TICK_MS);
+				loop_timer_set(d->flushtimer,ms,0);
+				d->flusharmed=1;
+			}
+			break;
+		default:
+			loop_schedule(&d->loop,oledd_flush,d);
+			break;
+	}
+}
+void oledd_flush_handler(void* context,int fd,unsigned int events)
+{
+	tOledd* d=(tOledd*)context;
+	loop_timer_ack(fd);
+	d->flusharmed=0;
+	oledd_flush(d);
+}
+// the daemon draws into the shared framebuffer as well. the flush is a work
+// item, so that several lines end up in one transaction.
+// screen_draw() only draws, and returns 1 when the line has changed. then
+// the caller has to call oledd_dirty(), once for everything it has drawn.
+int screen_draw(tOledd* d,int line,const char* text,int inverted)
+{
+	char buf[TEXT_WIDTH+1];
+	if (line<0 || line>=CANVAS_PAGES) return 0;
+	snprintf(buf,sizeof(buf),"%-16.16s",text);
+	if (strcmp(buf,d->screen[line])==0 && d->inverted[line]==inverted) return 0;
+	memcpy(d->screen[line],buf,sizeof(buf));
+	d->inverted[line]=inverted;
+	text_render(&d->fb->canvas[line*CANVAS_WIDTH],buf,inverted);
+	__atomic_fetch_or(&d->fb->dirty,1<<line,__ATOMIC_RELEASE);
+	return 1;
+}
+void screen_set(tOledd* d,int line,const char* text,int inverted)
+{
+	if (screen_draw(d,line,text,inverted)) oledd_dirty(d);
+}
+void screen_line(tOledd* d,int line,const char* text,int inverted)
+{
+	oledd_activity(d);		// drawing counts as activity
+	screen_set(d,line,text,inverted);
+}
+
+void oledd_keys(tOledd* d)
+{
+	int i;
+	int changed;
+	char line[32];
+
+	changed=0;
+	for (i=0;i<KEYS_NUM;i++)
+	{
+		int val;
+		if (d->injectfd>=0)
+		{
+			val=d->injected[i];
+		} else if (d->busypoll) {
+			if (gpio_read(d->pins[i],&val)!=RETVAL_OK) continue;
+		} else {
+			if (gpio_read_fd(d->keyfds[i],&val)!=RETVAL_OK) continue;
+		}
+		if (val!=d->lastval[i])
+		{
+			printf("%8s %d->%d\n",keynames[i],d->lastval[i],val);
+			d->lastval[i]=val;
+			changed=1;
+		}
+	}
+	if (!changed) return;
+
+	// the key which wakes up the panel only wakes it up
+	if (oledd_activity(d)==IDLE_OFF) d->waking=1;
+	if (d->waking)
+	{
+		d->waking=0;
+		for (i=0;i<KEYS_NUM;i++)
+		{
+			if (!d->lastval[i]) d->waking=1;	// still held down
+		}
+		return;
+	}
+	if (d->clientmode) return;
+	if (d->latencies!=NULL && d->pendingtags<LATENCY_MAXPENDING)
+	{
+		d->tags[d->pendingtags++]=(d->injectfd>=0)?d->injecttag:timestamp();
+	}
+	d->presses++;
+	// both lines are drawn before anything is sent. otherwise, an
+	// immediate flush would send line 5 alone, and take the latency tags with it.
+	oledd_activity(d);
+	snprintf(line,sizeof(line),"events: %d",d->presses);
+	changed=screen_draw(d,5,line,0);
+	line[0]=0;
+	for (i=0;i<KEYS_NUM;i++)
+	{
+		if (!d->lastval[i]) snprintf(line,sizeof(line),"%s",keynames[i]);	// the keys are low active
+	}
+	changed|=screen_draw(d,6,line,1);
+	if (changed) oledd_dirty(d);
+}
+void oledd_key_handler(void* context,int fd,unsigned int events)
+{
+	oledd_keys((tOledd*)context);
+}
+// the synthetic keys come through a pipe, each with the time it was pressed or released
+typedef struct _tInjectedKey
+{
+	double stamp;
+	int key;
+	int value;
+} tInjectedKey;
+void oledd_inject_handler(void* context,int fd,unsigned int events)
+{
+	tOledd* d=(tOledd*)context;
+	tInjectedKey key;
+	if (read(fd,&key,sizeof(key))!=sizeof(key))
+	{
+		loop_stop(&d->loop);
+		return;
+	}
+	d->injected[key.key]=key.value;
+	d->injecttag=key.stamp;
+	oledd_keys(d);
+}
+void oledd_keypoll_handler(void* context,int fd,unsigned int events)
+{
+	loop_timer_ack(fd);
+	oledd_keys((tOledd*)context);
+}
+void oledd_busypoll(void* context)
+{
+	tOledd* d=(tOledd*)context;
+	oledd_keys(d);
+	loop_schedule(&d->loop,oledd_busypoll,d);	// keeps the loop from ever sleeping
+}
+void oledd_idle_handler(void* context,int fd,unsigned int events)
+{
+	tOledd* d=(tOledd*)context;
+	loop_timer_ack(fd);
+	idle_check(&d->idle);
+	oledd_rearm(d);
+}
+void oledd_clock_handler(void* context,int fd,unsigned int events)
+{
+	tOledd* d=(tOledd*)context;
+	int uptime;
+	char line[32];
+	loop_timer_ack(fd);
+	if (d->clientmode) return;
+	uptime=(int)(timestamp()-d->started);
+	snprintf(line,sizeof(line),"up %02d:%02d:%02d",uptime/3600,(uptime/60)%60,uptime%60);
+	screen_set(d,7,line,0);		// not an activity, otherwise the panel would never go to sleep
+}
+// a large redraw, for measuring: the upper half of the display, every LOAD_INTERVAL_MS
+void oledd_load_handler(void* context,int fd,unsigned int events)
+{
+	tOledd* d=(tOledd*)context;
+	unsigned long long ticks;
+	int i;
+	ticks=loop_timer_ack(fd);
+	d->loadframe+=ticks;
+	for (i=0;i<4*CANVAS_WIDTH;i++)
+	{
+		d->fb->canvas[i]=((i+d->loadframe)&8)?0xff:0x00;
+	}
+	__atomic_fetch_or(&d->fb->dirty,0x0f,__ATOMIC_RELEASE);
+	oledd_dirty(d);
+}
+// commands on the control fifo, one per line:
+//   text <line> <string>    show the string in line 0..7
+//   wake                    wake up the panel
+//   sleep                   turn off the panel
+//   quit                    shut down the daemon
+//   trace <file>            write the pin trace as VCD (with -t)
+//   priority <line> <level> how urgent the line is, 0..9 (default 1, the clock 2)
+//   stats                   print how long the lines waited for the display
+void oledd_command(tOledd* d,char* cmd)
+{
+	if (strncmp(cmd,"text ",5)==0)
+	{
+		char* text;
+		int line;
+		line=strtol(&cmd[5],&text,10);
+		if (*text==' ') text++;
+		screen_line(d,line,text,0);
+	} else if (strcmp(cmd,"wake")==0) {
+		oledd_activity(d);
+	} else if (strcmp(cmd,"sleep")==0) {
+		d->idle.lastactivity=timestamp()-d->idle.offafter;
+		idle_check(&d->idle);
+		oledd_rearm(d);
+	} else if (strcmp(cmd,"quit")==0) {
+		loop_stop(&d->loop);
+	} else if (strncmp(cmd,"trace ",6)==0) {
+		if (gpio_trace==NULL) fprintf(stderr,"tracing is off. start with -t\n");
+		else trace_vcd(gpio_trace,&cmd[6]);
+	} else if (strncmp(cmd,"priority ",9)==0) {
+		char* level;
+		int line;
+		line=strtol(&cmd[9],&level,10);
+		if (line>=0 && line<CANVAS_PAGES && atoi(level)>=0 && atoi(level)<=SCHED_PRIO_MAX) d->sched.priority[line]=atoi(level);
+	} else if (strcmp(cmd,"stats")==0) {
+		sched_report(&d->sched);
+	} else if (cmd[0]) {
+		fprintf(stderr,"unknown command [%s]\n",cmd);
+	}
+}
+void oledd_control_handler(void* context,int fd,unsigned int events)
+{
+	tOledd* d=(tOledd*)context;
+	int n;
+	char* eol;
+	n=read(fd,&d->control[d->controllen],CONTROL_MAXLEN-1-d->controllen);
+	if (n<=0) return;
+	d->controllen+=n;
+	d->control[d->controllen]=0;
+	while ((eol=strchr(d->control,'\n'))!=NULL)
+	{
+		*eol=0;
+		oledd_command(d,d->control);
+		d->controllen-=(eol+1-d->control);
+		memmove(d->control,eol+1,d->controllen+1);
+	}
+	if (d->controllen==CONTROL_MAXLEN-1) d->controllen=0;	// line too long
+}
+// a client has drawn something
+void oledd_commit_handler(void* context,int fd,unsigned int events)
+{
+	tOledd* d=(tOledd*)context;
+	unsigned long long commits;
+	if (read(fd,&commits,sizeof(commits))!=sizeof(commits)) return;
+	d->clientmode=1;
+	memset(d->screen,0,sizeof(d->screen));
+	oledd_activity(d);		// drawing counts as activity
+	oledd_dirty(d);
+}
+// new clients get the shared framebuffer and the eventfd, and that is all
+// there is to it. the connection is closed right away.
+void oledd_socket_handler(void* context,int fd,unsigned int events)
+{
+	tOledd* d=(tOledd*)context;
+	struct msghdr msg;
+	struct iovec iov;
+	struct cmsghdr* cmsg;
+	char control[CMSG_SPACE(2*sizeof(int))];
+	unsigned int magic;
+	int fds[2];
+	int client;
+
+	client=accept4(fd,NULL,NULL,SOCK_CLOEXEC);
+	if (client<0) return;
+	magic=SHAREDFB_MAGIC;
+	iov.iov_base=&magic;
+	iov.iov_len=sizeof(magic);
+	memset(&msg,0,sizeof(msg));
+	msg.msg_iov=&iov;
+	msg.msg_iovlen=1;
+	msg.msg_control=control;
+	msg.msg_controllen=sizeof(control);
+	cmsg=CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level=SOL_SOCKET;
+	cmsg->cmsg_type=SCM_RIGHTS;
+	cmsg->cmsg_len=CMSG_LEN(2*sizeof(int));
+	fds[0]=d->memfd;
+	fds[1]=d->commitfd;
+	memcpy(CMSG_DATA(cmsg),fds,sizeof(fds));
+	if (sendmsg(client,&msg,MSG_NOSIGNAL)<0)
+	{
+		fprintf(stderr,"Unable to pass the framebuffer to a client\n");
+	}
+	close(client);
+}
+int oledd_socket_open(tOledd* d,const char* path)
+{
+	struct sockaddr_un addr;
+	int fd;
+
+	d->memfd=sharedfb_create(&d->fb);
+	if (d->memfd<0) return RETVAL_NOK;
+	d->commitfd=eventfd(0,EFD_NONBLOCK|EFD_CLOEXEC);
+	if (d->commitfd<0 || loop_add(&d->loop,d->commitfd,EPOLLIN,oledd_commit_handler,d)!=RETVAL_OK)
+	{
+		fprintf(stderr,"Unable to create the commit eventfd\n");
+		return RETVAL_NOK;
+	}
+
+	fd=socket(AF_UNIX,SOCK_STREAM|SOCK_NONBLOCK|SOCK_CLOEXEC,0);
+	if (fd<0) return RETVAL_NOK;
+	memset(&addr,0,sizeof(addr));
+	addr.sun_family=AF_UNIX;
+	snprintf(addr.sun_path,sizeof(addr.sun_path),"%s",path);
+	unlink(path);
+	if (bind(fd,(struct sockaddr*)&addr,sizeof(addr))<0 || listen(fd,8)<0)
+	{
+		fprintf(stderr,"Unable to listen on %s\n",path);
+		close(fd);
+		return RETVAL_NOK;
+	}
+	chmod(path,0666);		// the clients do not need to be root
+	return loop_add(&d->loop,fd,EPOLLIN,oledd_socket_handler,d);
+}
+void oledd_after(void* context)
+{
+	tOledd* d=(tOledd*)context;
+	if (timestamp()-d->stats.walltime>=STATS_INTERVAL) sched_report(&d->sched);
+	stats_report(&d->stats,d->loop.wakeups,0);
+}
+int oledd_control_open(tOledd* d,const char* path)
+{
+	if (mkfifo(path,0620)<0 && errno!=EEXIST)
+	{
+		fprintf(stderr,"Unable to create control fifo %s\n",path);
+		return RETVAL_NOK;
+	}
+	d->controlfd=open(path,O_RDWR|O_NONBLOCK|O_CLOEXEC);	// also opened for writing, so that there is no EOF when the writers disappear
+	if (d->controlfd<0)
+	{
+		fprintf(stderr,"Unable to open control fifo %s\n",path);
+		return RETVAL_NOK;
+	}
+	return loop_add(&d->loop,d->controlfd,EPOLLIN,oledd_control_handler,d);
+}
+
+// the benchmark sends timestamps through pipes from another process, while
+// a fast timer is running, and every event schedules a bit of work. it
+// reports how late the handlers are called.
+#define	BENCH_PIPES	16
+#define	BENCH_EVENTS	100000
+#define	BENCH_BURST	32
+#define	BENCH_TIMER_US	1000
+#define	BENCH_WORK_US	10
+typedef struct _tBench
+{
+	tLoop loop;
+	int pipes;
+	int events;
+	int ticks;
+	double timerstart;
+	double* latency;
+	double* timerlatency;
+} tBench;
+int bench_compare(const void* a,const void* b)
+{
+	double x=*(const double*)a;
+	double y=*(const double*)b;
+	return (x>y)-(x<y);
+}
+void bench_percentiles(const char* name,double* values,int num)
+{
+	if (num==0) return;
+	qsort(values,num,sizeof(double),bench_compare);
+	printf("%-6s %7d events   p50 %8.1f us   p99 %8.1f us   max %8.1f us\n",name,num,
+		values[num/2]*1e6,values[(int)(num*0.99)]*1e6,values[num-1]*1e6);
+}
+void bench_work(void* context)
+{
+	double until;
+	until=timestamp()+BENCH_WORK_US*1e-6;
+	while (timestamp()<until);		// a pretend display flush
+}
+void bench_pipe_handler(void* context,int fd,unsigned int events)
+{
+	tBench* b=(tBench*)context;
+	double stamps[BENCH_BURST];
+	int n;
+	int i;
+	n=read(fd,stamps,sizeof(stamps));
+	if (n<=0)
+	{
+		loop_remove(&b->loop,fd);
+		if (--b->pipes==0) loop_stop(&b->loop);
+		return;
+	}
+	for (i=0;i<n/(int)sizeof(double) && b->events<BENCH_EVENTS;i++)
+	{
+		b->latency[b->events++]=timestamp()-stamps[i];
+	}
+	loop_schedule(&b->loop,bench_work,b);
+}
+void bench_timer_handler(void* context,int fd,unsigned int events)
+{
+	tBench* b=(tBench*)context;
+	unsigned long long expirations;
+	double due;
+	expirations=loop_timer_ack(fd);
+	b->ticks+=expirations;
+	due=b->timerstart+b->ticks*BENCH_TIMER_US*1e-6;
+	if (b->ticks<BENCH_EVENTS) b->timerlatency[b->ticks-1]=timestamp()-due;
+}
+int bench_loop()
+{
+	tBench b;
+	int fds[BENCH_PIPES][2];
+	pid_t pid;
+	int timerfd;
+	int i;
+	double t0,t1;
+
+	memset(&b,0,sizeof(b));
+	b.latency=calloc(BENCH_EVENTS,sizeof(double));
+	b.timerlatency=calloc(BENCH_EVENTS,sizeof(double));
+	if (b.latency==NULL || b.timerlatency==NULL || loop_init(&b.loop)!=RETVAL_OK) return RETVAL_NOK;
+	for (i=0;i<BENCH_PIPES;i++)
+	{
+		if (pipe(fds[i])<0) return RETVAL_NOK;
+	}
+	pid=fork();
+	if (pid==0)
+	{
+		// the load generator: bursts of timestamps into random pipes
+		srand(getpid());
+		for (i=0;i<BENCH_PIPES;i++) close(fds[i][0]);
+		for (i=0;i<BENCH_EVENTS;i++)
+		{
+			double now;
+			now=timestamp();
+			if (write(fds[rand()%BENCH_PIPES][1],&now,sizeof(now))!=sizeof(now)) break;
+			if ((i%BENCH_BURST)==BENCH_BURST-1) usleep(200);
+		}
+		exit(0);
+	}
+	for (i=0;i<BENCH_PIPES;i++)
+	{
+		close(fds[i][1]);
+		loop_add(&b.loop,fds[i][0],EPOLLIN,bench_pipe_handler,&b);
+	}
+	b.pipes=BENCH_PIPES;
+	timerfd=loop_timer(&b.loop,bench_timer_handler,&b);
+	b.timerstart=timestamp();
+	loop_timer_set(timerfd,BENCH_TIMER_US/1000,BENCH_TIMER_US/1000);
+	t0=timestamp();
+	loop_run(&b.loop);
+	t1=timestamp();
+	waitpid(pid,NULL,0);
+	printf("%d pipe events, %d timer ticks in %.2f s, %lu wakeups (%.1f events per wakeup)\n",
+		b.events,b.ticks,t1-t0,b.loop.wakeups,(b.events+b.ticks)/(double)b.loop.wakeups);
+	bench_percentiles("pipes",b.latency,b.events);
+	bench_percentiles("timer",b.timerlatency,(b.ticks<BENCH_EVENTS)?b.ticks:BENCH_EVENTS-1);
+	loop_close(&b.loop);
+	free(b.latency);
+	free(b.timerlatency);
+	return RETVAL_OK;
+}
+// the key-to-photon latency, without the hardware: another process presses
+// and releases random keys, and the pins of the display are simulated with
+// the cost of a real transport. everything in between is the same as usual.
+const char* flushpolicies[3]={"deferred","immediate","tick"};
+// a key trace from keytest.app -r. the events get the time at which they
+// are to be injected, relative to the start.
+int keytrace_load(const char* path,tInjectedKey** events,int* num,int* initial)
+{
+	unsigned char header[KEYTRACE_HEADER];
+	unsigned char record[KEYTRACE_RECORD];
+	struct stat st;
+	double t;
+	FILE* f;
+	int i;
+
+	f=fopen(path,"rb");
+	if (f==NULL || fstat(fileno(f),&st)<0 || fread(header,1,sizeof(header),f)!=sizeof(header) || memcmp(header,KEYTRACE_MAGIC,4)!=0)
+	{
+		fprintf(stderr,"%s is not a key trace\n",path);
+		if (f!=NULL) fclose(f);
+		return RETVAL_NOK;
+	}
+	*num=(st.st_size-KEYTRACE_HEADER)/KEYTRACE_RECORD;
+	*events=calloc(*num+1,sizeof(tInjectedKey));
+	if (*events==NULL)
+	{
+		fclose(f);
+		return RETVAL_NOK;
+	}
+	for (i=0;i<KEYS_NUM;i++)
+	{
+		initial[i]=(header[4]>>i)&1;
+	}
+	t=0;
+	for (i=0;i<*num && fread(record,1,sizeof(record),f)==sizeof(record);i++)
+	{
+		t+=(record[0]|(record[1]<<8)|(record[2]<<16)|((unsigned int)record[3]<<24))*1e-6;
+		(*events)[i].stamp=t;
+		(*events)[i].key=record[4]%KEYS_NUM;
+		(*events)[i].value=record[5]?1:0;
+	}
+	*num=i;
+	fclose(f);
+	return RETVAL_OK;
+}
+// the injector is another process, which sends the events through a pipe.
+// they are stamped with the time they have been sent. with fast set, they
+// are sent as fast as the pipe takes them.
+void inject_events(int fd,tInjectedKey* events,int num,int fast)
+{
+	double start;
+	int i;
+	start=timestamp();
+	for (i=0;i<num;i++)
+	{
+		tInjectedKey event;
+		event=events[i];
+		if (!fast)
+		{
+			double wait;
+			wait=start+event.stamp-timestamp();
+			if (wait>0) usleep(wait*1e6);
+		}
+		event.stamp=timestamp();
+		if (write(fd,&event,sizeof(event))!=sizeof(event)) break;
+	}
+}
+// without a trace, one key at a time is pressed and released, 10 to 40 ms apart
+int inject_random(tInjectedKey** events,int* num,int* initial)
+{
+	double t;
+	int key;
+	int i;
+	*num=LATENCY_EVENTS;
+	*events=calloc(*num,sizeof(tInjectedKey));
+	if (*events==NULL) return RETVAL_NOK;
+	for (i=0;i<KEYS_NUM;i++)
+	{
+		initial[i]=1;
+	}
+	srand(getpid());
+	key=0;
+	t=0;
+	for (i=0;i<*num;i++)
+	{
+		t+=(10000+rand()%30000)*1e-6;
+		if ((i%2)==0) key=rand()%KEYS_NUM;
+		(*events)[i].stamp=t;
+		(*events)[i].key=key;
+		(*events)[i].value=(i%2);	// the keys are low while they are pressed
+	}
+	return RETVAL_OK;
+}
+// one large update, and nothing else happening: with a budget, it takes
+// several flushes, and each one has to schedule the next one by itself.
+void bench_drain_stop(void* context,int fd,unsigned int events)
+{
+	loop_timer_ack(fd);
+	loop_stop((tLoop*)context);
+}
+int bench_drain()
+{
+	static tOledd d;
+	int retval;
+	int policy;
+	int i;
+
+	retval=RETVAL_OK;
+	gpio_simulated_ns=0;
+	for (policy=0;policy<3;policy++)
+	{
+		int fd;
+		int ok;
+		memset(&d,0,sizeof(d));
+		d.statefd=-1;
+		d.injectfd=-1;
+		d.flushpolicy=policy;
+		sched_init(&d.sched,BENCH_DRAIN_BUDGET);
+		if (loop_init(&d.loop)!=RETVAL_OK) return RETVAL_NOK;
+		d.flushtimer=loop_timer(&d.loop,oledd_flush_handler,&d);
+		d.memfd=sharedfb_create(&d.fb);
+		if (d.memfd<0) return RETVAL_NOK;
+		srand(1);
+		for (i=0;i<CANVAS_WIDTH*CANVAS_PAGES;i++)
+		{
+			d.fb->canvas[i]=rand()|1;	// every column differs from the empty shadow
+		}
+		__atomic_fetch_or(&d.fb->dirty,(1<<CANVAS_PAGES)-1,__ATOMIC_RELEASE);
+		oledd_dirty(&d);
+		fd=loop_timer(&d.loop,bench_drain_stop,&d.loop);
+		loop_timer_set(fd,BENCH_DRAIN_MS,0);
+		loop_run(&d.loop);
+		ok=(d.sched.pending==0 && memcmp(d.shadow,d.fb->canvas,sizeof(d.shadow))==0);
+		printf("one update of all pages, %d bytes per flush, %-9s flushes: %lu flushes, pending 0x%02x, %s\n",
+			BENCH_DRAIN_BUDGET,flushpolicies[policy],d.sched.cycles,d.sched.pending,ok?"drained":"STUCK");
+		if (!ok) retval=RETVAL_NOK;
+		munmap(d.fb,sizeof(tSharedFB));
+		close(d.memfd);
+		close(fd);
+		close(d.flushtimer);
+		close(d.loop.epfd);
+	}
+	gpio_simulated_ns=-1;
+	return retval;
+}
+// the value file of a pretend reset pin. NULL removes it, as if unexported.
+void bench_state_rst(const char* root,const char* value)
+{
+	char path[MAXBUFLEN*2];
+	int fd;
+	snprintf(path,sizeof(path),"%s/gpio%d/value",root,PIN_RST);
+	if (value==NULL)
+	{
+		unlink(path);
+		return;
+	}
+	fd=open(path,O_WRONLY|O_CREAT|O_TRUNC,0600);
+	if (fd<0) return;
+	write(fd,value,strlen(value));
+	close(fd);
+}
+// a warm exit, and then everything which may happen before the next start.
+// only the first case may take over the display.
+int bench_state()
+{
+	const char* cases[5]={
+		"nothing happened in between",
+		"a cold start or another program removed the state",
+		"another program held the reset low",
+		"another program unexported the reset pin",
+		"the state file was damaged"
+	};
+	static tState state;
+	unsigned char shadow[CANVAS_PAGES*CANVAS_WIDTH];
+	char root[32];
+	char dir[MAXBUFLEN*2];
+	char path[MAXBUFLEN*2];
+	int retval;
+	int fd;
+	int c;
+
+	snprintf(root,sizeof(root),"/tmp/oledd.XXXXXX");
+	if (mkdtemp(root)==NULL) return RETVAL_NOK;
+	snprintf(dir,sizeof(dir),"%s/gpio%d",root,PIN_RST);
+	mkdir(dir,0700);
+	snprintf(path,sizeof(path),"%s/state",root);
+	for (c=0;c<(int)sizeof(shadow);c++)
+	{
+		shadow[c]=c*7;
+	}
+	retval=RETVAL_OK;
+	for (c=0;c<5;c++)
+	{
+		int warm;
+		// every case starts from a warm exit, with the reset pin high
+		bench_state_rst(root,"1\n");
+		fd=open(path,O_WRONLY|O_CREAT|O_TRUNC,0600);
+		if (fd<0) break;
+		state_save(fd,shadow);
+		close(fd);
+		switch (c)
+		{
+			case 1:	state_forget(path);break;
+			case 2:	bench_state_rst(root,"0\n");break;
+			case 3:	bench_state_rst(root,NULL);break;
+			case 4:
+				fd=open(path,O_WRONLY);
+				pwrite(fd,"x",1,offsetof(tState,canvas));
+				close(fd);
+				break;
+		}
+		warm=state_valid(path,&state,root);
+		if (warm && memcmp(state.canvas,shadow,sizeof(shadow))) warm=0;
+		if (warm!=(c==0)) retval=RETVAL_NOK;
+		printf("warm exit, %-50s next start: %s   %s\n",cases[c],warm?"warm":"cold",(warm==(c==0))?"ok":"WRONG");
+	}
+	bench_state_rst(root,NULL);
+	unlink(path);
+	rmdir(dir);
+	rmdir(root);
+	return retval;
+}
+
+int latency_measure(tOledd* d,int dimafter,int offafter,int contrast,int load,const char* replay,int fast)
+{
+	tInjectedKey* events;
+	int initial[KEYS_NUM];
+	int num;
+	int fds[2];
+	pid_t pid;
+	int i;
+
+	if (replay!=NULL)
+	{
+		if (keytrace_load(replay,&events,&num,initial)!=RETVAL_OK) return RETVAL_NOK;
+	} else {
+		if (inject_random(&events,&num,initial)!=RETVAL_OK) return RETVAL_NOK;
+	}
+	d->latencymax=num;
+	d->latencies=calloc(num+1,sizeof(double));
+	if (d->latencies==NULL) return RETVAL_NOK;
+	d->memfd=sharedfb_create(&d->fb);
+	if (d->memfd<0 || pipe(fds)<0) return RETVAL_NOK;
+	pid=fork();
+	if (pid==0)
+	{
+		close(fds[0]);
+		inject_events(fds[1],events,num,fast);
+		exit(0);
+	}
+	close(fds[1]);
+	d->injectfd=fds[0];
+	for (i=0;i<KEYS_NUM;i++)
+	{
+		d->injected[i]=initial[i];
+		d->lastval[i]=initial[i];
+	}
+	loop_add(&d->loop,d->injectfd,EPOLLIN,oledd_inject_handler,d);
+	d->idletimer=loop_timer(&d->loop,oledd_idle_handler,d);
+	d->clocktimer=loop_timer(&d->loop,oledd_clock_handler,d);
+	idle_init(&d->idle,dimafter,offafter,contrast);
+	stats_init(&d->stats,0);
+	d->started=timestamp();
+	screen_line(d,0,"----------------",0);
+	screen_line(d,1,"-     oledd    -",0);
+	screen_line(d,2,"----------------",0);
+	screen_line(d,3,(replay!=NULL)?"replay":"latency",0);
+	// the keys are what is being measured, so they are urgent
+	d->sched.priority[5]=d->sched.priority[6]=SCHED_PRIO_CLOCK;
+	if (load)
+	{
+		int fd;
+		fd=loop_timer(&d->loop,oledd_load_handler,d);
+		loop_timer_set(fd,LOAD_INTERVAL_MS,LOAD_INTERVAL_MS);
+	}
+	printf("%d key events%s, %d ns per pin change, %s flushes",num,(replay==NULL)?"":fast?" from the trace, as fast as possible":" from the trace",
+		gpio_simulated_ns,flushpolicies[d->flushpolicy]);
+	if (d->sched.budget) printf(", %d bytes per flush",d->sched.budget);
+	printf("%s\n",load?", with load":"");
+	loop_run(&d->loop);
+	waitpid(pid,NULL,0);
+	bench_percentiles("keys",d->latencies,d->latencynum);
+	printf("%d key presses shown, %lu wakeups, %ld writes to the pins\n",d->presses,d->loop.wakeups,gpio_simulated_writes);
+	stats_report(&d->stats,d->loop.wakeups,1);
+	sched_report(&d->sched);
+	free(events);
+	return RETVAL_OK;
+}
+
+int main(int argc,char** argv)
+{
+	int pins[KEYS_NUM];
+	tOledd* d=&oledd;
+	const char* control;
+	const char* socketpath;
+	const char* statepath;
+	tState state;
+	int warm;
+	int edges;
+	int dimafter;
+	int offafter;
+	int contrast;
+	int orientation;
+	int latency;
+	const char* replay;
+	int fast;
+	int load;
+	int budget;
+	int bench;
+	int opt;
+	int i;
+
+	memset(d,0,sizeof(tOledd));
+	d->injectfd=-1;
+	d->flushpolicy=FLUSH_DEFERRED;
+	latency=0;
+	replay=NULL;
+	fast=0;
+	load=0;
+	budget=0;
+	bench=0;
+	if (BOARD_DEFAULT>=0) board_select(boards[BOARD_DEFAULT].name);
+	orientation=ORIENT_0;
+	dimafter=IDLE_DIM_SECONDS;
+	offafter=IDLE_OFF_SECONDS;
+	contrast=OLED_CONTRAST_DIMMED;
+	control=OLEDD_CONTROL;
+	socketpath=OLEDD_SOCKET;
+	statepath=NULL;
+	d->statefd=-1;
+	while ((opt=getopt(argc,argv,"pd:o:c:f:s:r:tF:B:l:ak:K:wW:b"))!=-1)
+	{
+		switch (opt)
+		{
+			case 'p':	d->busypoll=1;break;
+			case 'd':	dimafter=atoi(optarg);break;
+			case 'o':	offafter=atoi(optarg);break;
+			case 'c':	contrast=strtol(optarg,NULL,0)&0xff;break;
+			case 'f':	control=optarg;break;
+			case 's':	socketpath=optarg;break;
+			case 'w':	statepath=OLEDD_STATE;break;
+			case 'W':
+				if (board_select(optarg)<0)
+				{
+					fprintf(stderr,"unknown board %s\n",optarg);
+					return 1;
+				}
+				break;
+			case 't':
+				gpio_trace=malloc(sizeof(tTrace));
+				if (gpio_trace==NULL) return 1;
+				memset(gpio_trace,0,sizeof(tTrace));
+				break;
+			case 'r':
+				if (strcmp(optarg,"0")==0) orientation=ORIENT_0;
+				else if (strcmp(optarg,"180")==0) orientation=ORIENT_180;
+				else if (strcmp(optarg,"mirrorx")==0) orientation=ORIENT_FLIPX;
+				else if (strcmp(optarg,"mirrory")==0) orientation=ORIENT_FLIPY;
+				else {
+					fprintf(stderr,"unknown orientation %s\n",optarg);
+					return 1;
+				}
+				break;
+			case 'F':
+				for (i=0;i<3 && strcmp(optarg,flushpolicies[i]);i++);
+				if (i==3)
+				{
+					fprintf(stderr,"unknown flush policy %s\n",optarg);
+					return 1;
+				}
+				d->flushpolicy=i;
+				break;
+			case 'l':
+				latency=1;
+				if (strcmp(optarg,"sysfs")==0) gpio_simulated_ns=TRANSPORT_SYSFS_NS;
+				else if (strcmp(optarg,"chardev")==0) gpio_simulated_ns=TRANSPORT_CHARDEV_NS;
+				else if (strcmp(optarg,"mmap")==0) gpio_simulated_ns=TRANSPORT_MMAP_NS;
+				else gpio_simulated_ns=atoi(optarg);
+				break;
+			case 'B':	budget=atoi(optarg);break;
+			case 'a':	load=1;break;
+			case 'k':	replay=optarg;latency=1;break;
+			case 'K':	replay=optarg;latency=1;fast=1;break;
+			case 'b':	bench=1;break;
+			default:
+				fprintf(stderr,"usage: %s [-p] [-d seconds] [-o seconds] [-c contrast] [-f fifo] [-s socket] [-r orientation] [-t] [-F policy] [-B bytes] [-w] [-W board] [-b] [-l transport [-a]] [-k|-K file]\n",argv[0]);
+				fprintf(stderr,"  -p          poll the keys in a busy loop, like keytest (for comparison)\n");
+				fprintf(stderr,"  -d seconds  dim the panel after this idle time (default %d)\n",IDLE_DIM_SECONDS);
+				fprintf(stderr,"  -o seconds  turn the panel off after this idle time (default %d)\n",IDLE_OFF_SECONDS);
+				fprintf(stderr,"  -c contrast contrast while dimmed (default 0x%02x)\n",OLED_CONTRAST_DIMMED);
+				fprintf(stderr,"  -f fifo     control fifo (default %s)\n",OLEDD_CONTROL);
+				fprintf(stderr,"  -s socket   where the clients get the framebuffer (default %s)\n",OLEDD_SOCKET);
+				fprintf(stderr,"  -r orientation  0, 180, mirrorx or mirrory\n");
+				fprintf(stderr,"  -t          trace the last %d pin changes. \"trace <file>\" writes them as VCD\n",TRACE_SIZE);
+				fprintf(stderr,"  -F policy   when to flush: deferred (after the events, default), immediate or tick (%d ms)\n",FLUSH_TICK_MS);
+				fprintf(stderr,"  -B bytes    send at most this many bytes per flush. the rest waits for the next one,\n");
+				fprintf(stderr,"              the lines with the highest priority and the oldest changes first\n");
+				fprintf(stderr,"  -w          warm restart: keep the display running when quitting, and\n");
+				fprintf(stderr,"              take over from the last instance (state in %s)\n",OLEDD_STATE);
+				fprintf(stderr,"  -W board    %s, instead of the one from the sourcecode\n",BOARD_NAMES);
+				fprintf(stderr,"  -b          benchmark the event loop, and check the warm restart state (does not need the display)\n");
+				fprintf(stderr,"  -l transport  measure the key-to-photon latency with synthetic keys and a simulated\n");
+				fprintf(stderr,"              transport: sysfs, chardev, mmap or ns per pin change (does not need the display)\n");
+				fprintf(stderr,"  -k file     replay a key trace from keytest.app -r at the speed it was recorded,\n");
+				fprintf(stderr,"              with the transport of -l (default: no time for the pins). does not need the display\n");
+				fprintf(stderr,"  -K file     replay a key trace as fast as possible\n");
+				fprintf(stderr,"  -a          with -l: redraw the upper half of the display every %d ms, as a load\n",LOAD_INTERVAL_MS);
+				return 1;
+		}
+	}
+	// without the display, the pins are only simulated. any board will do.
+	if (physicalmapping==NULL && (bench || latency)) board_select(boards[BOARD_BENCH].name);
+	if (physicalmapping==NULL)
+	{
+		fprintf(stderr,BOARD_MISSING,"-W");
+		return 1;
+	}
+	if (bench) return (bench_loop()|bench_drain()|bench_state())?1:0;
+	pins[0]=PIN_LEFT;
+	pins[1]=PIN_UP;
+	pins[2]=PIN_FIRE;
+	pins[3]=PIN_DOWN;
+	pins[4]=PIN_RIGHT;
+	pins[5]=PIN_KEY1;
+	pins[6]=PIN_KEY2;
+	pins[7]=PIN_KEY3;
+	if (offafter<dimafter) offafter=dimafter;
+	sched_init(&d->sched,budget);
+	d->sched.priority[7]=SCHED_PRIO_CLOCK;
+
+	signal(SIGINT, graceFulExit);
+	signal(SIGTERM, graceFulExit);
+	if (loop_init(&d->loop)!=RETVAL_OK) return 1;
+	d->flushtimer=loop_timer(&d->loop,oledd_flush_handler,d);
+	if (latency)
+	{
+		if (gpio_simulated_ns<0) gpio_simulated_ns=0;
+		return latency_measure(d,dimafter,offafter,contrast,load,replay,fast)?1:0;
+	}
+	warm=(statepath!=NULL && state_valid(statepath,&state,"/sys/class/gpio"));
+	if (warm && state.panel.orientation!=orientation)
+	{
+		printf("the orientation has changed, starting cold\n");
+		warm=0;
+	}
+	if (!warm) state_forget(OLEDD_STATE);	// the reset clears the display RAM
+	if (sh1106_up(warm))
+	{
+		fprintf(stderr,"unable to start up display. sorry");
+		return 1;
+	}
+	if (!warm) oled_orientation(orientation);
+	edges=1;
+	for (i=0;i<KEYS_NUM;i++)
+	{
+		d->pins[i]=pins[i];
+		if (!d->busypoll && gpio_edge(pins[i],"both")!=RETVAL_OK) edges=0;
+		d->keyfds[i]=gpio_open_value(pins[i]);
+		if (d->keyfds[i]<0)
+		{
+			graceFulExit(0);
+		}
+		gpio_read_fd(d->keyfds[i],&d->lastval[i]);
+	}
+	if (d->busypoll)
+	{
+		loop_schedule(&d->loop,oledd_busypoll,d);
+	} else if (edges) {
+		for (i=0;i<KEYS_NUM;i++)
+		{
+			loop_add(&d->loop,d->keyfds[i],EPOLLPRI|EPOLLERR,oledd_key_handler,d);
+		}
+	} else {
+		int fd;
+		fprintf(stderr,"no edge interrupts on the keys. polling every %d ms instead\n",IDLE_FALLBACK_MS);
+		fd=loop_timer(&d->loop,oledd_keypoll_handler,d);
+		loop_timer_set(fd,IDLE_FALLBACK_MS,IDLE_FALLBACK_MS);
+	}
+	oledd_control_open(d,control);
+	if (oledd_socket_open(d,socketpath)!=RETVAL_OK)
+	{
+		graceFulExit(0);
+	}
+	if (warm)
+	{
+		// the display still shows the old content. it becomes the starting
+		// point, and only the differences will be sent.
+		printf("warm start\n");
+		memcpy(d->shadow,state.canvas,sizeof(d->shadow));
+		memcpy(d->fb->canvas,state.canvas,sizeof(d->shadow));
+		panel=state.panel;
+		if (panel.contrast!=OLED_CONTRAST_NORMAL) oled_contrast(OLED_CONTRAST_NORMAL);
+		if (!panel.power) oled_power(1);
+	} else {
+		oled_flush(d->shadow);		// whatever was in the display RAM is gone now
+	}
+	if (statepath!=NULL)
+	{
+		d->statefd=open(statepath,O_WRONLY|O_CREAT|O_CLOEXEC,0600);
+		if (d->statefd<0) fprintf(stderr,"Unable to write the state to %s\n",statepath);
+		d->savedpanel=panel;
+		state_save(d->statefd,d->shadow);
+	}
+	d->idletimer=loop_timer(&d->loop,oledd_idle_handler,d);
+	d->clocktimer=loop_timer(&d->loop,oledd_clock_handler,d);
+	d->loop.after=oledd_after;
+	d->loop.aftercontext=d;
+
+	idle_init(&d->idle,dimafter,offafter,contrast);
+	stats_init(&d->stats,0);
+	d->started=timestamp();
+	screen_line(d,0,"----------------",0);
+	screen_line(d,1,"-     oledd    -",0);
+	screen_line(d,2,"----------------",0);
+	screen_line(d,3,d->busypoll?"busy polling":"waiting for keys",0);
+
+	loop_run(&d->loop);
+	graceFulExit(0);
+
+	return 0;	
+}
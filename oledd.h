@@ -0,0 +1,44 @@
+/*
+MIT No Attribution
+
+Copyright 2022 Thomas Dettbarn (dettus@dettus.net)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this
+software and associated documentation files (the "Software"), to deal in the Software
+without restriction, including without limitation the rights to use, copy, modify,
+merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+// what oledd.c and its clients (oledclient.c) have to agree on: where the
+// daemon listens, and the layout of the shared framebuffer. the other
+// programs use it to remove the state of a warm restart.
+#ifndef	OLEDD_H
+#define	OLEDD_H
+
+#define	OLEDD_SOCKET	"/run/oledd.sock"
+#define	OLEDD_STATE	"/run/oledd.state"	// for the warm restart. whoever resets the display removes it
+#define	SHAREDFB_MAGIC	0x4f4c4544	// "OLED"
+#define	SHAREDFB_WIDTH	128
+#define	SHAREDFB_PAGES	8
+
+// the framebuffer is shared with the clients. it is in the same page format
+// as the display RAM: one byte is a column of 8 pixels, bit 0 on top.
+// clients draw into the canvas, set the bits of the pages they have changed
+// in dirty, and write to the eventfd. (see oledclient.c)
+typedef struct _tSharedFB
+{
+	unsigned int magic;
+	unsigned int width;
+	unsigned int pages;
+	unsigned int dirty;		// one bit per page. only to be changed with atomic operations
+	unsigned char canvas[SHAREDFB_PAGES*SHAREDFB_WIDTH];
+} tSharedFB;
+#endif
@@ -32,6 +32,30 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <unistd.h>
 #include <sys/types.h>
 #include <fcntl.h>
+#include <string.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <poll.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#include <linux/sockios.h>
+#include <linux/fb.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+#include "oledd.h"
 
 #define	RETVAL_OK	0
 #define	RETVAL_NOK	-1
@@ -51,101 +75,98 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #define	SPI_LSBFIRST	0
 #define	SPI_MSBFIRST	1
-#define SPI_DELAY	//DELAY_US(1)
+#define SPI_DELAY	do {} while (0)	//DELAY_US(1)
+
+#define	WAVE_MOSI	0x00	// a step of a waveform: bit 1 is the pin, bit 0 the level
+#define	WAVE_SCLK	0x02
+#define	WAVE_MAXSTEPS	25	// 8 bits with 3 steps each, and the clock back to idle
+
+#define	GPIO_SYSFS_OPEN		0	// open, write, close for every pin change
+#define	GPIO_SYSFS_FD		1	// the value files are kept open
+#define	GPIO_SYSFS_URING	2	// the writes are queued, and submitted in batches
+#define	GPIO_MAXPINS		512
+#define	URING_ENTRIES		4096	// more than a page of pin changes
+
+#define	TRACE_SIZE	65536	// pin changes in the trace ring, a power of 2
+
+#define	TXN_COMMAND	0
+#define	TXN_DATA	1
+#define	TXN_MAXLEN	2048
+#define	TXN_MAXRUNS	64
+
+#define	OLED_COLUMN_OFFSET	2	// the SH1106 has 132 columns of RAM, the panel shows columns 2..129
+#define	OLED_RAM_COLUMNS	132
+
+#define	ORIENT_FLIPX		1	// segment remap, done by the controller
+#define	ORIENT_FLIPY		2	// reversed COM scan, done by the controller
+#define	ORIENT_PORTRAIT		4	// rotated by 90 degrees in software
+#define	ORIENT_0		0
+#define	ORIENT_180		(ORIENT_FLIPX|ORIENT_FLIPY)
+#define	ORIENT_90		ORIENT_PORTRAIT
+#define	ORIENT_270		(ORIENT_PORTRAIT|ORIENT_180)
+
+#define	PORTRAIT_WIDTH		64
+#define	PORTRAIT_PAGES		16
 
 #define	BITMAP_HEIGHT	64
 #define	BITMAP_WIDTH	128
 
+#define	CANVAS_WIDTH	128
+#define	CANVAS_PAGES	8
+
+#define	SPRITE_MAXWIDTH		32
+#define	SPRITE_MAXHEIGHT	32
+#define	SPRITE_MAXPAGES		((SPRITE_MAXHEIGHT+7)/8+1)
+#define	SPRITE_SHIFTS		8
+
+#define	BLIT_OR		0	// set the pixels of the sprite
+#define	BLIT_ANDNOT	1	// clear the pixels of the sprite
+#define	BLIT_XOR	2	// toggle the pixels of the sprite
+#define	BLIT_MASKED	3	// replace the pixels under the mask with the sprite
+
+#define	LAYER_MAX	8
+
+#define	LANES_MAX	8	// panels which share SCLK, each with its own MOSI
+
+#define	CHART_MAXSAMPLES	128	// at least as many as the widest chart
+#define	GAUGE_MAXBARS		16
+#define	GAUGE_MAXWIDTH		32
+
+#define	DITHER_THRESHOLD	0
+#define	DITHER_BAYER		1
+#define	DITHER_FLOYD		2	// Floyd-Steinberg
+#define	DITHER_ATKINSON		3
+
+#define	OLED_CLOCK_NORMAL	0x80	// about 100 frames/sec
+#define	OLED_CLOCK_FAST		0xf0	// fastest oscillator, no divider
+
+#define	STREAM_BUFLEN		65536
+#define	STREAM_MAXWIDTH		4096	// wider frames are not accepted. only the top left 128x64 pixels are shown
+
+#define	MIRROR_TILES		(CANVAS_WIDTH/8)	// per page. a tile is 8x8 pixels of the display
+#define	MIRROR_POLL_MS		20
+#define	MIRROR_REPORT		10	// seconds between the statistics
+
+#define	NET_MAGIC		0xf5
+#define	NET_MAXMSG		4096
+#define	NET_MAXRUN		128
+#define	NET_MAXGAP		3	// unchanged columns which are sent along, instead of starting a new span
+#define	NET_MAXINFLIGHT		NET_MAXMSG	// bytes on their way to the receiver, before frames are skipped
+#define	NET_BENCHPORT		47110
+
+#define	GRAY_MAXBITS		3
+#define	GRAY_MAXSLOTS		((1<<GRAY_MAXBITS)-1)
+#define	GRAY_FLICKER_HZ		50	// below this, the cycling becomes visible
+#define	GRAY_SPIN		200e-6	// the last bit of every slot is busy-waited, sleeping is not precise enough
+
 
 //// depends on the development board
 
 // the way I understand this is, that the physical pins are mapped into
 // the system memory. to accces those, there is some sort of memory
 // offset maybe
-#if defined(PINOUT_JETSONNANO)
-#warning "This mapping is for the Jetson Nano board."
-// Jetson Nano
-// source: https://maker.pro/nvidia-jetson/tutorial/how-to-use-gpio-pins-on-jetson-nano-developer-kit
-const short physicalmapping[41]={
-	0,	// placeholder. there is no PIN0
-	 -1, -1,// PIN1 =3.3V DC, PIN2 =5V DC
-	 -1, -1,// 3,4
-	 -1, -1,// 5,6
-	216, -1, //PIN7 = AUDIO_MCLK
-	 -1, -1, //9,10
-	 50, 79, //PIN11=UART_2_RTS,PIN12=I2S_4_CLK
-	 14, -1, //13,14
-	194,232, //15,16
-	 -1, 15, //17,18
-	 16, -1, //19,20
-	 17, 13, //21,22
-	 18, 19, //23,24
-	 -1, 20, //25,26
-	 -1, -1, //27,28
-	149, -1, //29,30
-	200,168, //31,32
-	 38, -1, //33,34
-	 76, 51, //35,36
-	 12, 77, //37,38
-	 -1, 78  //39,40
-};
-#elif defined(PINOUT_BANANAPI)
-#warning "This mapping is for the Banana Pi board."
-// source: https://wiki.fw-web.de/doku.php?id=en:bpi-r64:gpio
-const short physicalmapping[41]={
-	0,	// placeholder. there is no PIN0
-	 -1, -1,// PIN1 =3.3V DC, PIN2 =5V DC
-	 56, -1,// 3,4
-	 55, -1,// 5,6
-	101, 59, //PIN7 = PWM7,8
-	 -1, 60,// 9,10
-	 51, -1, //PIN11=UART_2_RTS,PIN12=I2S_4_CLK
-	 52, -1, //13,14
-	 98, 61, //15,16
-	 -1, 62, //17,18
-	 68, -1, //19,20
-	 69, 63, //21,22
-	 67, 70, //23,24
-	 -1, 66, //25,26
-	 58, 57, //27,28
-	 85, -1, //29,30
-	 82, 64, //31,32
-	 -1, -1, //33,34
-	 -1, 65, //35,36
-	 86, -1, //37,38
-	 -1, -1  //39,40
-};
-#elif defined(PINOUT_RASPBERRYPI) 
-#warning "This mapping is for the Raspberry Pi (Zero) board"
-// source: https://www.theengineeringprojects.com/wp-content/uploads/2021/03/raspberry-pi-zero-5.png
-// NOTE: GPIO16 was actually missing in the diagram.
-const short physicalmapping[41]={
-	0,	// placeholder. there is no PIN0
-	 -1, -1,// PIN1 =3.3V DC, PIN2 =5V DC
-	  2, -1,// 3,4
-	  3, -1,// 5,6
-	  4, 14, //PIN7 = PWM7,8
-	 -1, 15,// 9,10
-	 17, 18, //PIN11=UART_2_RTS,PIN12=I2S_4_CLK
-	 27, -1, //13,14
-	 22, 23, //15,16
-	 -1, 24, //17,18
-	 10, -1, //19,20
-	  9, 25, //21,22
-	 11,  8, //23,24
-	 -1,  7, //25,26
-	  0,  1, //27,28
-	  5, -1, //29,30
-	  6, 12, //31,32
-	 13, -1, //33,34
-	 19, 16, //35,36	
-	 26, 20, //37,38
-	 -1, 21  //39,40
-};
-#else
-#error "The physical pins need to be mapped to the GPIO numbers. For some reason, those numbers are different for each board out there. So please have a look at the sourcecode, lines 21-26, and select the one that works best for you."
-const int physicalmapping[41]={0};
-#endif
+//
+#include "boards.h"
 
 // this is the GPIO pinout for the waveshare OLED 1.3 SH1106 hat
 // source: https://www.waveshare.com/1.3inch-oled-hat.htm
@@ -254,11 +275,420 @@ int gpio_direction(int pin,int direction)
 	
 	return RETVAL_OK;
 }
+// the trace remembers the last TRACE_SIZE pin changes with a timestamp, in a
+// ring. writing to it is one atomic increment and a few stores, so it can
+// stay on while the display is running. the ring can then be written as a VCD
+// file, and looked at with GTKWave.
+typedef struct _tTraceEvent
+{
+	unsigned long long ns;
+	int pin;
+	int value;
+} tTraceEvent;
+typedef struct _tTrace
+{
+	unsigned long head;	// the number of events so far. the ring has the last TRACE_SIZE of them
+	tTraceEvent events[TRACE_SIZE];
+} tTrace;
+tTrace* gpio_trace=NULL;
+
+void trace_record(tTrace* trace,int pin,int value)
+{
+	struct timespec ts;
+	tTraceEvent* ev;
+	unsigned long idx;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	idx=__atomic_fetch_add(&trace->head,1,__ATOMIC_RELAXED);
+	ev=&trace->events[idx&(TRACE_SIZE-1)];
+	ev->ns=ts.tv_sec*1000000000ULL+ts.tv_nsec;
+	ev->pin=pin;
+	ev->value=value;
+}
+int trace_vcd(tTrace* trace,const char* path)
+{
+	const struct
+	{
+		int pin;
+		const char* name;
+	} signals[]={
+		{PIN_MOSI,"mosi"},{PIN_SCLK,"sclk"},{PIN_DC,"dc"},{PIN_CS,"cs"},{PIN_RST,"rst"},{PIN_BL,"bl"}
+	};
+	#define	TRACE_SIGNALS	((int)(sizeof(signals)/sizeof(signals[0])))
+	unsigned long head;
+	unsigned long first;
+	unsigned long long start;
+	unsigned long long last;
+	unsigned long i;
+	int s;
+	FILE* f;
+
+	head=__atomic_load_n(&trace->head,__ATOMIC_ACQUIRE);
+	first=(head>TRACE_SIZE)?head-TRACE_SIZE:0;
+	if (first==head)
+	{
+		fprintf(stderr,"the trace is empty\n");
+		return RETVAL_NOK;
+	}
+	f=fopen(path,"w");
+	if (f==NULL)
+	{
+		fprintf(stderr,"unable to write the trace to %s\n",path);
+		return RETVAL_NOK;
+	}
+	start=trace->events[first&(TRACE_SIZE-1)].ns;
+	fprintf(f,"$comment %lu pin changes, %lu lost before the start of the ring $end\n",head-first,first);
+	fprintf(f,"$timescale 1ns $end\n");
+	fprintf(f,"$scope module sh1106 $end\n");
+	for (s=0;s<TRACE_SIGNALS;s++)
+	{
+		fprintf(f,"$var wire 1 %c %s $end\n",'A'+s,signals[s].name);
+	}
+	fprintf(f,"$upscope $end\n");
+	fprintf(f,"$enddefinitions $end\n");
+	fprintf(f,"#0\n$dumpvars\n");
+	for (s=0;s<TRACE_SIGNALS;s++)
+	{
+		fprintf(f,"x%c\n",'A'+s);	// unknown until the first write
+	}
+	fprintf(f,"$end\n");
+	last=0;
+	for (i=first;i<head;i++)
+	{
+		tTraceEvent* ev;
+		ev=&trace->events[i&(TRACE_SIZE-1)];
+		for (s=0;s<TRACE_SIGNALS;s++)
+		{
+			if (signals[s].pin==ev->pin) break;
+		}
+		if (s==TRACE_SIGNALS) continue;
+		if (ev->ns-start!=last)
+		{
+			last=ev->ns-start;
+			fprintf(f,"#%llu\n",last);
+		}
+		fprintf(f,"%d%c\n",ev->value?1:0,'A'+s);
+	}
+	fclose(f);
+	printf("%lu pin changes written to %s\n",head-first,path);
+	return RETVAL_OK;
+}
+// where column 0 of the canvas is in the display RAM. it changes with the segment remap.
+int oled_columnoffset=OLED_COLUMN_OFFSET;
+
+// what the SH1106 would make of the pin changes: the bytes are clocked in
+// on the rising edge of SCLK, and the data bytes end up in the display RAM.
+// this way, a benchmark can check what would be on the display.
+typedef struct _tDisplayModel
+{
+	int mosi;
+	int sclk;
+	int dc;
+	int bits;
+	unsigned char byte;
+	int skip;		// the argument of the last command is still to come
+	int page;
+	int column;
+	int startline;		// the RAM row which is shown at the top
+	unsigned char ram[CANVAS_PAGES][OLED_RAM_COLUMNS];
+} tDisplayModel;
+
+void model_byte(tDisplayModel* model,unsigned char byte)
+{
+	if (model->dc)
+	{
+		if (model->page<CANVAS_PAGES && model->column<OLED_RAM_COLUMNS) model->ram[model->page][model->column]=byte;
+		model->column++;
+	}
+	else if (model->skip) model->skip=0;
+	else if (byte<=0x0f) model->column=(model->column&0xf0)|byte;
+	else if (byte<=0x1f) model->column=(model->column&0x0f)|((byte&0x0f)<<4);
+	else if (byte>=0x40 && byte<=0x7f) model->startline=byte&0x3f;
+	else if (byte>=0xb0 && byte<=0xb7) model->page=byte&7;
+	else if (byte==0x81 || byte==0xa8 || byte==0xd3 || byte==0xd5 || byte==0xd9 || byte==0xda || byte==0xdb || byte==0xad) model->skip=1;
+}
+// the levels of the pins which matter. the bits are taken on the rising edge of SCLK, MSB first.
+void model_levels(tDisplayModel* model,int mosi,int sclk,int dc)
+{
+	model->dc=dc;
+	model->mosi=mosi;
+	if (sclk && !model->sclk)
+	{
+		model->byte=(model->byte<<1)|(model->mosi?1:0);
+		if (++model->bits==8)
+		{
+			model_byte(model,model->byte);
+			model->bits=0;
+		}
+	}
+	model->sclk=sclk;
+}
+void model_pin(tDisplayModel* model,int pin,int value)
+{
+	if (pin==PIN_DC) model_levels(model,model->mosi,model->sclk,value);
+	else if (pin==PIN_MOSI) model_levels(model,value,model->sclk,model->dc);
+	else if (pin==PIN_SCLK) model_levels(model,model->mosi,value,model->dc);
+}
+// the visible part of the display RAM
+void model_canvas(tDisplayModel* model,unsigned char* canvas)
+{
+	int page;
+	int x;
+	for (x=0;x<CANVAS_WIDTH;x++)
+	{
+		unsigned long long column;
+		column=0;
+		for (page=0;page<CANVAS_PAGES;page++)
+		{
+			column|=(unsigned long long)model->ram[page][x+oled_columnoffset]<<(8*page);
+		}
+		// the start line scrolls the RAM rows around
+		if (model->startline) column=(column>>model->startline)|(column<<(64-model->startline));
+		for (page=0;page<CANVAS_PAGES;page++)
+		{
+			canvas[page*CANVAS_WIDTH+x]=column>>(8*page);
+		}
+	}
+}
+
+// for the benchmarks, gpio_write() can record the pin changes in memory,
+// instead of writing them to the sysfs files.
+typedef struct _tGpioRecorder
+{
+	int num;
+	int max;
+	int* pins;
+	unsigned char* values;
+	int fd;			// when >=0, every write is also written to this fd, to get the cost of a syscall
+	tDisplayModel* model;	// when not NULL, the pin changes go into the model as well
+} tGpioRecorder;
+tGpioRecorder* gpio_recorder=NULL;
+int wave_mosi=-1;		// the current level of MOSI, -1 when unknown
+
+// the sysfs transport. the way it started, every pin change opens the value
+// file, writes it and closes it again: 3 syscalls. the file descriptors can
+// be kept open instead, and then it is one pwrite(). with io_uring, the
+// writes are queued as linked requests, which the kernel carries out strictly
+// one after the other, and a whole page goes out with one io_uring_enter().
+typedef struct _tUring
+{
+	int fd;
+	unsigned int entries;
+	unsigned int* sqhead;
+	unsigned int* sqtail;
+	unsigned int* sqmask;
+	unsigned int* sqarray;
+	unsigned int* cqhead;
+	unsigned int* cqtail;
+	unsigned int* cqmask;
+	struct io_uring_cqe* cqes;
+	struct io_uring_sqe* sqes;
+	struct io_uring_sqe* last;	// the end of the chain
+	unsigned int queued;
+	int batching;			// >0 between gpio_batch_begin() and gpio_batch_end()
+	unsigned char bufs[URING_ENTRIES][2];	// the data has to stay where it is until the write is done
+} tUring;
+
+int gpio_transport=GPIO_SYSFS_OPEN;
+const char* gpio_root="/sys/class/gpio";
+int gpio_valuefds[GPIO_MAXPINS];	// the fd+1, so that 0 means not open yet
+int gpio_logfd=-1;			// for the benchmark: every write goes to this file, as pin and value
+tUring gpio_uring;
+long gpio_syscalls=0;
+
+int gpio_valuefd(int pin)
+{
+	char buffer[MAXBUFLEN];
+	if (gpio_logfd>=0) return gpio_logfd;
+	if (pin<0 || pin>=GPIO_MAXPINS) return -1;
+	if (gpio_valuefds[pin]==0)
+	{
+		snprintf(buffer,MAXBUFLEN,"%s/gpio%d/value",gpio_root,pin);
+		gpio_valuefds[pin]=open(buffer,O_WRONLY|O_CLOEXEC)+1;
+		if (gpio_valuefds[pin]==0) fprintf(stderr,"Cannot access GPIO pin %d\n",pin);
+	}
+	return gpio_valuefds[pin]-1;
+}
+void gpio_valuefds_close()
+{
+	int i;
+	for (i=0;i<GPIO_MAXPINS;i++)
+	{
+		if (gpio_valuefds[i]>0) close(gpio_valuefds[i]-1);
+		gpio_valuefds[i]=0;
+	}
+	wave_mosi=-1;
+}
+// hands the queued writes to the kernel, and waits until all of them are done
+int uring_submit(tUring* ring)
+{
+	int retval;
+	unsigned int done;
+	retval=RETVAL_OK;
+	if (!ring->queued) return retval;
+	ring->last->flags&=~IOSQE_IO_LINK;
+	done=0;
+	while (done<ring->queued)
+	{
+		unsigned int head;
+		int n;
+		n=syscall(__NR_io_uring_enter,ring->fd,ring->queued-done,ring->queued-done,IORING_ENTER_GETEVENTS,NULL,0);
+		gpio_syscalls++;
+		if (n<0 && errno!=EINTR && errno!=EAGAIN && errno!=EBUSY)
+		{
+			fprintf(stderr,"io_uring_enter failed\n");
+			ring->queued=0;
+			return RETVAL_NOK;
+		}
+		head=*ring->cqhead;
+		while (head!=__atomic_load_n(ring->cqtail,__ATOMIC_ACQUIRE))
+		{
+			if (ring->cqes[head&*ring->cqmask].res<0) retval=RETVAL_NOK;	// the rest of the chain is cancelled
+			head++;
+			done++;
+		}
+		__atomic_store_n(ring->cqhead,head,__ATOMIC_RELEASE);
+	}
+	ring->queued=0;
+	if (retval!=RETVAL_OK) fprintf(stderr,"a queued GPIO write failed\n");
+	return retval;
+}
+int uring_write(tUring* ring,int fd,int pin,int value)
+{
+	struct io_uring_sqe* sqe;
+	unsigned int tail;
+	unsigned int idx;
+	unsigned char* buf;
+	if (ring->queued==ring->entries && uring_submit(ring)!=RETVAL_OK) return RETVAL_NOK;
+	tail=*ring->sqtail;
+	idx=tail&*ring->sqmask;
+	sqe=&ring->sqes[idx];
+	buf=ring->bufs[ring->queued];
+	buf[0]=pin;
+	buf[1]=value?'1':'0';
+	memset(sqe,0,sizeof(*sqe));
+	sqe->opcode=IORING_OP_WRITE;
+	sqe->flags=IOSQE_IO_LINK;
+	sqe->fd=fd;
+	sqe->addr=(unsigned long)((gpio_logfd>=0)?buf:&buf[1]);
+	sqe->len=(gpio_logfd>=0)?2:1;
+	sqe->off=0;
+	ring->sqarray[idx]=idx;
+	__atomic_store_n(ring->sqtail,tail+1,__ATOMIC_RELEASE);
+	ring->last=sqe;
+	ring->queued++;
+	return RETVAL_OK;
+}
+// io_uring came with 5.1, but IORING_OP_WRITE only with 5.6. so does the probe:
+// when it fails, the kernel is too old for the writes as well.
+int uring_supports(int fd,int opcode)
+{
+	struct
+	{
+		struct io_uring_probe probe;
+		struct io_uring_probe_op ops[256];
+	} p;
+	memset(&p,0,sizeof(p));
+	if (syscall(__NR_io_uring_register,fd,IORING_REGISTER_PROBE,&p,256)<0) return 0;
+	if (opcode>=p.probe.ops_len) return 0;
+	return (p.ops[opcode].flags&IO_URING_OP_SUPPORTED)?1:0;
+}
+// returns RETVAL_NOK when there is no io_uring (old kernel, or turned off), so that the caller can fall back
+int uring_init(tUring* ring,unsigned int entries)
+{
+	struct io_uring_params params;
+	unsigned char* sq;
+	unsigned char* cq;
+	size_t sqsize;
+	size_t cqsize;
+
+	memset(ring,0,sizeof(tUring));
+	memset(&params,0,sizeof(params));
+	ring->fd=syscall(__NR_io_uring_setup,entries,&params);
+	if (ring->fd<0) return RETVAL_NOK;
+	if (!uring_supports(ring->fd,IORING_OP_WRITE))
+	{
+		close(ring->fd);
+		return RETVAL_NOK;
+	}
+	sqsize=params.sq_off.array+params.sq_entries*sizeof(unsigned int);
+	cqsize=params.cq_off.cqes+params.cq_entries*sizeof(struct io_uring_cqe);
+	if (params.features&IORING_FEAT_SINGLE_MMAP)
+	{
+		if (cqsize>sqsize) sqsize=cqsize;
+		cqsize=sqsize;
+	}
+	sq=mmap(NULL,sqsize,PROT_READ|PROT_WRITE,MAP_SHARED|MAP_POPULATE,ring->fd,IORING_OFF_SQ_RING);
+	cq=(params.features&IORING_FEAT_SINGLE_MMAP)?sq:mmap(NULL,cqsize,PROT_READ|PROT_WRITE,MAP_SHARED|MAP_POPULATE,ring->fd,IORING_OFF_CQ_RING);
+	ring->sqes=mmap(NULL,params.sq_entries*sizeof(struct io_uring_sqe),PROT_READ|PROT_WRITE,MAP_SHARED|MAP_POPULATE,ring->fd,IORING_OFF_SQES);
+	if (sq==MAP_FAILED || cq==MAP_FAILED || ring->sqes==MAP_FAILED)
+	{
+		close(ring->fd);
+		return RETVAL_NOK;
+	}
+	ring->entries=(params.sq_entries<URING_ENTRIES)?params.sq_entries:URING_ENTRIES;
+	ring->sqhead=(unsigned int*)(sq+params.sq_off.head);
+	ring->sqtail=(unsigned int*)(sq+params.sq_off.tail);
+	ring->sqmask=(unsigned int*)(sq+params.sq_off.ring_mask);
+	ring->sqarray=(unsigned int*)(sq+params.sq_off.array);
+	ring->cqhead=(unsigned int*)(cq+params.cq_off.head);
+	ring->cqtail=(unsigned int*)(cq+params.cq_off.tail);
+	ring->cqmask=(unsigned int*)(cq+params.cq_off.ring_mask);
+	ring->cqes=(struct io_uring_cqe*)(cq+params.cq_off.cqes);
+	return RETVAL_OK;
+}
+// the writes between begin and end may be queued. anything which has to
+// happen at a certain time (delays, reading pins) has to be outside.
+void gpio_batch_begin()
+{
+	gpio_uring.batching++;
+}
+void gpio_batch_end()
+{
+	if (--gpio_uring.batching==0 && gpio_transport==GPIO_SYSFS_URING) uring_submit(&gpio_uring);
+}
+// tries to switch to the given transport. without io_uring, it is the kept open fds.
+int gpio_transport_set(int transport)
+{
+	if (transport==GPIO_SYSFS_URING && uring_init(&gpio_uring,URING_ENTRIES)!=RETVAL_OK)
+	{
+		fprintf(stderr,"io_uring is not available, writing the GPIOs one at a time\n");
+		transport=GPIO_SYSFS_FD;
+	}
+	gpio_transport=transport;
+	wave_mosi=-1;
+	return transport;
+}
 int gpio_write(int pin,int value)
 {
 	int fd;
 	char buffer[MAXBUFLEN];
-	snprintf(buffer,MAXBUFLEN,"/sys/class/gpio/gpio%d/value",pin);
+	if (pin==PIN_MOSI) wave_mosi=-1;	// spi_emit() sets it again after its last write
+	if (gpio_trace!=NULL) trace_record(gpio_trace,pin,value);
+	if (gpio_recorder!=NULL)
+	{
+		if (gpio_recorder->num<gpio_recorder->max)
+		{
+			gpio_recorder->pins[gpio_recorder->num]=pin;
+			gpio_recorder->values[gpio_recorder->num]=value;
+		}
+		gpio_recorder->num++;
+		if (gpio_recorder->model!=NULL) model_pin(gpio_recorder->model,pin,value);
+		if (gpio_recorder->fd>=0) write(gpio_recorder->fd,value?"1":"0",1);
+		return RETVAL_OK;
+	}
+	if (gpio_transport!=GPIO_SYSFS_OPEN)
+	{
+		unsigned char buf[2];
+		fd=gpio_valuefd(pin);
+		if (fd<0) return RETVAL_NOK;
+		if (gpio_transport==GPIO_SYSFS_URING && gpio_uring.batching) return uring_write(&gpio_uring,fd,pin,value);
+		buf[0]=pin;
+		buf[1]=value?'1':'0';
+		gpio_syscalls++;
+		if (gpio_logfd>=0) return (write(fd,buf,2)==2)?RETVAL_OK:RETVAL_NOK;
+		return (pwrite(fd,&buf[1],1,0)==1)?RETVAL_OK:RETVAL_NOK;
+	}
+	snprintf(buffer,MAXBUFLEN,"%s/gpio%d/value",gpio_root,pin);
 	fd=open(buffer,O_WRONLY);
 	if (fd<0)
 	{
@@ -267,8 +697,15 @@ int gpio_write(int pin,int value)
 	}
 	write(fd,value?"1":"0",1);
 	close(fd);
+	gpio_syscalls+=3;
 	return RETVAL_OK;
 }
+// the writes go into the recording, or back to the pins with NULL. the level of MOSI is not known there.
+void gpio_record(tGpioRecorder* rec)
+{
+	gpio_recorder=rec;
+	wave_mosi=-1;
+}
 
 int gpio_read(int pin,int* value)
 {
@@ -299,6 +736,8 @@ int gpio_pins_up()
 	int retval;
 
 	retval=RETVAL_OK;
+	// the reset pin goes low, so the display forgets what a warm oledd left on it
+	unlink(OLEDD_STATE);
 	// start with the GPIO configuration
 	retval|=gpio_export(PIN_RST);	
 	retval|=gpio_export(PIN_DC);	
@@ -319,6 +758,7 @@ int gpio_pins_up()
 	retval|=gpio_direction(PIN_SCLK, GPIO_OUTPUT);
 	retval|=gpio_direction(PIN_MOSI, GPIO_OUTPUT);
 	retval|=gpio_direction(PIN_MISO, GPIO_INPUT);
+	wave_mosi=-1;
 
 	return retval;
 }
@@ -328,6 +768,7 @@ int gpio_pins_down()
 	int retval;
 
 	retval=RETVAL_OK;
+	unlink(OLEDD_STATE);
 	retval|=gpio_write(PIN_RST,0);
 	retval|=gpio_write(PIN_DC,0);
 	retval|=gpio_write(PIN_BL,0);
@@ -347,47 +788,272 @@ int gpio_pins_down()
 	return retval;
 }
 
-void spi_writebyte(unsigned char byte,int mode,int msbfirst)
+// the bit-banged SPI is table driven. for every mode and bit order, the
+// sequence of pin changes for each byte value is computed once. writes to
+// MOSI which would not change its level are left out. since that depends on
+// the last bit of the previous byte, there are two tables.
+typedef struct _tWaveform
 {
-	int cpol;
-	int cpol0;
+	int valid;
+	int cpol0;				// the idle level of the clock
+	unsigned char num[2][256];		// [MOSI level before the byte][byte]
+	unsigned char steps[2][256][WAVE_MAXSTEPS];
+} tWaveform;
+tWaveform waveforms[4][2];
+
+tWaveform* wave_get(int mode,int msbfirst)
+{
+	tWaveform* wave;
 	int cpha;
-	int bits;
+	int prev;
+	int byte;
 
+	mode&=3;
+	msbfirst=(msbfirst==SPI_MSBFIRST);
+	wave=&waveforms[mode][msbfirst];
+	if (wave->valid) return wave;
 	switch (mode)
 	{
-		case SPI_MODE0:	cpol=0;cpha=0;break;
-		case SPI_MODE1:	cpol=0;cpha=1;break;
-		case SPI_MODE2:	cpol=1;cpha=0;break;
-		case SPI_MODE3:	cpol=1;cpha=1;break;
+		default:
+		case SPI_MODE0:	wave->cpol0=0;cpha=0;break;
+		case SPI_MODE1:	wave->cpol0=0;cpha=1;break;
+		case SPI_MODE2:	wave->cpol0=1;cpha=0;break;
+		case SPI_MODE3:	wave->cpol0=1;cpha=1;break;
 	}
-	cpol0=cpol;
-	gpio_write(PIN_SCLK,cpol);
-	if (!cpha)
+	for (prev=0;prev<2;prev++)
 	{
-		cpol=1-cpol;	// when CPHA=1, the new value is being sampled at the first clock edge
-		SPI_DELAY;
+		for (byte=0;byte<256;byte++)
+		{
+			unsigned char* steps;
+			int num;
+			int mosi;
+			int cpol;
+			int bits;
+			int b;
+
+			steps=wave->steps[prev][byte];
+			num=0;
+			mosi=prev;
+			b=byte;
+			cpol=wave->cpol0;
+			if (!cpha) cpol=1-cpol;	// when CPHA=1, the new value is being sampled at the first clock edge
+			for (bits=0;bits<8;bits++)
+			{
+				int bit;
+				if (msbfirst)
+				{
+					bit=(b>>7)&1;
+					b<<=1;
+				} else {
+					bit=b&1;
+					b>>=1;
+				}
+				if (bit!=mosi) steps[num++]=WAVE_MOSI|bit;	// set the value
+				mosi=bit;
+				steps[num++]=WAVE_SCLK|cpol;	// 1st clock edge
+				cpol=1-cpol;
+				steps[num++]=WAVE_SCLK|cpol;	// 2nd clock edge
+				cpol=1-cpol;
+			}
+			if (cpha) steps[num++]=WAVE_SCLK|wave->cpol0;	// make sure that the SPI clk is the same as before. with CPHA=0, it already is.
+			wave->num[prev][byte]=num;
+		}
+	}
+	wave->valid=1;
+	return wave;
+}
+
+// the part of spi_writebuf() which writes the pins. with the kept open fds,
+// and nobody watching the pins, the writes go straight into the value files.
+void spi_emit(unsigned char* buf,int len,tWaveform* wave,int msbfirst)
+{
+	int pins[2];
+	int fds[2];
+	int direct;
+	int mosi;
+	int i;
+
+	pins[0]=PIN_MOSI;
+	pins[1]=PIN_SCLK;
+	gpio_write(pins[1],wave->cpol0);
+	mosi=wave_mosi;
+	if (mosi<0)
+	{
+		mosi=0;
+		gpio_write(pins[0],mosi);
+	}
+	direct=(gpio_transport==GPIO_SYSFS_FD && gpio_trace==NULL && gpio_recorder==NULL && gpio_logfd<0);
+	if (direct)
+	{
+		fds[0]=gpio_valuefd(pins[0]);
+		fds[1]=gpio_valuefd(pins[1]);
+		direct=(fds[0]>=0 && fds[1]>=0);
 	}
-	for (bits=0;bits<8;bits++)
+	for (i=0;i<len;i++)
 	{
-		int bit;
-		if (msbfirst==SPI_MSBFIRST)
+		unsigned char* steps;
+		int num;
+		int j;
+		steps=wave->steps[mosi][buf[i]];
+		num=wave->num[mosi][buf[i]];
+		if (direct)
 		{
-			bit=(byte>>7)&1;
-			byte<<=1;
+			for (j=0;j<num;j++)
+			{
+				pwrite(fds[steps[j]>>1],&"01"[steps[j]&1],1,0);
+				if (steps[j]&WAVE_SCLK) SPI_DELAY;
+			}
+			gpio_syscalls+=num;
 		} else {
-			bit=(byte)&1;
-			byte>>=1;
+			for (j=0;j<num;j++)
+			{
+				gpio_write(pins[steps[j]>>1],steps[j]&1);
+				if (steps[j]&WAVE_SCLK) SPI_DELAY;
+			}
+		}
+		mosi=(msbfirst==SPI_MSBFIRST)?(buf[i]&1):(buf[i]>>7);
+	}
+	wave_mosi=mosi;
+}
+// sends a buffer over the bit-banged SPI.
+void spi_writebuf(unsigned char* buf,int len,int mode,int msbfirst)
+{
+	tWaveform* wave;
+
+	wave=wave_get(mode,msbfirst);
+	gpio_batch_begin();
+	spi_emit(buf,len,wave,msbfirst);
+	gpio_batch_end();
+}
+// the way spi_writebuf() used to work, bit by bit. for the benchmark.
+void spi_writebuf_bitwise(unsigned char* buf,int len,int mode,int msbfirst)
+{
+	int cpol0;
+	int cpha;
+	int i;
+
+	switch (mode)
+	{
+		default:
+		case SPI_MODE0:	cpol0=0;cpha=0;break;
+		case SPI_MODE1:	cpol0=0;cpha=1;break;
+		case SPI_MODE2:	cpol0=1;cpha=0;break;
+		case SPI_MODE3:	cpol0=1;cpha=1;break;
+	}
+	gpio_write(PIN_SCLK,cpol0);
+	for (i=0;i<len;i++)
+	{
+		unsigned char byte;
+		int cpol;
+		int bits;
+
+		byte=buf[i];
+		cpol=cpol0;
+		if (!cpha)
+		{
+			cpol=1-cpol;	// when CPHA=1, the new value is being sampled at the first clock edge
+			SPI_DELAY;
+		}
+		for (bits=0;bits<8;bits++)
+		{
+			int bit;
+			if (msbfirst==SPI_MSBFIRST)
+			{
+				bit=(byte>>7)&1;
+				byte<<=1;
+			} else {
+				bit=(byte)&1;
+				byte>>=1;
+			}
+			gpio_write(PIN_MOSI,bit);	// set the value	
+			gpio_write(PIN_SCLK,cpol);	// 1st clock edge
+			cpol=1-cpol;
+			SPI_DELAY;		
+			gpio_write(PIN_SCLK,cpol);	// 2nd clock edge
+			cpol=1-cpol;
+			SPI_DELAY;
+		}
+		if (cpha) gpio_write(PIN_SCLK,cpol0);	// make sure that the SPI clk is the same as before. with CPHA=0, it already is.
+	}
+}
+void spi_writebyte(unsigned char byte,int mode,int msbfirst)
+{
+	spi_writebuf(&byte,1,mode,msbfirst);
+}
+
+// a transaction collects command and data bytes for the display in one buffer.
+// consecutive bytes of the same kind form a run, and the DC line only has to
+// be switched between runs. a whole frame is handed over with one call to
+// txn_submit().
+typedef struct _tTransaction
+{
+	int len;
+	int runs;
+	int runstart[TXN_MAXRUNS];
+	int rundc[TXN_MAXRUNS];		// level of the DC pin: TXN_COMMAND or TXN_DATA
+	unsigned char buf[TXN_MAXLEN];
+} tTransaction;
+
+void txn_init(tTransaction* txn)
+{
+	txn->len=0;
+	txn->runs=0;
+}
+int txn_append(tTransaction* txn,int dc,const unsigned char* bytes,int len)
+{
+	if (txn->runs==0 || txn->rundc[txn->runs-1]!=dc)
+	{
+		if (txn->runs==TXN_MAXRUNS)
+		{
+			fprintf(stderr,"Too many runs in transaction\n");
+			return RETVAL_NOK;
 		}
-		gpio_write(PIN_MOSI,bit);	// set the value	
-		gpio_write(PIN_SCLK,cpol);	// 1st clock edge
-		cpol=1-cpol;
-		SPI_DELAY;		
-		gpio_write(PIN_SCLK,cpol);	// 2nd clock edge
-		cpol=1-cpol;
-		SPI_DELAY;
+		txn->runstart[txn->runs]=txn->len;
+		txn->rundc[txn->runs]=dc;
+		txn->runs++;
+	}
+	if (txn->len+len>TXN_MAXLEN)
+	{
+		fprintf(stderr,"Transaction buffer overflow\n");
+		return RETVAL_NOK;
+	}
+	memcpy(&txn->buf[txn->len],bytes,len);
+	txn->len+=len;
+	return RETVAL_OK;
+}
+int txn_command(tTransaction* txn,unsigned char byte)
+{
+	return txn_append(txn,TXN_COMMAND,&byte,1);
+}
+int txn_data(tTransaction* txn,const unsigned char* bytes,int len)
+{
+	return txn_append(txn,TXN_DATA,bytes,len);
+}
+// all the SH1106 commands for addressing are one byte each.
+int txn_address(tTransaction* txn,int page,int column)
+{
+	int retval;
+	column+=oled_columnoffset;
+	retval=RETVAL_OK;
+	retval|=txn_command(txn,0xb0+page);		// set page address
+	retval|=txn_command(txn,0x00|(column&0xf));	// set low column address
+	retval|=txn_command(txn,0x10|(column>>4));	// set high column address
+	return retval;
+}
+void txn_submit(tTransaction* txn)
+{
+	int i;
+	gpio_batch_begin();
+	for (i=0;i<txn->runs;i++)
+	{
+		int end;
+		end=(i+1<txn->runs)?txn->runstart[i+1]:txn->len;
+		gpio_write(PIN_DC,txn->rundc[i]);
+		spi_writebuf(&txn->buf[txn->runstart[i]],end-txn->runstart[i],SPI_MODE0,SPI_MSBFIRST);
 	}
-	gpio_write(PIN_SCLK,cpol0);		// make sure that the SPI clk is the same as before
+	gpio_batch_end();
+	txn->len=0;
+	txn->runs=0;
 }
 void oled_reset()
 {
@@ -407,18 +1073,44 @@ void oled_init()
 		0xda,0x12,0xdb,0x40, 0x20,0x02,0xa4,0xa6,	// set com pins hardare, ???, set vcomh, set vcom deselect level, set page addr mode, ???, disable entire display on, disable inverse display on, 
 		0xaf	// turn on oled panel
 	};
-	int i;
-	gpio_write(PIN_DC,0);			
-	for (i=0;i<sizeof(oled_commands);i++)
-	{
-		spi_writebyte(oled_commands[i],SPI_MODE0,SPI_MSBFIRST);	
-	}
+	tTransaction txn;
+	txn_init(&txn);
+	txn_append(&txn,TXN_COMMAND,oled_commands,sizeof(oled_commands));
+	txn_submit(&txn);
 }
-void oled_draw(unsigned char* bitmap)
+// the display clock: bits 7..4 are the oscillator frequency, bits 3..0 the divide ratio-1
+void oled_clock(unsigned char value)
+{
+	tTransaction txn;
+	txn_init(&txn);
+	txn_command(&txn,0xd5);
+	txn_command(&txn,value);
+	txn_submit(&txn);
+}
+// mirroring and turning upside down are free: the controller just scans its
+// RAM the other way round. with the segment remap, the panel sees the other
+// end of the 132 columns of RAM, so the offset changes as well.
+void oled_orientation(int orientation)
+{
+	tTransaction txn;
+	txn_init(&txn);
+	txn_command(&txn,(orientation&ORIENT_FLIPX)?0xa1:0xa0);	// set SEG/Column Mapping
+	txn_command(&txn,(orientation&ORIENT_FLIPY)?0xc8:0xc0);	// set COM/ROW scan direction
+	txn_submit(&txn);
+	oled_columnoffset=(orientation&ORIENT_FLIPX)?OLED_RAM_COLUMNS-CANVAS_WIDTH-OLED_COLUMN_OFFSET:OLED_COLUMN_OFFSET;
+}
+int oled_orientation_parse(const char* name)
+{
+	if (strcmp(name,"0")==0) return ORIENT_0;
+	if (strcmp(name,"90")==0) return ORIENT_90;
+	if (strcmp(name,"180")==0) return ORIENT_180;
+	if (strcmp(name,"270")==0) return ORIENT_270;
+	if (strcmp(name,"mirrorx")==0) return ORIENT_FLIPX;
+	if (strcmp(name,"mirrory")==0) return ORIENT_FLIPY;
+	return -1;
+}
+void oled_bitmap2canvas(unsigned char* canvas,unsigned char* bitmap)
 {
-	#define	CANVAS_WIDTH	128
-	#define	CANVAS_PAGES	8	
-	unsigned char canvas[CANVAS_WIDTH*CANVAS_PAGES];
 	int i;
 	for (i=0;i<CANVAS_WIDTH*CANVAS_PAGES;i++)
 	{
@@ -445,61 +1137,3576 @@ void oled_draw(unsigned char* bitmap)
 		}
 		canvas[i]=byte;
 	}
-
+}
+void oled_flush(unsigned char* canvas)
+{
+	tTransaction txn;
+	int i;
+	txn_init(&txn);
 	for (i=0;i<CANVAS_PAGES;i++)
 	{
-		int j;
-		gpio_write(PIN_DC,0);			// write command
-		spi_writebyte(0xb0+i,SPI_MODE0,SPI_MSBFIRST);	// set page address
-		spi_writebyte(0x02,SPI_MODE0,SPI_MSBFIRST);	// set low column address
-		spi_writebyte(0x10,SPI_MODE0,SPI_MSBFIRST);	// set high column address
-		gpio_write(PIN_DC,1);			// write data
-		for (j=0;j<CANVAS_WIDTH;j++)
-		{
-			spi_writebyte(canvas[i*CANVAS_WIDTH+j],SPI_MODE0,SPI_MSBFIRST);
-		}
+		txn_address(&txn,i,0);
+		txn_data(&txn,&canvas[i*CANVAS_WIDTH],CANVAS_WIDTH);
 	}
+	txn_submit(&txn);	// the whole frame in one go
 }
-
-
-int sh1106_up()
+// sends only the columns which differ from the shadow, one span per page.
+// returns the number of bytes in the transaction.
+int oled_flush_changed(unsigned char* canvas,unsigned char* shadow)
 {
-	int retval;
-	retval=RETVAL_OK;
-	retval|=gpio_pins_up();
-	// spi mode 0
-	// spi master
-	// spi clock div 2
-	// spi msbfirst
-
-	// ?? tell the device it should take orders from SPI??
-	retval|=gpio_write(PIN_BL,1);
-	retval|=gpio_write(PIN_CS,0);
-	
-	if (retval==RETVAL_OK)
-	{	
-		oled_reset();
-		oled_init();
+	tTransaction txn;
+	int i;
+	txn_init(&txn);
+	for (i=0;i<CANVAS_PAGES;i++)
+	{
+		unsigned char* src;
+		unsigned char* dst;
+		int first;
+		int last;
+		src=&canvas[i*CANVAS_WIDTH];
+		dst=&shadow[i*CANVAS_WIDTH];
+		for (first=0;first<CANVAS_WIDTH && src[first]==dst[first];first++);
+		if (first==CANVAS_WIDTH) continue;
+		for (last=CANVAS_WIDTH-1;src[last]==dst[last];last--);
+		memcpy(&dst[first],&src[first],last-first+1);
+		txn_address(&txn,i,first);
+		txn_data(&txn,&dst[first],last-first+1);
 	}
-	return retval;
+	i=txn.len;
+	if (i) txn_submit(&txn);
+	return i;
 }
-int sh1106_down()
+// swaps bit c of byte r with bit r of byte c, with three delta swaps
+unsigned long long transpose64(unsigned long long x)
 {
-	return gpio_pins_down();
+	unsigned long long t;
+	t=(x^(x>>7))&0x00aa00aa00aa00aaULL;	x^=t^(t<<7);
+	t=(x^(x>>14))&0x0000cccc0000ccccULL;	x^=t^(t<<14);
+	t=(x^(x>>28))&0x00000000f0f0f0f0ULL;	x^=t^(t<<28);
+	return x;
 }
-void graceFulExit(int signal_number)
+// transposes an 8x8 block of bits: 8 rows of 8 pixels (leftmost pixel in bit 7)
+// become 8 columns of 8 pixels (top pixel in bit 0), which is the page format.
+void transpose8x8(unsigned char* columns,const unsigned char* rows)
+{
+	unsigned long long x;
+	int i;
+	x=0;
+	for (i=0;i<8;i++)
+	{
+		x|=((unsigned long long)rows[i])<<(8*i);
+	}
+	x=transpose64(x);
+	// byte b now holds bit b of every row, which is column 7-b
+	for (i=0;i<8;i++)
+	{
+		columns[7-i]=x>>(8*i);
+	}
+}
+// a portrait canvas is 64 pixels wide and 128 high, in the same page format.
+// turning it by 90 degrees clockwise maps its column x to row x of the
+// display, and its row y to column 127-y. an 8x8 block stays an 8x8 block,
+// and only has to be transposed.
+void rotate_portrait(unsigned char* canvas,const unsigned char* portrait)
+{
+	int page;
+	int k;
+	for (page=0;page<PORTRAIT_PAGES;page++)
+	{
+		for (k=0;k<PORTRAIT_WIDTH/8;k++)
+		{
+			unsigned long long x;
+			unsigned char* dst;
+			int i;
+			memcpy(&x,&portrait[page*PORTRAIT_WIDTH+k*8],8);	// byte i is column 8k+i (little endian)
+			x=transpose64(x);	// byte j is now row 8*page+j, bit i column 8k+i
+			dst=&canvas[k*CANVAS_WIDTH+CANVAS_WIDTH-1-page*8];
+			for (i=0;i<8;i++)
+			{
+				dst[-i]=x>>(8*i);
+			}
+		}
+	}
+}
+// the same, pixel by pixel
+void rotate_portrait_naive(unsigned char* canvas,const unsigned char* portrait)
+{
+	int x,y;
+	memset(canvas,0,CANVAS_WIDTH*CANVAS_PAGES);
+	for (y=0;y<PORTRAIT_PAGES*8;y++)
+	{
+		for (x=0;x<PORTRAIT_WIDTH;x++)
+		{
+			if (portrait[(y/8)*PORTRAIT_WIDTH+x]&(1<<(y%8)))
+			{
+				canvas[(x/8)*CANVAS_WIDTH+CANVAS_WIDTH-1-y]|=(1<<(x%8));
+			}
+		}
+	}
+}
+void oled_draw(unsigned char* bitmap)
+{
+	unsigned char canvas[CANVAS_WIDTH*CANVAS_PAGES];
+	oled_bitmap2canvas(canvas,bitmap);
+	oled_flush(canvas);
+}
+
+// sprites are kept in the same page format as the canvas. since a sprite at
+// an arbitrary y position straddles two pages, all 8 vertical shifts are
+// rendered once when the sprite is created. blitting is then a matter of
+// combining aligned bytes.
+typedef struct _tSprite
+{
+	int width;
+	int height;
+	int pages[SPRITE_SHIFTS];	// number of pages covered by each shifted variant
+	unsigned char solid[SPRITE_SHIFTS][SPRITE_MAXPAGES];	// 1 if the mask is 0xff for the entire page
+	unsigned char image[SPRITE_SHIFTS][SPRITE_MAXPAGES*SPRITE_MAXWIDTH];
+	unsigned char mask[SPRITE_SHIFTS][SPRITE_MAXPAGES*SPRITE_MAXWIDTH];
+} tSprite;
+
+// pixels and mask are byte-per-pixel, just like the bitmaps. when mask is NULL,
+// every set pixel is also part of the mask.
+int sprite_create(tSprite* sprite,unsigned char* pixels,unsigned char* mask,int width,int height)
+{
+	int shift;
+	if (width<1 || width>SPRITE_MAXWIDTH || height<1 || height>SPRITE_MAXHEIGHT)
+	{
+		fprintf(stderr,"Sprite size %dx%d is not supported\n",width,height);
+		return RETVAL_NOK;
+	}
+	memset(sprite,0,sizeof(tSprite));
+	sprite->width=width;
+	sprite->height=height;
+	for (shift=0;shift<SPRITE_SHIFTS;shift++)
+	{
+		int x,y;
+		int p;
+		sprite->pages[shift]=(height+shift+7)/8;
+		for (y=0;y<height;y++)
+		{
+			int row;
+			unsigned char bit;
+			row=y+shift;
+			bit=1<<(row%8);
+			for (x=0;x<width;x++)
+			{
+				int idx;
+				idx=(row/8)*width+x;
+				// pixels outside of the mask are not part of the sprite
+				if (pixels[x+y*width] && (mask==NULL || mask[x+y*width])) sprite->image[shift][idx]|=bit;
+				if (mask?mask[x+y*width]:pixels[x+y*width]) sprite->mask[shift][idx]|=bit;
+			}
+		}
+		for (p=0;p<sprite->pages[shift];p++)
+		{
+			sprite->solid[shift][p]=1;
+			for (x=0;x<width;x++)
+			{
+				if (sprite->mask[shift][p*width+x]!=0xff) sprite->solid[shift][p]=0;
+			}
+		}
+	}
+	return RETVAL_OK;
+}
+
+void sprite_blit(unsigned char* canvas,tSprite* sprite,int x,int y,int op)
+{
+	int shift;
+	int page0;
+	int p;
+	int x0,x1;
+	int width;
+
+	width=sprite->width;
+	shift=y&7;		// also correct for negative y
+	page0=(y-shift)/8;
+	x0=(x<0)?-x:0;
+	x1=(x+width>CANVAS_WIDTH)?CANVAS_WIDTH-x:width;
+	if (x0>=x1) return;
+
+	for (p=0;p<sprite->pages[shift];p++)
+	{
+		int i;
+		int page;
+		unsigned char* src;
+		unsigned char* msk;
+		unsigned char* dst;
+
+		page=page0+p;
+		if (page<0 || page>=CANVAS_PAGES) continue;
+		src=&sprite->image[shift][p*width];
+		msk=&sprite->mask[shift][p*width];
+		dst=&canvas[page*CANVAS_WIDTH+x];
+		switch (op)
+		{
+			case BLIT_OR:		for (i=x0;i<x1;i++) dst[i]|=src[i];break;
+			case BLIT_ANDNOT:	for (i=x0;i<x1;i++) dst[i]&=~src[i];break;
+			case BLIT_XOR:		for (i=x0;i<x1;i++) dst[i]^=src[i];break;
+			case BLIT_MASKED:
+				if (sprite->solid[shift][p])	// fast path: the page is covered completely. (always the case for y%8==0 and height%8==0 with an opaque sprite)
+				{
+					memcpy(&dst[x0],&src[x0],x1-x0);
+				} else {
+					for (i=x0;i<x1;i++) dst[i]=(dst[i]&~msk[i])|src[i];
+				}
+				break;
+		}
+	}
+}
+
+// reference implementation, one pixel at a time.
+void sprite_blit_naive(unsigned char* canvas,unsigned char* pixels,unsigned char* mask,int width,int height,int x,int y,int op)
+{
+	int i,j;
+	for (j=0;j<height;j++)
+	{
+		int ty;
+		ty=y+j;
+		if (ty<0 || ty>=BITMAP_HEIGHT) continue;
+		for (i=0;i<width;i++)
+		{
+			int tx;
+			int pixel;
+			int masked;
+			unsigned char bit;
+			unsigned char* dst;
+			tx=x+i;
+			if (tx<0 || tx>=CANVAS_WIDTH) continue;
+			masked=mask?(mask[i+j*width]?1:0):(pixels[i+j*width]?1:0);
+			pixel=(pixels[i+j*width] && masked)?1:0;
+			bit=1<<(ty%8);
+			dst=&canvas[(ty/8)*CANVAS_WIDTH+tx];
+			switch (op)
+			{
+				case BLIT_OR:		if (pixel) *dst|=bit;break;
+				case BLIT_ANDNOT:	if (pixel) *dst&=~bit;break;
+				case BLIT_XOR:		if (pixel) *dst^=bit;break;
+				case BLIT_MASKED:	if (masked) *dst=(*dst&~bit)|(pixel?bit:0);break;
+			}
+		}
+	}
+}
+
+double timestamp()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return ts.tv_sec+ts.tv_nsec*1e-9;
+}
+
+// a 16x16 ball with a one pixel outline. the mask covers the outline as well.
+void sprite_ball(unsigned char* pixels,unsigned char* mask)
+{
+	int x,y;
+	for (y=0;y<16;y++)
+	{
+		for (x=0;x<16;x++)
+		{
+			int d;
+			d=(2*x-15)*(2*x-15)+(2*y-15)*(2*y-15);
+			mask[x+y*16]=(d<=256);
+			pixels[x+y*16]=(d<=144);
+		}
+	}
+}
+
+int bench_sprites()
+{
+	#define	BENCH_POSITIONS	1024
+	#define	BENCH_BLITS	(1<<21)
+	const char *opnames[4]={"OR","ANDNOT","XOR","MASKED"};
+	unsigned char pixels[16*16];
+	unsigned char mask[16*16];
+	unsigned char canvas1[CANVAS_WIDTH*CANVAS_PAGES];
+	unsigned char canvas2[CANVAS_WIDTH*CANVAS_PAGES];
+	int posx[BENCH_POSITIONS];
+	int posy[BENCH_POSITIONS];
+	tSprite sprite;
+	int cut;
+	int op;
+	int i;
+	int retval;
+
+	retval=RETVAL_OK;
+	srand(1);
+	for (i=0;i<BENCH_POSITIONS;i++)
+	{
+		posx[i]=(rand()%(CANVAS_WIDTH+16))-8;
+		posy[i]=(rand()%(BITMAP_HEIGHT+16))-8;
+	}
+	// the second time, the mask only covers the left half of the ball, and the pixels go beyond it
+	for (cut=0;cut<2;cut++)
+	{
+		sprite_ball(pixels,mask);
+		for (i=0;i<16*16;i++)
+		{
+			if (cut && (i%16)>=8) mask[i]=0;
+		}
+		sprite_create(&sprite,pixels,mask,16,16);
+		printf("%d blits of a 16x16 sprite per operation%s\n",BENCH_BLITS,cut?", with pixels outside of the mask":"");
+		for (op=BLIT_OR;op<=BLIT_MASKED;op++)
+		{
+			double t0,t1,t2;
+			memset(canvas1,0x55,sizeof(canvas1));
+			memset(canvas2,0x55,sizeof(canvas2));
+			t0=timestamp();
+			for (i=0;i<BENCH_BLITS;i++)
+			{
+				sprite_blit(canvas1,&sprite,posx[i%BENCH_POSITIONS],posy[i%BENCH_POSITIONS],op);
+			}
+			t1=timestamp();
+			for (i=0;i<BENCH_BLITS;i++)
+			{
+				sprite_blit_naive(canvas2,pixels,mask,16,16,posx[i%BENCH_POSITIONS],posy[i%BENCH_POSITIONS],op);
+			}
+			t2=timestamp();
+			printf("%-8s cached: %12.0f sprites/s   naive: %12.0f sprites/s   speedup: %5.1fx   %s\n",
+				opnames[op],BENCH_BLITS/(t1-t0),BENCH_BLITS/(t2-t1),(t2-t1)/(t1-t0),
+				memcmp(canvas1,canvas2,sizeof(canvas1))?"MISMATCH":"ok");
+			if (memcmp(canvas1,canvas2,sizeof(canvas1))) retval=RETVAL_NOK;
+		}
+	}
+	return retval;
+}
+
+// a screen is put together from layers: a background, text, popups, a
+// cursor. every layer is a canvas of its own, in the page format, with a
+// mask, a position and a way of being blended onto the layers below
+// (BLIT_OR, BLIT_ANDNOT, BLIT_XOR, or BLIT_MASKED to replace what is under
+// the mask). a layer remembers which of its pages have been drawn into, and
+// the compositor only puts together the pages of the screen which are
+// affected. showing or hiding a popup costs the pages it covers, not more.
+typedef struct _tLayer
+{
+	int visible;
+	int x,y;		// where the top left corner of the layer is on the screen
+	int blend;
+	unsigned int used;	// pages of the layer which have something on them
+	unsigned char canvas[CANVAS_WIDTH*CANVAS_PAGES];
+	unsigned char mask[CANVAS_WIDTH*CANVAS_PAGES];	// only for BLIT_MASKED
+} tLayer;
+
+typedef struct _tCompositor
+{
+	int num;
+	unsigned int dirty;	// pages of the screen which have to be put together again
+	tLayer layers[LAYER_MAX];
+	unsigned char screen[CANVAS_WIDTH*CANVAS_PAGES];
+} tCompositor;
+
+void compositor_init(tCompositor* comp,int num)
+{
+	memset(comp,0,sizeof(tCompositor));
+	comp->num=num;
+}
+// the pages of the screen which are covered by some pages of a layer
+unsigned int layer_screenpages(tLayer* layer,unsigned int pages)
+{
+	unsigned int screen;
+	int p;
+	screen=0;
+	if (layer->x<=-CANVAS_WIDTH || layer->x>=CANVAS_WIDTH) return 0;
+	for (p=0;p<CANVAS_PAGES;p++)
+	{
+		int top,bottom;
+		if (!(pages&(1<<p))) continue;
+		top=(p*8+layer->y)>>3;		// arithmetic shift, also for negative y
+		bottom=(p*8+7+layer->y)>>3;
+		if (top>=0 && top<CANVAS_PAGES) screen|=1<<top;
+		if (bottom>=0 && bottom<CANVAS_PAGES) screen|=1<<bottom;
+	}
+	return screen;
+}
+// after drawing into a layer, the pages which have been drawn into are marked
+void layer_touch(tCompositor* comp,int i,unsigned int pages)
+{
+	tLayer* layer=&comp->layers[i];
+	layer->used|=pages;
+	if (layer->visible) comp->dirty|=layer_screenpages(layer,pages);
+}
+void layer_clear(tCompositor* comp,int i)
+{
+	tLayer* layer=&comp->layers[i];
+	if (layer->visible) comp->dirty|=layer_screenpages(layer,layer->used);
+	memset(layer->canvas,0,sizeof(layer->canvas));
+	memset(layer->mask,0,sizeof(layer->mask));
+	layer->used=0;
+}
+void layer_show(tCompositor* comp,int i,int visible)
+{
+	tLayer* layer=&comp->layers[i];
+	if (layer->visible==visible) return;
+	layer->visible=visible;
+	comp->dirty|=layer_screenpages(layer,layer->used);
+}
+void layer_move(tCompositor* comp,int i,int x,int y)
+{
+	tLayer* layer=&comp->layers[i];
+	if (layer->x==x && layer->y==y) return;
+	if (layer->visible) comp->dirty|=layer_screenpages(layer,layer->used);
+	layer->x=x;
+	layer->y=y;
+	if (layer->visible) comp->dirty|=layer_screenpages(layer,layer->used);
+}
+// the part of a layer which ends up in one page of the screen: the two pages
+// of the layer it straddles, shifted into place, 8 columns per 64 bit word.
+void layer_page(tLayer* layer,unsigned char* src,int page,unsigned long long* dst)
+{
+	static const unsigned long long ones=0x0101010101010101ULL;
+	unsigned char upper[CANVAS_WIDTH];
+	unsigned char lower[CANVAS_WIDTH];
+	unsigned long long a,b;
+	int row;
+	int shift;
+	int q;
+	int x0,x1;
+	int i;
+
+	row=page*8-layer->y;	// the row of the layer which is at the top of this page
+	shift=row&7;
+	q=(row-shift)/8;
+	memset(upper,0,sizeof(upper));
+	memset(lower,0,sizeof(lower));
+	x0=(layer->x<0)?0:layer->x;
+	x1=(layer->x>0)?CANVAS_WIDTH:CANVAS_WIDTH+layer->x;
+	if (x0<x1)
+	{
+		if (q>=0 && q<CANVAS_PAGES) memcpy(&upper[x0],&src[q*CANVAS_WIDTH+x0-layer->x],x1-x0);
+		if (shift && q+1>=0 && q+1<CANVAS_PAGES) memcpy(&lower[x0],&src[(q+1)*CANVAS_WIDTH+x0-layer->x],x1-x0);
+	}
+	for (i=0;i<CANVAS_WIDTH/8;i++)
+	{
+		memcpy(&a,&upper[i*8],8);
+		memcpy(&b,&lower[i*8],8);
+		if (shift) a=((a>>shift)&(ones*(0xff>>shift)))|((b<<(8-shift))&(ones*((0xff<<(8-shift))&0xff)));
+		dst[i]=a;
+	}
+}
+// puts the dirty pages of the screen together again, and returns them
+unsigned int compositor_compose(tCompositor* comp)
+{
+	unsigned int dirty;
+	int page;
+	dirty=comp->dirty;
+	for (page=0;page<CANVAS_PAGES;page++)
+	{
+		unsigned long long screen[CANVAS_WIDTH/8];
+		int l;
+		int i;
+		if (!(dirty&(1<<page))) continue;
+		memset(screen,0,sizeof(screen));
+		for (l=0;l<comp->num;l++)
+		{
+			tLayer* layer=&comp->layers[l];
+			unsigned long long image[CANVAS_WIDTH/8];
+			unsigned long long mask[CANVAS_WIDTH/8];
+			if (!layer->visible || !(layer_screenpages(layer,layer->used)&(1<<page))) continue;
+			layer_page(layer,layer->canvas,page,image);
+			switch (layer->blend)
+			{
+				case BLIT_OR:		for (i=0;i<CANVAS_WIDTH/8;i++) screen[i]|=image[i];break;
+				case BLIT_ANDNOT:	for (i=0;i<CANVAS_WIDTH/8;i++) screen[i]&=~image[i];break;
+				case BLIT_XOR:		for (i=0;i<CANVAS_WIDTH/8;i++) screen[i]^=image[i];break;
+				case BLIT_MASKED:
+					layer_page(layer,layer->mask,page,mask);
+					for (i=0;i<CANVAS_WIDTH/8;i++) screen[i]=(screen[i]&~mask[i])|(image[i]&mask[i]);
+					break;
+			}
+		}
+		memcpy(&comp->screen[page*CANVAS_WIDTH],screen,sizeof(screen));
+	}
+	comp->dirty=0;
+	return dirty;
+}
+// the same, for the whole screen and one pixel at a time
+void compositor_compose_naive(tCompositor* comp,unsigned char* canvas)
+{
+	int x,y;
+	int l;
+	memset(canvas,0,CANVAS_WIDTH*CANVAS_PAGES);
+	for (l=0;l<comp->num;l++)
+	{
+		tLayer* layer=&comp->layers[l];
+		if (!layer->visible) continue;
+		for (y=0;y<CANVAS_PAGES*8;y++)
+		{
+			for (x=0;x<CANVAS_WIDTH;x++)
+			{
+				int lx,ly;
+				int pixel;
+				int masked;
+				unsigned char bit;
+				unsigned char* dst;
+				lx=x-layer->x;
+				ly=y-layer->y;
+				if (lx<0 || lx>=CANVAS_WIDTH || ly<0 || ly>=CANVAS_PAGES*8) continue;
+				pixel=(layer->canvas[(ly/8)*CANVAS_WIDTH+lx]>>(ly%8))&1;
+				masked=(layer->mask[(ly/8)*CANVAS_WIDTH+lx]>>(ly%8))&1;
+				bit=1<<(y%8);
+				dst=&canvas[(y/8)*CANVAS_WIDTH+x];
+				switch (layer->blend)
+				{
+					case BLIT_OR:		if (pixel) *dst|=bit;break;
+					case BLIT_ANDNOT:	if (pixel) *dst&=~bit;break;
+					case BLIT_XOR:		if (pixel) *dst^=bit;break;
+					case BLIT_MASKED:	if (masked) *dst=(*dst&~bit)|((pixel&masked)?bit:0);break;
+				}
+			}
+		}
+	}
+}
+// the scene for the demo and the benchmark: a striped background, a bar at
+// the bottom, a popup which comes and goes, and a cursor moving across
+#define	LAYER_BACKGROUND	0
+#define	LAYER_BAR		1
+#define	LAYER_POPUP		2
+#define	LAYER_CURSOR		3
+void layers_scene(tCompositor* comp)
+{
+	unsigned char cursor[8*8];
+	tSprite arrow;
+	tLayer* layer;
+	int x,y;
+	int i;
+
+	compositor_init(comp,4);
+	layer=&comp->layers[LAYER_BACKGROUND];
+	layer->blend=BLIT_OR;
+	for (i=0;i<CANVAS_WIDTH*CANVAS_PAGES;i++)
+	{
+		layer->canvas[i]=((i%10)<5)?0xff:0x00;
+	}
+	layer_touch(comp,LAYER_BACKGROUND,0xff);
+	comp->layers[LAYER_BAR].blend=BLIT_XOR;
+	// a framed box, which hides what is behind it
+	layer=&comp->layers[LAYER_POPUP];
+	layer->blend=BLIT_MASKED;
+	layer->x=32;
+	layer->y=20;
+	for (y=0;y<24;y++)
+	{
+		for (x=0;x<64;x++)
+		{
+			layer->mask[(y/8)*CANVAS_WIDTH+x]|=1<<(y%8);
+			if (x==0 || y==0 || x==63 || y==23 || (y>=10 && y<14 && x>=8 && x<56)) layer->canvas[(y/8)*CANVAS_WIDTH+x]|=1<<(y%8);
+		}
+	}
+	layer_touch(comp,LAYER_POPUP,0x07);
+	layer=&comp->layers[LAYER_CURSOR];
+	layer->blend=BLIT_XOR;
+	for (i=0;i<8*8;i++)
+	{
+		cursor[i]=((i%8)<=(i/8));	// a triangle
+	}
+	sprite_create(&arrow,cursor,NULL,8,8);
+	sprite_blit(layer->canvas,&arrow,0,0,BLIT_OR);
+	layer_touch(comp,LAYER_CURSOR,0x01);
+	for (i=0;i<comp->num;i++)
+	{
+		layer_show(comp,i,i!=LAYER_POPUP);
+	}
+}
+void layers_frame(tCompositor* comp,int frame)
+{
+	tLayer* bar=&comp->layers[LAYER_BAR];
+	int x;
+	// the bar grows by one column
+	x=frame%CANVAS_WIDTH;
+	if (x==0) layer_clear(comp,LAYER_BAR);
+	bar->canvas[7*CANVAS_WIDTH+x]=0x7e;
+	layer_touch(comp,LAYER_BAR,0x80);
+	layer_show(comp,LAYER_POPUP,(frame/40)%2);
+	layer_move(comp,LAYER_CURSOR,(frame*3)%CANVAS_WIDTH,(frame/2)%(CANVAS_PAGES*8-8));
+}
+void demo_layers()
+{
+	tCompositor comp;
+	unsigned char shadow[CANVAS_WIDTH*CANVAS_PAGES];
+	int frame;
+	layers_scene(&comp);
+	memset(shadow,0,sizeof(shadow));
+	oled_flush(shadow);
+	for (frame=0;frame<400;frame++)
+	{
+		layers_frame(&comp,frame);
+		compositor_compose(&comp);
+		oled_flush_changed(comp.screen,shadow);
+	}
+}
+int bench_layers()
+{
+	#define	BENCH_LAYER_FRAMES	20000
+	static tCompositor comp;
+	unsigned char canvas[CANVAS_WIDTH*CANVAS_PAGES];
+	double t0,t1,t2;
+	long pages;
+	int retval;
+	int frame;
+
+	retval=RETVAL_OK;
+	// correct?
+	layers_scene(&comp);
+	for (frame=0;frame<BENCH_LAYER_FRAMES;frame++)
+	{
+		layers_frame(&comp,frame);
+		compositor_compose(&comp);
+		compositor_compose_naive(&comp,canvas);
+		if (memcmp(canvas,comp.screen,sizeof(canvas))) retval=RETVAL_NOK;
+	}
+	// fast?
+	layers_scene(&comp);
+	pages=0;
+	t0=timestamp();
+	for (frame=0;frame<BENCH_LAYER_FRAMES;frame++)
+	{
+		unsigned int dirty;
+		layers_frame(&comp,frame);
+		dirty=compositor_compose(&comp);
+		pages+=__builtin_popcount(dirty);
+	}
+	t1=timestamp();
+	for (frame=0;frame<BENCH_LAYER_FRAMES;frame++)
+	{
+		layers_frame(&comp,frame);
+		comp.dirty=0xff;
+		compositor_compose(&comp);
+	}
+	t2=timestamp();
+	printf("%d frames, %d layers: %.1f of %d pages composed per frame   %s\n",
+		BENCH_LAYER_FRAMES,comp.num,pages/(double)BENCH_LAYER_FRAMES,CANVAS_PAGES,retval?"MISMATCH":"ok");
+	printf("dirty pages: %.2f us per frame   all pages: %.2f us per frame   speedup: %.1fx\n",
+		(t1-t0)*1e6/BENCH_LAYER_FRAMES,(t2-t1)*1e6/BENCH_LAYER_FRAMES,(t2-t1)/(t1-t0));
+	// and the way it used to be done: drawing everything into a bitmap, for oled_draw()
+	t0=timestamp();
+	for (frame=0;frame<BENCH_LAYER_FRAMES/100;frame++)
+	{
+		layers_frame(&comp,frame);
+		compositor_compose_naive(&comp,canvas);
+	}
+	t1=timestamp();
+	printf("pixel by pixel: %.2f us per frame\n",(t1-t0)*1e6/(BENCH_LAYER_FRAMES/100));
+	return retval;
+}
+
+// chart widgets, for live values. the samples are kept in a ring buffer,
+// and every new sample only sends what it changes:
+// - the sweep graph draws the new sample into the next column, and clears
+//   the one after it, like an oscilloscope. one column per sample.
+// - the strip chart uses the whole display, and scrolls it with the start
+//   line register. the new sample is one row at the bottom, with time
+//   running upwards. the row which is reused only has to be cleared where
+//   it had pixels.
+// - the gauge is a set of bars, and only the pages in which a bar got
+//   longer or shorter are sent.
+typedef struct _tChart
+{
+	int x;			// columns x..x+width-1
+	int page;		// pages page..page+pages-1
+	int width;
+	int pages;
+	int lo,hi;		// the range of the values
+	unsigned int num;	// the number of samples so far. sample n is in samples[n%CHART_MAXSAMPLES]
+	int samples[CHART_MAXSAMPLES];
+	// the strip chart: the start line, and what the display RAM holds
+	int startline;
+	int rowfirst[CANVAS_PAGES*8];	// the pixels which are set in a row, from..to
+	int rowlast[CANVAS_PAGES*8];
+	unsigned char ram[CANVAS_PAGES*CANVAS_WIDTH];
+} tChart;
+
+typedef struct _tGauge
+{
+	int x;
+	int page;
+	int pages;
+	int barwidth;
+	int num;
+	int lo,hi;
+	int values[GAUGE_MAXBARS];
+} tGauge;
+
+void chart_init(tChart* chart,int x,int page,int width,int pages,int lo,int hi)
+{
+	int i;
+	memset(chart,0,sizeof(tChart));
+	chart->x=x;
+	chart->page=page;
+	chart->width=width;
+	chart->pages=pages;
+	chart->lo=lo;
+	chart->hi=hi;
+	for (i=0;i<CANVAS_PAGES*8;i++)
+	{
+		chart->rowfirst[i]=0;
+		chart->rowlast[i]=-1;
+	}
+}
+// scales a value to 0..steps-1
+int chart_scale(tChart* chart,int value,int steps)
+{
+	if (value<=chart->lo) return 0;
+	if (value>=chart->hi) return steps-1;
+	return (value-chart->lo)*(steps-1)/(chart->hi-chart->lo);
+}
+int chart_sample(tChart* chart,unsigned int n)
+{
+	return chart->samples[n%CHART_MAXSAMPLES];
+}
+// one column of the sweep graph: a vertical line from the previous sample to sample n
+void sweep_column(tChart* chart,unsigned int n,unsigned char* column)
+{
+	int y0,y1;
+	int y;
+	memset(column,0,chart->pages);
+	y1=chart->pages*8-1-chart_scale(chart,chart_sample(chart,n),chart->pages*8);
+	y0=n?chart->pages*8-1-chart_scale(chart,chart_sample(chart,n-1),chart->pages*8):y1;
+	if (y0>y1) {y=y0;y0=y1;y1=y;}
+	for (y=y0;y<=y1;y++)
+	{
+		column[y/8]|=1<<(y%8);
+	}
+}
+// returns the number of bytes appended to the transaction
+int sweep_push(tChart* chart,int value,tTransaction* txn)
+{
+	unsigned char column[CANVAS_PAGES];
+	int len;
+	int x;
+	int p;
+	len=txn->len;
+	chart->samples[chart->num%CHART_MAXSAMPLES]=value;
+	sweep_column(chart,chart->num,column);
+	x=chart->num%chart->width;
+	for (p=0;p<chart->pages;p++)
+	{
+		unsigned char bytes[2];
+		bytes[0]=column[p];
+		bytes[1]=0;		// the gap in front of the oldest sample
+		txn_address(txn,chart->page+p,chart->x+x);
+		txn_data(txn,bytes,(x+1<chart->width)?2:1);
+		if (x+1==chart->width)
+		{
+			txn_address(txn,chart->page+p,chart->x);
+			txn_data(txn,&bytes[1],1);
+		}
+	}
+	chart->num++;
+	return txn->len-len;
+}
+// the whole sweep graph, into a canvas
+void sweep_render(tChart* chart,unsigned char* canvas)
+{
+	unsigned char column[CANVAS_PAGES];
+	unsigned int n;
+	int p;
+	for (p=0;p<chart->pages;p++)
+	{
+		memset(&canvas[(chart->page+p)*CANVAS_WIDTH+chart->x],0,chart->width);
+	}
+	for (n=(chart->num>=(unsigned int)chart->width)?chart->num-chart->width+1:0;n<chart->num;n++)
+	{
+		sweep_column(chart,n,column);
+		for (p=0;p<chart->pages;p++)
+		{
+			canvas[(chart->page+p)*CANVAS_WIDTH+chart->x+n%chart->width]=column[p];
+		}
+	}
+}
+// the strip chart covers the whole display. a row is a horizontal line from
+// the previous sample to the new one. it expects the start line to be 0, and
+// the display to be empty, when it starts.
+void strip_span(tChart* chart,unsigned int n,int* x0,int* x1)
+{
+	int x;
+	*x1=chart_scale(chart,chart_sample(chart,n),CANVAS_WIDTH);
+	*x0=n?chart_scale(chart,chart_sample(chart,n-1),CANVAS_WIDTH):*x1;
+	if (*x0>*x1) {x=*x0;*x0=*x1;*x1=x;}
+}
+int strip_push(tChart* chart,int value,tTransaction* txn)
+{
+	unsigned char* ram;
+	unsigned char bit;
+	int len;
+	int ramrow;
+	int first,last;
+	int x0,x1;
+	int x;
+	len=txn->len;
+	chart->samples[chart->num%CHART_MAXSAMPLES]=value;
+	strip_span(chart,chart->num,&x0,&x1);
+	chart->num++;
+	// the row at the top moves to the bottom, and gets the new sample
+	chart->startline=(chart->startline+1)&63;
+	ramrow=(chart->startline+63)&63;
+	ram=&chart->ram[(ramrow/8)*CANVAS_WIDTH];
+	bit=1<<(ramrow%8);
+	first=x0;
+	last=x1;
+	if (chart->rowlast[ramrow]>=0)
+	{
+		if (chart->rowfirst[ramrow]<first) first=chart->rowfirst[ramrow];
+		if (chart->rowlast[ramrow]>last) last=chart->rowlast[ramrow];
+	}
+	for (x=chart->rowfirst[ramrow];x<=chart->rowlast[ramrow];x++) ram[x]&=~bit;
+	for (x=x0;x<=x1;x++) ram[x]|=bit;
+	chart->rowfirst[ramrow]=x0;
+	chart->rowlast[ramrow]=x1;
+	txn_address(txn,ramrow/8,first);
+	txn_data(txn,&ram[first],last-first+1);
+	txn_command(txn,0x40|chart->startline);
+	return txn->len-len;
+}
+// what the strip chart should look like: the newest sample in the bottom row
+void strip_render(tChart* chart,unsigned char* canvas)
+{
+	unsigned int k;
+	memset(canvas,0,CANVAS_WIDTH*CANVAS_PAGES);
+	for (k=0;k<chart->num && k<CANVAS_PAGES*8;k++)
+	{
+		int x0,x1;
+		int x;
+		int y;
+		strip_span(chart,chart->num-1-k,&x0,&x1);
+		y=CANVAS_PAGES*8-1-k;
+		for (x=x0;x<=x1;x++)
+		{
+			canvas[(y/8)*CANVAS_WIDTH+x]|=1<<(y%8);
+		}
+	}
+}
+
+int gauge_init(tGauge* gauge,int x,int page,int pages,int barwidth,int num,int lo,int hi)
+{
+	if (barwidth<1 || barwidth>GAUGE_MAXWIDTH || num<1 || num>GAUGE_MAXBARS)
+	{
+		fprintf(stderr,"%d bars of %d columns are not supported\n",num,barwidth);
+		return RETVAL_NOK;
+	}
+	// the bars, with a column between them
+	if (x<0 || x+num*(barwidth+1)-1>CANVAS_WIDTH || page<0 || pages<1 || page+pages>CANVAS_PAGES || hi<=lo)
+	{
+		fprintf(stderr,"the gauge does not fit on the display\n");
+		return RETVAL_NOK;
+	}
+	memset(gauge,0,sizeof(tGauge));
+	gauge->x=x;
+	gauge->page=page;
+	gauge->pages=pages;
+	gauge->barwidth=barwidth;
+	gauge->num=num;
+	gauge->lo=lo;
+	gauge->hi=hi;
+	for (x=0;x<num;x++)
+	{
+		gauge->values[x]=lo;
+	}
+	return RETVAL_OK;
+}
+// in pixels, 0..pages*8
+int gauge_height(tGauge* gauge,int value)
+{
+	if (value<=gauge->lo) return 0;
+	if (value>=gauge->hi) return gauge->pages*8;
+	return (value-gauge->lo)*gauge->pages*8/(gauge->hi-gauge->lo);
+}
+// page p of a bar, which grows from the bottom
+unsigned char gauge_byte(tGauge* gauge,int height,int p)
+{
+	int top;
+	top=gauge->pages*8-height-p*8;	// the first row of the bar, within the page
+	if (top<=0) return 0xff;
+	if (top>=8) return 0x00;
+	return 0xff<<top;
+}
+int gauge_set(tGauge* gauge,int bar,int value,tTransaction* txn)
+{
+	unsigned char bytes[GAUGE_MAXWIDTH];
+	int len;
+	int h0,h1;
+	int p;
+	if (bar<0 || bar>=gauge->num)
+	{
+		fprintf(stderr,"the gauge has no bar %d\n",bar);
+		return RETVAL_NOK;
+	}
+	len=txn->len;
+	h0=gauge_height(gauge,gauge->values[bar]);
+	h1=gauge_height(gauge,value);
+	gauge->values[bar]=value;
+	for (p=0;p<gauge->pages && h0!=h1;p++)
+	{
+		unsigned char byte;
+		byte=gauge_byte(gauge,h1,p);
+		if (byte==gauge_byte(gauge,h0,p)) continue;
+		memset(bytes,byte,gauge->barwidth);
+		txn_address(txn,gauge->page+p,gauge->x+bar*(gauge->barwidth+1));
+		txn_data(txn,bytes,gauge->barwidth);
+	}
+	return txn->len-len;
+}
+void gauge_render(tGauge* gauge,unsigned char* canvas)
+{
+	int bar;
+	int p;
+	for (p=0;p<gauge->pages;p++)
+	{
+		unsigned char* dst;
+		dst=&canvas[(gauge->page+p)*CANVAS_WIDTH+gauge->x];
+		memset(dst,0,gauge->num*(gauge->barwidth+1)-1);
+		for (bar=0;bar<gauge->num;bar++)
+		{
+			memset(&dst[bar*(gauge->barwidth+1)],gauge_byte(gauge,gauge_height(gauge,gauge->values[bar]),p),gauge->barwidth);
+		}
+	}
+}
+// something like a CPU load, 0..100
+int chart_metric(int value)
+{
+	value+=rand()%21-10;
+	if (value<0) value=0;
+	if (value>100) value=100;
+	return value;
+}
+typedef struct _tChartCost
+{
+	int updates;
+	long bytes;
+	double seconds;
+} tChartCost;
+void chart_cost(const char* name,tChartCost* cost)
+{
+	printf("%-12s %6d updates: %6.1f bytes and %8.1f us per update\n",name,cost->updates,
+		cost->updates?cost->bytes/(double)cost->updates:0.0,cost->updates?cost->seconds*1e6/cost->updates:0.0);
+}
+// a sweep graph on the left, and 4 bars on the right. then the strip chart.
+void charts_run(int samples,tChartCost* costs,tDisplayModel* model,int* mismatches)
+{
+	unsigned char expected[CANVAS_WIDTH*CANVAS_PAGES];
+	unsigned char shown[CANVAS_WIDTH*CANVAS_PAGES];
+	tTransaction txn;
+	tChart chart;
+	tGauge gauge;
+	int values[4];
+	int value;
+	int i;
+	int j;
+
+	memset(costs,0,3*sizeof(tChartCost));
+	memset(expected,0,sizeof(expected));
+	oled_flush(expected);
+	chart_init(&chart,0,0,96,CANVAS_PAGES,0,100);
+	if (gauge_init(&gauge,96,0,CANVAS_PAGES,7,4,0,100)!=RETVAL_OK)
+	{
+		(*mismatches)++;
+		return;
+	}
+	value=50;
+	for (j=0;j<4;j++)
+	{
+		values[j]=50;
+	}
+	txn_init(&txn);
+	for (i=0;i<samples;i++)
+	{
+		double t0;
+		value=chart_metric(value);
+		t0=timestamp();
+		costs[0].bytes+=sweep_push(&chart,value,&txn);
+		txn_submit(&txn);
+		costs[0].seconds+=timestamp()-t0;
+		costs[0].updates++;
+		for (j=0;j<4;j++)
+		{
+			values[j]=chart_metric(values[j]);
+			t0=timestamp();
+			costs[1].bytes+=gauge_set(&gauge,j,values[j],&txn);
+			txn_submit(&txn);
+			costs[1].seconds+=timestamp()-t0;
+			costs[1].updates++;
+		}
+	}
+	if (model!=NULL)
+	{
+		sweep_render(&chart,expected);
+		gauge_render(&gauge,expected);
+		model_canvas(model,shown);
+		if (memcmp(expected,shown,sizeof(shown))) (*mismatches)++;
+	}
+
+	memset(expected,0,sizeof(expected));
+	oled_flush(expected);
+	chart_init(&chart,0,0,CANVAS_WIDTH,CANVAS_PAGES,0,100);
+	for (i=0;i<samples;i++)
+	{
+		double t0;
+		value=chart_metric(value);
+		t0=timestamp();
+		costs[2].bytes+=strip_push(&chart,value,&txn);
+		txn_submit(&txn);
+		costs[2].seconds+=timestamp()-t0;
+		costs[2].updates++;
+	}
+	if (model!=NULL)
+	{
+		strip_render(&chart,expected);
+		model_canvas(model,shown);
+		if (memcmp(expected,shown,sizeof(shown))) (*mismatches)++;
+	}
+	// back to normal
+	txn_command(&txn,0x40);
+	txn_submit(&txn);
+}
+void demo_charts()
+{
+	tChartCost costs[3];
+	srand(time(NULL));
+	charts_run(300,costs,NULL,NULL);
+	chart_cost("sweep graph",&costs[0]);
+	chart_cost("gauge bar",&costs[1]);
+	chart_cost("strip chart",&costs[2]);
+}
+int bench_charts()
+{
+	tChartCost costs[3];
+	tChartCost full;
+	tGpioRecorder rec;
+	tDisplayModel model;
+	unsigned char canvas[CANVAS_WIDTH*CANVAS_PAGES];
+	int mismatches;
+	int i;
+	double t0;
+
+	memset(&model,0,sizeof(model));
+	rec.max=0;
+	rec.pins=NULL;
+	rec.values=NULL;
+	rec.model=&model;
+	rec.fd=open("/dev/null",O_WRONLY);	// about the cost of the sysfs writes
+	gpio_record(&rec);
+	srand(1);
+	mismatches=0;
+	charts_run(1000,costs,&model,&mismatches);
+	// and the way it used to be done: the whole display for every sample
+	memset(canvas,0x55,sizeof(canvas));
+	memset(&full,0,sizeof(full));
+	t0=timestamp();
+	for (i=0;i<100;i++)
+	{
+		oled_flush(canvas);
+	}
+	full.seconds=timestamp()-t0;
+	full.updates=100;
+	full.bytes=100*CANVAS_PAGES*(CANVAS_WIDTH+3);
+	chart_cost("sweep graph",&costs[0]);
+	chart_cost("gauge bar",&costs[1]);
+	chart_cost("strip chart",&costs[2]);
+	chart_cost("full frame",&full);
+	printf("the display shows what it should: %s\n",mismatches?"NO":"yes");
+	gpio_record(NULL);
+	close(rec.fd);
+	return mismatches?RETVAL_NOK:RETVAL_OK;
+}
+
+// several panels can share SCLK, when each one has its own MOSI (and DC and
+// CS, or they share those as well). a GPIO controller has a register to set
+// pins and one to clear them, so one write can clock a different bit to
+// every panel: N frames go out in the time of one. the bytes of the lanes are
+// transposed, 8 lanes at a time, so that byte b holds bit b of every lane,
+// and a table turns that into the mask of the MOSI pins.
+typedef struct _tLanes
+{
+	int num;
+	int mosi[LANES_MAX];
+	int dc[LANES_MAX];
+	int cs[LANES_MAX];
+	unsigned long long dcmask;
+	unsigned long long csmask;
+	unsigned long long sclkmask;
+	unsigned long long mosimask[256];	// the MOSI pins of a set of lanes
+} tLanes;
+
+// a stand-in for the set and clear registers: an image of the pin levels.
+// it counts the register writes, and decodes what every panel receives.
+typedef struct _tGpioRegisters
+{
+	unsigned long long level;
+	long writes;
+	tLanes* lanes;
+	tDisplayModel* models;	// one per lane
+} tGpioRegisters;
+tGpioRegisters* gpio_registers=NULL;
+
+// a pin is bit (pin%64) of the registers. the sysfs transport has no
+// registers, so there, the pins are written one after the other.
+#define	GPIO_BIT(pin)	(1ULL<<((pin)&63))
+void gpio_write_masks(unsigned long long set,unsigned long long clear)
+{
+	if (gpio_registers!=NULL)
+	{
+		tGpioRegisters* regs=gpio_registers;
+		int l;
+		if (clear) {regs->level&=~clear;regs->writes++;}
+		if (set) {regs->level|=set;regs->writes++;}
+		for (l=0;l<regs->lanes->num;l++)
+		{
+			tLanes* lanes=regs->lanes;
+			if (regs->level&GPIO_BIT(lanes->cs[l])) continue;	// not selected
+			model_levels(&regs->models[l],(regs->level&GPIO_BIT(lanes->mosi[l]))!=0,
+				(regs->level&lanes->sclkmask)!=0,(regs->level&GPIO_BIT(lanes->dc[l]))!=0);
+		}
+	} else {
+		int l;
+		for (l=0;l<64;l++)
+		{
+			if (clear&(1ULL<<l)) gpio_write(l,0);
+			if (set&(1ULL<<l)) gpio_write(l,1);
+		}
+	}
+}
+int lanes_init(tLanes* lanes,int num,const int* mosi,const int* dc,const int* cs)
+{
+	unsigned long long used;
+	int l;
+	int i;
+	if (num<1 || num>LANES_MAX)
+	{
+		fprintf(stderr,"%d lanes are not supported\n",num);
+		return RETVAL_NOK;
+	}
+	memset(lanes,0,sizeof(tLanes));
+	lanes->num=num;
+	lanes->sclkmask=GPIO_BIT(PIN_SCLK);
+	used=lanes->sclkmask;
+	for (l=0;l<num;l++)
+	{
+		lanes->mosi[l]=mosi[l];
+		lanes->dc[l]=dc[l];
+		lanes->cs[l]=cs[l];
+		lanes->dcmask|=GPIO_BIT(dc[l]);
+		lanes->csmask|=GPIO_BIT(cs[l]);
+		if (mosi[l]<0 || mosi[l]>=64 || dc[l]<0 || dc[l]>=64 || cs[l]<0 || cs[l]>=64 || PIN_SCLK>=64)
+		{
+			fprintf(stderr,"the pins of lane %d are not all in the register\n",l);
+			return RETVAL_NOK;
+		}
+		if (used&GPIO_BIT(mosi[l]))
+		{
+			fprintf(stderr,"MOSI pin %d of lane %d is used twice\n",mosi[l],l);
+			return RETVAL_NOK;
+		}
+		used|=GPIO_BIT(mosi[l]);
+	}
+	if ((lanes->dcmask|lanes->csmask)&used)
+	{
+		fprintf(stderr,"the DC and CS pins of the lanes collide with MOSI or SCLK\n");
+		return RETVAL_NOK;
+	}
+	for (i=0;i<256;i++)
+	{
+		for (l=0;l<num;l++)
+		{
+			if (i&(1<<l)) lanes->mosimask[i]|=GPIO_BIT(mosi[l]);
+		}
+	}
+	return RETVAL_OK;
+}
+// byte k of every lane, MSB first, SPI mode 0. per bit, the data and the
+// falling clock go out together (clear and set register), then the rising
+// clock.
+void lanes_writebuf(tLanes* lanes,unsigned char** bufs,int len)
+{
+	unsigned long long all;
+	int k;
+	all=lanes->mosimask[(1<<lanes->num)-1];
+	for (k=0;k<len;k++)
+	{
+		unsigned long long x;
+		int l;
+		int b;
+		x=0;
+		for (l=0;l<lanes->num;l++)
+		{
+			x|=((unsigned long long)bufs[l][k])<<(8*l);
+		}
+		x=transpose64(x);	// byte b now holds bit b of every lane
+		for (b=7;b>=0;b--)
+		{
+			unsigned long long set;
+			set=lanes->mosimask[(x>>(8*b))&0xff];
+			gpio_write_masks(set,(all&~set)|lanes->sclkmask);
+			gpio_write_masks(lanes->sclkmask,0);
+		}
+	}
+	gpio_write_masks(0,lanes->sclkmask);
+}
+// every lane gets its own canvas, all at the same time
+void lanes_flush(tLanes* lanes,unsigned char** canvases)
+{
+	unsigned char commands[3];
+	unsigned char* bufs[LANES_MAX];
+	int page;
+	int l;
+	gpio_write_masks(0,lanes->csmask);	// select all of them
+	for (page=0;page<CANVAS_PAGES;page++)
+	{
+		// the same commands for every panel
+		commands[0]=0xb0+page;
+		commands[1]=0x00|(oled_columnoffset&0xf);
+		commands[2]=0x10|(oled_columnoffset>>4);
+		for (l=0;l<lanes->num;l++)
+		{
+			bufs[l]=commands;
+		}
+		gpio_write_masks(0,lanes->dcmask);
+		lanes_writebuf(lanes,bufs,3);
+		for (l=0;l<lanes->num;l++)
+		{
+			bufs[l]=&canvases[l][page*CANVAS_WIDTH];
+		}
+		gpio_write_masks(lanes->dcmask,0);
+		lanes_writebuf(lanes,bufs,CANVAS_WIDTH);
+	}
+	gpio_write_masks(lanes->csmask,0);
+}
+int bench_lanes()
+{
+	#define	BENCH_LANE_FRAMES	20
+	static unsigned char frames[LANES_MAX][CANVAS_WIDTH*CANVAS_PAGES];
+	unsigned char* canvases[LANES_MAX];
+	unsigned char shown[CANVAS_WIDTH*CANVAS_PAGES];
+	tDisplayModel models[LANES_MAX];
+	tGpioRegisters regs;
+	tGpioRecorder rec;
+	tLanes lanes;
+	int mosi[LANES_MAX];
+	int dc[LANES_MAX];
+	int cs[LANES_MAX];
+	int retval;
+	int num;
+	int l;
+	int i;
+
+	retval=RETVAL_OK;
+	srand(1);
+	for (l=0;l<LANES_MAX;l++)
+	{
+		for (i=0;i<CANVAS_WIDTH*CANVAS_PAGES;i++)
+		{
+			frames[l][i]=rand();
+		}
+		canvases[l]=frames[l];
+		// made up pins: the panels have their own MOSI and DC, and share CS
+		mosi[l]=32+l;
+		dc[l]=48+l;
+		cs[l]=PIN_CS;
+	}
+	// one panel, the way oled_flush() does it, for comparison
+	rec.max=0;
+	rec.pins=NULL;
+	rec.values=NULL;
+	rec.model=NULL;
+	rec.fd=-1;
+	gpio_record(&rec);
+	rec.num=0;
+	for (i=0;i<BENCH_LANE_FRAMES;i++)
+	{
+		oled_flush(frames[0]);
+	}
+	gpio_record(NULL);
+	printf("one panel, one pin at a time: %ld pin writes per frame\n",(long)rec.num/BENCH_LANE_FRAMES);
+
+	for (num=1;num<=LANES_MAX;num++)
+	{
+		double t0,t1;
+		int ok;
+		if (lanes_init(&lanes,num,mosi,dc,cs)!=RETVAL_OK) return RETVAL_NOK;
+		memset(&regs,0,sizeof(regs));
+		memset(models,0,sizeof(models));
+		regs.level=lanes.csmask;
+		regs.lanes=&lanes;
+		regs.models=models;
+		gpio_registers=&regs;
+		t0=timestamp();
+		for (i=0;i<BENCH_LANE_FRAMES;i++)
+		{
+			lanes_flush(&lanes,canvases);
+		}
+		t1=timestamp();
+		gpio_registers=NULL;
+		ok=1;
+		for (l=0;l<num;l++)
+		{
+			model_canvas(&models[l],shown);
+			if (memcmp(shown,frames[l],sizeof(shown))) ok=0;
+		}
+		if (!ok) retval=RETVAL_NOK;
+		printf("%d lanes: %6ld register writes per pass, %6ld per panel frame, %7.1f us per pass   %s\n",
+			num,regs.writes/BENCH_LANE_FRAMES,regs.writes/BENCH_LANE_FRAMES/num,(t1-t0)*1e6/BENCH_LANE_FRAMES,ok?"ok":"MISMATCH");
+	}
+	return retval;
+}
+
+// the sysfs transports, on regular files which stand in for the value files.
+// then all the writes go into one file, to check that they arrive in order.
+int bench_uring()
+{
+	#define	BENCH_URING_FRAMES	10
+	const char* names[3]={"open/write/close","kept open","io_uring"};
+	const int pins[3]={PIN_MOSI,PIN_SCLK,PIN_DC};
+	unsigned char canvas[CANVAS_WIDTH*CANVAS_PAGES];
+	char root[64];
+	char path[128];
+	tGpioRecorder rec;
+	unsigned char* logged;
+	int retval;
+	int transport;
+	int len;
+	int fd;
+	int i;
+
+	retval=RETVAL_OK;
+	snprintf(root,sizeof(root),"/tmp/oledtest.gpio.%d",(int)getpid());
+	mkdir(root,0700);
+	for (i=0;i<3;i++)
+	{
+		snprintf(path,sizeof(path),"%s/gpio%d",root,pins[i]);
+		mkdir(path,0700);
+		snprintf(path,sizeof(path),"%s/gpio%d/value",root,pins[i]);
+		fd=open(path,O_WRONLY|O_CREAT|O_TRUNC,0600);
+		if (fd<0) return RETVAL_NOK;
+		close(fd);
+	}
+	gpio_root=root;
+	srand(1);
+	for (i=0;i<CANVAS_WIDTH*CANVAS_PAGES;i++)
+	{
+		canvas[i]=rand();
+	}
+	for (transport=GPIO_SYSFS_OPEN;transport<=GPIO_SYSFS_URING;transport++)
+	{
+		double t0,t1;
+		if (gpio_transport_set(transport)!=transport) continue;
+		gpio_syscalls=0;
+		t0=timestamp();
+		for (i=0;i<BENCH_URING_FRAMES;i++)
+		{
+			oled_flush(canvas);
+		}
+		t1=timestamp();
+		printf("%-18s %8ld syscalls per frame, %8.2f ms per frame\n",names[transport],gpio_syscalls/BENCH_URING_FRAMES,(t1-t0)*1000/BENCH_URING_FRAMES);
+		gpio_valuefds_close();
+	}
+
+	// what has to be written, and in which order
+	rec.max=CANVAS_PAGES*(CANVAS_WIDTH+3)*WAVE_MAXSTEPS+CANVAS_PAGES*4;
+	rec.num=0;
+	rec.pins=malloc(rec.max*sizeof(int));
+	rec.values=malloc(rec.max);
+	logged=malloc(2*rec.max+2);
+	rec.model=NULL;
+	rec.fd=-1;
+	if (rec.pins==NULL || rec.values==NULL || logged==NULL) return RETVAL_NOK;
+	gpio_record(&rec);
+	oled_flush(canvas);
+	gpio_record(NULL);
+	snprintf(path,sizeof(path),"%s/log",root);
+	gpio_logfd=open(path,O_RDWR|O_CREAT|O_TRUNC|O_APPEND,0600);
+	if (gpio_transport==GPIO_SYSFS_URING && gpio_logfd>=0)
+	{
+		oled_flush(canvas);
+		len=pread(gpio_logfd,logged,2*rec.max+2,0);
+		if (len!=2*rec.num) retval=RETVAL_NOK;
+		for (i=0;i<rec.num && retval==RETVAL_OK;i++)
+		{
+			if (logged[2*i]!=(unsigned char)rec.pins[i] || logged[2*i+1]!=(rec.values[i]?'1':'0')) retval=RETVAL_NOK;
+		}
+		printf("%d pin changes through io_uring, in the right order: %s\n",rec.num,retval?"NO":"yes");
+	}
+	close(gpio_logfd);
+	gpio_logfd=-1;
+	unlink(path);
+	free(rec.pins);
+	free(rec.values);
+	free(logged);
+	gpio_valuefds_close();
+	gpio_transport=GPIO_SYSFS_OPEN;
+	for (i=0;i<3;i++)
+	{
+		snprintf(path,sizeof(path),"%s/gpio%d/value",root,pins[i]);
+		unlink(path);
+		snprintf(path,sizeof(path),"%s/gpio%d",root,pins[i]);
+		rmdir(path);
+	}
+	rmdir(root);
+	return retval;
+}
+
+int sh1106_up()
+{
+	int retval;
+	retval=RETVAL_OK;
+	retval|=gpio_pins_up();
+	// spi mode 0
+	// spi master
+	// spi clock div 2
+	// spi msbfirst
+
+	// ?? tell the device it should take orders from SPI??
+	retval|=gpio_write(PIN_BL,1);
+	retval|=gpio_write(PIN_CS,0);
+	
+	if (retval==RETVAL_OK)
+	{	
+		oled_reset();
+		oled_init();
+	}
+	return retval;
+}
+int sh1106_down()
+{
+	if (gpio_transport==GPIO_SYSFS_URING) uring_submit(&gpio_uring);
+	gpio_valuefds_close();
+	return gpio_pins_down();
+}
+const char* tracepath=NULL;
+void graceFulExit(int signal_number)
 {
 	printf("shutting down display...\n");
 	sh1106_down();
+	if (tracepath!=NULL) trace_vcd(gpio_trace,tracepath);
 	exit(0);
 }
+// grayscale images are converted straight into the page format. for the
+// threshold and the ordered dithering, every pixel is compared to a
+// threshold which only depends on x%8 and y%8. since a page has 8 rows, the
+// threshold for row j of any page is the same. the comparison results for
+// the 8 rows are masked with their bit, and ORed together, which makes the
+// transposition into the page format a part of the conversion.
+const unsigned char bayer8x8[8][8]={
+	{ 0,32, 8,40, 2,34,10,42},
+	{48,16,56,24,50,18,58,26},
+	{12,44, 4,36,14,46, 6,38},
+	{60,28,52,20,62,30,54,22},
+	{ 3,35,11,43, 1,33, 9,41},
+	{51,19,59,27,49,17,57,25},
+	{15,47, 7,39,13,45, 5,37},
+	{63,31,55,23,61,29,53,21}
+};
+
+void convert_rgb2gray(unsigned char* gray,const unsigned char* rgb,int pixels)
+{
+	int i;
+	for (i=0;i<pixels;i++)
+	{
+		gray[i]=(77*rgb[3*i+0]+150*rgb[3*i+1]+29*rgb[3*i+2])>>8;
+	}
+}
+// a pixel is set when its value is >= thresholds[y%8][x%8].
+void convert_ordered_scalar(unsigned char* canvas,const unsigned char* gray,int stride,unsigned char thresholds[8][8])
+{
+	int page;
+	int x;
+	int j;
+	for (page=0;page<CANVAS_PAGES;page++)
+	{
+		const unsigned char* src;
+		src=&gray[page*8*stride];
+		for (x=0;x<CANVAS_WIDTH;x++)
+		{
+			unsigned char byte;
+			byte=0;
+			for (j=0;j<8;j++)
+			{
+				if (src[j*stride+x]>=thresholds[j][x%8]) byte|=(1<<j);
+			}
+			canvas[page*CANVAS_WIDTH+x]=byte;
+		}
+	}
+}
+// the same, 16 columns at a time
+void convert_ordered_simd(unsigned char* canvas,const unsigned char* gray,int stride,unsigned char thresholds[8][8])
+{
+#if defined(__SSE2__)
+	__m128i thr[8];
+	__m128i bit[8];
+	int page;
+	int x;
+	int j;
+	for (j=0;j<8;j++)
+	{
+		thr[j]=_mm_loadl_epi64((const __m128i*)thresholds[j]);
+		thr[j]=_mm_unpacklo_epi64(thr[j],thr[j]);
+		bit[j]=_mm_set1_epi8(1<<j);
+	}
+	for (page=0;page<CANVAS_PAGES;page++)
+	{
+		const unsigned char* src;
+		src=&gray[page*8*stride];
+		for (x=0;x<CANVAS_WIDTH;x+=16)
+		{
+			__m128i acc;
+			acc=_mm_setzero_si128();
+			for (j=0;j<8;j++)
+			{
+				__m128i v;
+				__m128i ge;
+				v=_mm_loadu_si128((const __m128i*)&src[j*stride+x]);
+				ge=_mm_cmpeq_epi8(_mm_max_epu8(v,thr[j]),v);	// v>=thr, without an unsigned compare
+				acc=_mm_or_si128(acc,_mm_and_si128(ge,bit[j]));
+			}
+			_mm_storeu_si128((__m128i*)&canvas[page*CANVAS_WIDTH+x],acc);
+		}
+	}
+#elif defined(__ARM_NEON)
+	uint8x16_t thr[8];
+	uint8x16_t bit[8];
+	int page;
+	int x;
+	int j;
+	for (j=0;j<8;j++)
+	{
+		uint8x8_t t;
+		t=vld1_u8(thresholds[j]);
+		thr[j]=vcombine_u8(t,t);
+		bit[j]=vdupq_n_u8(1<<j);
+	}
+	for (page=0;page<CANVAS_PAGES;page++)
+	{
+		const unsigned char* src;
+		src=&gray[page*8*stride];
+		for (x=0;x<CANVAS_WIDTH;x+=16)
+		{
+			uint8x16_t acc;
+			acc=vdupq_n_u8(0);
+			for (j=0;j<8;j++)
+			{
+				uint8x16_t v;
+				v=vld1q_u8(&src[j*stride+x]);
+				acc=vorrq_u8(acc,vandq_u8(vcgeq_u8(v,thr[j]),bit[j]));
+			}
+			vst1q_u8(&canvas[page*CANVAS_WIDTH+x],acc);
+		}
+	}
+#else
+	convert_ordered_scalar(canvas,gray,stride,thresholds);
+#endif
+}
+// error diffusion has to go pixel by pixel. the bits are set in the canvas directly.
+void convert_diffusion(unsigned char* canvas,const unsigned char* gray,int stride,int method)
+{
+	short err[3][CANVAS_WIDTH+4];	// the error for this row and the next two, with 2 columns of margin on each side
+	int y;
+	int x;
+
+	memset(canvas,0,CANVAS_WIDTH*CANVAS_PAGES);
+	memset(err,0,sizeof(err));
+	for (y=0;y<BITMAP_HEIGHT;y++)
+	{
+		short* e0;
+		short* e1;
+		short* e2;
+		e0=&err[y%3][2];
+		e1=&err[(y+1)%3][2];
+		e2=&err[(y+2)%3][2];
+		for (x=0;x<CANVAS_WIDTH;x++)
+		{
+			int v;
+			int e;
+			v=gray[y*stride+x]+e0[x];
+			if (v>=128)
+			{
+				canvas[(y/8)*CANVAS_WIDTH+x]|=(1<<(y%8));
+				e=v-255;
+			} else {
+				e=v;
+			}
+			if (method==DITHER_FLOYD)
+			{
+				e0[x+1]+=(e*7)/16;
+				e1[x-1]+=(e*3)/16;
+				e1[x  ]+=(e*5)/16;
+				e1[x+1]+=(e*1)/16;
+			} else {
+				// atkinson only passes on 6/8 of the error. this keeps the contrast up.
+				e/=8;
+				e0[x+1]+=e;
+				e0[x+2]+=e;
+				e1[x-1]+=e;
+				e1[x  ]+=e;
+				e1[x+1]+=e;
+				e2[x  ]+=e;
+			}
+		}
+		memset(&err[y%3][0],0,sizeof(err[0]));	// becomes the row after the next one
+	}
+}
+// gray is BITMAP_WIDTH x BITMAP_HEIGHT, with stride bytes from one row to the next.
+void convert_gray(unsigned char* canvas,const unsigned char* gray,int stride,int method,int threshold)
+{
+	unsigned char thresholds[8][8];
+	int i,j;
+	switch (method)
+	{
+		case DITHER_THRESHOLD:
+			memset(thresholds,threshold,sizeof(thresholds));
+			convert_ordered_simd(canvas,gray,stride,thresholds);
+			break;
+		case DITHER_BAYER:
+			for (i=0;i<8;i++)
+			{
+				for (j=0;j<8;j++)
+				{
+					thresholds[i][j]=bayer8x8[i][j]*4+2;
+				}
+			}
+			convert_ordered_simd(canvas,gray,stride,thresholds);
+			break;
+		default:
+			convert_diffusion(canvas,gray,stride,method);
+			break;
+	}
+}
+void convert_rgb(unsigned char* canvas,const unsigned char* rgb,int method,int threshold)
+{
+	unsigned char gray[BITMAP_WIDTH*BITMAP_HEIGHT];
+	convert_rgb2gray(gray,rgb,BITMAP_WIDTH*BITMAP_HEIGHT);
+	convert_gray(canvas,gray,BITMAP_WIDTH,method,threshold);
+}
+int dither_method(const char* name)
+{
+	if (strcmp(name,"threshold")==0) return DITHER_THRESHOLD;
+	if (strcmp(name,"bayer")==0) return DITHER_BAYER;
+	if (strcmp(name,"floyd")==0) return DITHER_FLOYD;
+	if (strcmp(name,"atkinson")==0) return DITHER_ATKINSON;
+	return -1;
+}
+// a radial gradient with a bit of noise, and a bright bar at the top
+void dither_testimage(unsigned char* gray,int seed)
+{
+	int x,y;
+	srand(seed);
+	for (y=0;y<BITMAP_HEIGHT;y++)
+	{
+		for (x=0;x<BITMAP_WIDTH;x++)
+		{
+			int d;
+			int v;
+			d=(x-64)*(x-64)+(y-32)*(y-32)*4;
+			v=255-d/20+(rand()%16)-8;
+			if (y<6) v=x*2;
+			gray[x+y*BITMAP_WIDTH]=(v<0)?0:((v>255)?255:v);
+		}
+	}
+}
+
+int bench_dither()
+{
+	#define	BENCH_IMAGES	20000
+	const char *names[4]={"threshold","bayer","floyd","atkinson"};
+	unsigned char gray[BITMAP_WIDTH*BITMAP_HEIGHT];
+	unsigned char rgb[BITMAP_WIDTH*BITMAP_HEIGHT*3];
+	unsigned char canvas1[CANVAS_WIDTH*CANVAS_PAGES];
+	unsigned char canvas2[CANVAS_WIDTH*CANVAS_PAGES];
+	unsigned char thresholds[8][8];
+	double mp;
+	int method;
+	int i;
+	int retval;
+
+	retval=RETVAL_OK;
+	dither_testimage(gray,1);
+	mp=BENCH_IMAGES*BITMAP_WIDTH*BITMAP_HEIGHT/1e6;
+	printf("%d images of %dx%d pixels\n",BENCH_IMAGES,BITMAP_WIDTH,BITMAP_HEIGHT);
+	for (method=DITHER_THRESHOLD;method<=DITHER_ATKINSON;method++)
+	{
+		double t0,t1;
+		t0=timestamp();
+		for (i=0;i<BENCH_IMAGES;i++)
+		{
+			gray[i%sizeof(gray)]^=1;	// so that the compiler cannot skip anything
+			convert_gray(canvas1,gray,BITMAP_WIDTH,method,128);
+		}
+		t1=timestamp();
+		printf("%-10s %8.1f MPixel/s",names[method],mp/(t1-t0));
+		if (method==DITHER_THRESHOLD || method==DITHER_BAYER)
+		{
+			int j,k;
+			// the same thresholds as convert_gray() uses, for the scalar version
+			for (j=0;j<8;j++)
+			{
+				for (k=0;k<8;k++)
+				{
+					thresholds[j][k]=(method==DITHER_BAYER)?bayer8x8[j][k]*4+2:128;
+				}
+			}
+			t0=timestamp();
+			for (i=0;i<BENCH_IMAGES;i++)
+			{
+				gray[i%sizeof(gray)]^=1;
+				convert_ordered_scalar(canvas2,gray,BITMAP_WIDTH,thresholds);
+			}
+			t1=timestamp();
+			printf("   scalar %8.1f MPixel/s   %s",mp/(t1-t0),memcmp(canvas1,canvas2,sizeof(canvas1))?"MISMATCH":"ok");
+			if (memcmp(canvas1,canvas2,sizeof(canvas1))) retval=RETVAL_NOK;
+		}
+		printf("\n");
+	}
+	for (i=0;i<BITMAP_WIDTH*BITMAP_HEIGHT;i++)
+	{
+		rgb[3*i+0]=gray[i];
+		rgb[3*i+1]=255-gray[i];
+		rgb[3*i+2]=i;
+	}
+	{
+		double t0,t1;
+		t0=timestamp();
+		for (i=0;i<BENCH_IMAGES;i++)
+		{
+			rgb[i%sizeof(rgb)]^=1;
+			convert_rgb(canvas1,rgb,DITHER_BAYER,128);
+		}
+		t1=timestamp();
+		printf("%-10s %8.1f MPixel/s\n","rgb+bayer",mp/(t1-t0));
+	}
+	return retval;
+}
+void demo_dither(int method)
+{
+	unsigned char gray[BITMAP_WIDTH*BITMAP_HEIGHT];
+	unsigned char canvas[CANVAS_WIDTH*CANVAS_PAGES];
+	int frame;
+	for (frame=0;frame<50;frame++)
+	{
+		dither_testimage(gray,frame);
+		convert_gray(canvas,gray,BITMAP_WIDTH,method,128);
+		oled_flush(canvas);
+		printf("%d\n",frame);
+	}
+}
+
+// the display only knows on and off. but when it alternates between the
+// bit-planes of an image fast enough, the eye averages them: plane k is shown
+// for 2^k slots, so a pixel is lit for a fraction of the time which is
+// proportional to its level. the slots follow a ruler sequence (for 2 bits:
+// 1 0 1, for 3 bits: 2 1 2 0 2 1 2) so that the long planes are spread over
+// the cycle, and only the pages which differ from the plane on the display
+// are sent.
+typedef struct _tGray
+{
+	int bits;
+	int slots;
+	int schedule[GRAY_MAXSLOTS];
+	unsigned char planes[GRAY_MAXBITS][CANVAS_WIDTH*CANVAS_PAGES];
+	unsigned char differs[GRAY_MAXBITS][GRAY_MAXBITS][CANVAS_PAGES];	// 1 if the page has to be sent when going from one plane to the other
+	int shown;		// the plane on the display, -1 if none
+	double slottime;	// seconds per slot, 0 for as fast as possible
+	double deadline;	// when the current slot ends
+	// statistics
+	int cycles;
+	int overruns;		// slots in which the transfer took longer than the slot time
+	long pagessent;
+	double busy;		// seconds spent transferring
+} tGray;
+
+void gray_schedule(tGray* gray,int bits)
+{
+	int i;
+	gray->bits=bits;
+	gray->slots=(1<<bits)-1;
+	for (i=1;i<=gray->slots;i++)
+	{
+		int ctz;
+		ctz=0;
+		while (((i>>ctz)&1)==0) ctz++;
+		gray->schedule[i-1]=bits-1-ctz;
+	}
+	gray->shown=-1;
+	gray->slottime=0;
+	gray->deadline=0;
+	gray->cycles=0;
+	gray->overruns=0;
+	gray->pagessent=0;
+	gray->busy=0;
+}
+// splits an 8 bit image into the bit-planes of its top bits
+void gray_planes(tGray* gray,const unsigned char* image,int stride)
+{
+	int k;
+	int a,b;
+	int page;
+	for (k=0;k<gray->bits;k++)
+	{
+		unsigned char bit;
+		int x;
+		bit=1<<(8-gray->bits+k);
+		for (page=0;page<CANVAS_PAGES;page++)
+		{
+			for (x=0;x<CANVAS_WIDTH;x++)
+			{
+				const unsigned char* src;
+				unsigned char byte;
+				int j;
+				src=&image[page*8*stride+x];
+				byte=0;
+				for (j=0;j<8;j++)
+				{
+					if (src[j*stride]&bit) byte|=(1<<j);
+				}
+				gray->planes[k][page*CANVAS_WIDTH+x]=byte;
+			}
+		}
+	}
+	for (a=0;a<gray->bits;a++)
+	{
+		for (b=0;b<gray->bits;b++)
+		{
+			for (page=0;page<CANVAS_PAGES;page++)
+			{
+				gray->differs[a][b][page]=(memcmp(&gray->planes[a][page*CANVAS_WIDTH],&gray->planes[b][page*CANVAS_WIDTH],CANVAS_WIDTH)!=0);
+			}
+		}
+	}
+	gray->shown=-1;
+}
+// sends the pages of the plane which differ from what is on the display. returns the number of pages.
+int gray_show(tGray* gray,int plane)
+{
+	tTransaction txn;
+	int page;
+	int pages;
+	txn_init(&txn);
+	pages=0;
+	for (page=0;page<CANVAS_PAGES;page++)
+	{
+		if (gray->shown<0 || gray->differs[gray->shown][plane][page])
+		{
+			txn_address(&txn,page,0);
+			txn_data(&txn,&gray->planes[plane][page*CANVAS_WIDTH],CANVAS_WIDTH);
+			pages++;
+		}
+	}
+	if (pages) txn_submit(&txn);
+	gray->shown=plane;
+	return pages;
+}
+// runs one cycle through the schedule. every slot ends at a fixed time, so
+// that the weights stay correct even when some slots have more pages to send.
+// a slot which takes too long counts as an overrun, and the timing starts over.
+void gray_cycle(tGray* gray)
+{
+	int i;
+	for (i=0;i<gray->slots;i++)
+	{
+		double t0,t1;
+		t0=timestamp();
+		gray->pagessent+=gray_show(gray,gray->schedule[i]);
+		t1=timestamp();
+		gray->busy+=t1-t0;
+		if (gray->slottime>0)
+		{
+			gray->deadline+=gray->slottime;
+			if (t1>gray->deadline)
+			{
+				gray->overruns++;
+				gray->deadline=t1;
+			} else {
+				if (gray->deadline-t1>GRAY_SPIN)
+				{
+					struct timespec ts;
+					double wake;
+					wake=gray->deadline-GRAY_SPIN;
+					ts.tv_sec=(time_t)wake;
+					ts.tv_nsec=(long)((wake-ts.tv_sec)*1e9);
+					clock_nanosleep(CLOCK_MONOTONIC,TIMER_ABSTIME,&ts,NULL);
+				}
+				while (timestamp()<gray->deadline);
+			}
+		}
+	}
+	gray->cycles++;
+}
+// the slot time is the longest slot of a few cycles as fast as possible, with
+// some headroom.
+void gray_calibrate(tGray* gray)
+{
+	double longest;
+	int cycle;
+	int i;
+	gray->slottime=0;
+	gray_cycle(gray);	// the first slot sends everything
+	longest=0;
+	for (cycle=0;cycle<4;cycle++)
+	{
+		for (i=0;i<gray->slots;i++)
+		{
+			double t0,t1;
+			t0=timestamp();
+			gray_show(gray,gray->schedule[i]);
+			t1=timestamp();
+			if (t1-t0>longest) longest=t1-t0;
+		}
+	}
+	gray->slottime=longest*1.25;
+	gray->deadline=timestamp();
+	gray->cycles=0;
+	gray->overruns=0;
+	gray->pagessent=0;
+	gray->busy=0;
+}
+void gray_report(tGray* gray,double seconds)
+{
+	double cyclehz;
+	cyclehz=gray->cycles/seconds;
+	printf("%d levels: %6.1f slots/s  %6.1f cycles/s  %5.2f pages/slot  %4.1f%% busy  %d overruns  flicker margin %.2fx\n",
+		1<<gray->bits,
+		cyclehz*gray->slots,cyclehz,
+		gray->cycles?gray->pagessent/(double)(gray->cycles*gray->slots):0.0,
+		100*gray->busy/seconds,gray->overruns,
+		cyclehz/GRAY_FLICKER_HZ);
+}
+// a horizontal gradient, with a vertical one in the lower half
+void gray_testimage(unsigned char* image)
+{
+	int x,y;
+	for (y=0;y<BITMAP_HEIGHT;y++)
+	{
+		for (x=0;x<BITMAP_WIDTH;x++)
+		{
+			image[x+y*BITMAP_WIDTH]=(y<BITMAP_HEIGHT/2)?x*2:(y-BITMAP_HEIGHT/2)*8;
+		}
+	}
+}
+void demo_gray(int bits)
+{
+	#define	DEMO_GRAY_SECONDS	10
+	unsigned char image[BITMAP_WIDTH*BITMAP_HEIGHT];
+	tGray gray;
+	double t0,t1;
+	int second;
+
+	gray_testimage(image);
+	gray_schedule(&gray,bits);
+	gray_planes(&gray,image,BITMAP_WIDTH);
+	oled_clock(OLED_CLOCK_FAST);
+	gray_calibrate(&gray);
+	printf("slot time %.2f ms\n",gray.slottime*1e3);
+	for (second=0;second<DEMO_GRAY_SECONDS;second++)
+	{
+		gray.cycles=gray.overruns=0;
+		gray.pagessent=0;
+		gray.busy=0;
+		t0=timestamp();
+		do
+		{
+			gray_cycle(&gray);
+			t1=timestamp();
+		} while (t1-t0<1.0);
+		gray_report(&gray,t1-t0);
+	}
+	oled_clock(OLED_CLOCK_NORMAL);
+}
+// the same without the display, into the recording transport. this shows
+// how fast the cycling could be, if the GPIOs were as fast as the code.
+int bench_gray()
+{
+	#define	BENCH_GRAY_CYCLES	200
+	unsigned char image[BITMAP_WIDTH*BITMAP_HEIGHT];
+	tGpioRecorder rec;
+	tGray gray;
+	int bits;
+	int pass;
+
+	rec.max=0;	// count, do not record
+	rec.pins=NULL;
+	rec.values=NULL;
+	rec.model=NULL;
+	gpio_record(&rec);
+	gray_testimage(image);
+	for (pass=0;pass<2;pass++)
+	{
+		rec.fd=pass?open("/dev/null",O_WRONLY):-1;
+		printf("%s\n",pass?"with one syscall per write:":"into memory:");
+		for (bits=2;bits<=GRAY_MAXBITS;bits++)
+		{
+			double t0,t1;
+			int i;
+			gray_schedule(&gray,bits);
+			gray_planes(&gray,image,BITMAP_WIDTH);
+			gray_calibrate(&gray);
+			rec.num=0;
+			t0=timestamp();
+			for (i=0;i<BENCH_GRAY_CYCLES/(pass?10:1);i++)
+			{
+				gray_cycle(&gray);
+			}
+			t1=timestamp();
+			gray_report(&gray,t1-t0);
+		}
+		if (rec.fd>=0) close(rec.fd);
+	}
+	gpio_record(NULL);
+	return RETVAL_OK;
+}
+
+// a stream of binary PBM (P4) or PGM (P5) images on stdin, the way
+// ffmpeg -f image2pipe -c:v pgm writes them. the input is read through its own
+// buffer, so that it is possible to tell whether the next frame has
+// arrived already. in that case, the current one is skipped.
+typedef struct _tStream
+{
+	int fd;
+	int live;	// 1 for pipes and sockets. a file has all of its frames available at once
+	int pos;
+	int len;
+	unsigned char buf[STREAM_BUFLEN];
+} tStream;
+
+int stream_fill(tStream* stream)
+{
+	int n;
+	if (stream->pos<stream->len) return RETVAL_OK;
+	n=read(stream->fd,stream->buf,STREAM_BUFLEN);
+	if (n<=0) return RETVAL_NOK;
+	stream->pos=0;
+	stream->len=n;
+	return RETVAL_OK;
+}
+int stream_getc(tStream* stream)
+{
+	if (stream_fill(stream)) return -1;
+	return stream->buf[stream->pos++];
+}
+// reads len bytes into dst, or skips them when dst is NULL
+int stream_read(tStream* stream,unsigned char* dst,int len)
+{
+	while (len)
+	{
+		int n;
+		if (stream_fill(stream)) return RETVAL_NOK;
+		n=stream->len-stream->pos;
+		if (n>len) n=len;
+		if (dst!=NULL)
+		{
+			memcpy(dst,&stream->buf[stream->pos],n);
+			dst+=n;
+		}
+		stream->pos+=n;
+		len-=n;
+	}
+	return RETVAL_OK;
+}
+int stream_available(tStream* stream)
+{
+	int pending;
+	if (ioctl(stream->fd,FIONREAD,&pending)<0) pending=0;
+	return stream->len-stream->pos+pending;
+}
+// a number in the header, after whitespace and comments
+int stream_number(tStream* stream)
+{
+	int c;
+	int value;
+	do
+	{
+		c=stream_getc(stream);
+		if (c=='#')
+		{
+			while (c!='\n' && c>=0) c=stream_getc(stream);
+		}
+	} while (c==' ' || c=='\t' || c=='\r' || c=='\n');
+	if (c<'0' || c>'9') return -1;
+	value=0;
+	while (c>='0' && c<='9')
+	{
+		value=value*10+c-'0';
+		c=stream_getc(stream);
+	}
+	// the single whitespace character after the number has been consumed
+	return value;
+}
+// reads one frame into the canvas. returns the number of bytes in the frame,
+// 0 at the end of the stream and -1 on errors.
+int stream_frame(tStream* stream,unsigned char* canvas,int method)
+{
+	static unsigned char rows[8][STREAM_MAXWIDTH/8];
+	static unsigned char gray[BITMAP_WIDTH*BITMAP_HEIGHT];
+	static unsigned char row[STREAM_MAXWIDTH];
+	unsigned char scale[256];
+	int c;
+	int type;
+	int width,height,maxval;
+	int y;
+
+	do
+	{
+		c=stream_getc(stream);
+	} while (c==' ' || c=='\t' || c=='\r' || c=='\n');
+	if (c<0) return 0;
+	type=stream_getc(stream);
+	if (c!='P' || (type!='4' && type!='5'))
+	{
+		fprintf(stderr,"only binary PBM (P4) and PGM (P5) are supported\n");
+		return RETVAL_NOK;
+	}
+	width=stream_number(stream);
+	height=stream_number(stream);
+	maxval=(type=='5')?stream_number(stream):1;
+	if (width<=0 || width>STREAM_MAXWIDTH || height<=0 || maxval<=0 || maxval>255)
+	{
+		fprintf(stderr,"unsupported image size %dx%d, max value %d\n",width,height,maxval);
+		return RETVAL_NOK;
+	}
+	memset(canvas,0,CANVAS_WIDTH*CANVAS_PAGES);
+	if (type=='4')
+	{
+		// 8 rows at a time are a page. every 8x8 block of bits is transposed into 8 bytes of the page.
+		int rowbytes;
+		int usedbytes;
+		rowbytes=(width+7)/8;
+		usedbytes=(rowbytes<CANVAS_WIDTH/8)?rowbytes:CANVAS_WIDTH/8;
+		for (y=0;y<height;y+=8)
+		{
+			int j;
+			int x;
+			memset(rows,0xff,sizeof(rows));	// 1 is black in PBM
+			for (j=0;j<8 && y+j<height;j++)
+			{
+				if (stream_read(stream,rows[j],rowbytes)) return RETVAL_NOK;
+			}
+			if (y>=BITMAP_HEIGHT) continue;
+			for (x=0;x<usedbytes;x++)
+			{
+				unsigned char block[8];
+				unsigned char* dst;
+				int k;
+				for (j=0;j<8;j++)
+				{
+					block[j]=~rows[j][x];
+				}
+				dst=&canvas[(y/8)*CANVAS_WIDTH+x*8];
+				transpose8x8(dst,block);
+				if (x*8+8>width)
+				{
+					// the padding bits at the end of a row
+					for (k=width-x*8;k<8;k++) dst[k]=0;
+				}
+			}
+		}
+	} else {
+		int usedwidth;
+		usedwidth=(width<BITMAP_WIDTH)?width:BITMAP_WIDTH;
+		for (y=0;y<256;y++)
+		{
+			scale[y]=(y>=maxval)?255:(y*255/maxval);
+		}
+		memset(gray,0,sizeof(gray));
+		for (y=0;y<height;y++)
+		{
+			if (y>=BITMAP_HEIGHT || maxval!=255)
+			{
+				if (stream_read(stream,(y<BITMAP_HEIGHT)?row:NULL,width)) return RETVAL_NOK;
+				if (y<BITMAP_HEIGHT)
+				{
+					int x;
+					for (x=0;x<usedwidth;x++)
+					{
+						gray[y*BITMAP_WIDTH+x]=scale[row[x]];
+					}
+				}
+			} else {
+				// straight into the image
+				if (stream_read(stream,&gray[y*BITMAP_WIDTH],usedwidth)) return RETVAL_NOK;
+				if (stream_read(stream,NULL,width-usedwidth)) return RETVAL_NOK;
+			}
+		}
+		convert_gray(canvas,gray,BITMAP_WIDTH,method,128);
+	}
+	return (type=='4')?((width+7)/8)*height:width*height;
+}
+void demo_stream(int fd,int method)
+{
+	static tStream stream;
+	struct stat st;
+	unsigned char canvas[CANVAS_WIDTH*CANVAS_PAGES];
+	unsigned char shadow[CANVAS_WIDTH*CANVAS_PAGES];
+	int frames;
+	int shown;
+	long bytes;
+	double t0,t1;
+	int n;
+
+	stream.fd=fd;
+	stream.live=!(fstat(fd,&st)==0 && S_ISREG(st.st_mode));
+	stream.pos=stream.len=0;
+	memset(shadow,0,sizeof(shadow));
+	oled_flush(shadow);
+	frames=shown=0;
+	bytes=0;
+	t0=timestamp();
+	while ((n=stream_frame(&stream,canvas,method))>0)
+	{
+		frames++;
+		// when the next frame is here already, the display is too slow for this one
+		if (stream.live && stream_available(&stream)>=n) continue;
+		bytes+=oled_flush_changed(canvas,shadow);
+		shown++;
+	}
+	t1=timestamp();
+	printf("%d frames, %d shown (%.1f/s), %d dropped, %.0f bytes per shown frame\n",
+		frames,shown,shown/(t1-t0),frames-shown,shown?bytes/(double)shown:0.0);
+}
+
+// mirrors a region of a framebuffer onto the display: /dev/fb0, or a raw
+// image file which another program keeps updating (path:WIDTHxHEIGHTxBITS).
+// both are mapped, and polled. the region is cut into tiles, one for every
+// 8x8 pixels of the display, and every tile is hashed. only the tiles whose
+// hash has changed are scaled down into the grayscale image. that is then
+// converted like the images of -d and -p, and only the changed spans are sent.
+typedef struct _tMirror
+{
+	int fd;
+	unsigned char* map;
+	size_t maplen;
+	unsigned char* mem;		// the first visible row
+	int width,height;
+	int bytes;			// per pixel
+	int stride;			// bytes from one row to the next
+	int rx,ry,rw,rh;		// the region which is shown
+	int xs[BITMAP_WIDTH+1];		// the columns of the region for each pixel of the display: xs[x]..xs[x+1]-1, at least one
+	int ys[BITMAP_HEIGHT+1];
+	unsigned short weights[3][256];	// the contribution of red, green and blue to the gray value, times 256
+	int shift[3];
+	int mask[3];
+	unsigned long long hashes[CANVAS_PAGES][MIRROR_TILES];
+	int hashed;
+	unsigned char gray[BITMAP_WIDTH*BITMAP_HEIGHT];
+	long polls;
+	long changes;
+	long tiles;
+} tMirror;
+
+// a channel of bits bits, at shift. more than 8 bits are cut down to 8.
+void mirror_channel(tMirror* mirror,int c,int shift,int bits,int weight)
+{
+	int i;
+	if (bits>8)
+	{
+		shift+=bits-8;
+		bits=8;
+	}
+	mirror->shift[c]=shift;
+	mirror->mask[c]=(1<<bits)-1;
+	for (i=0;i<=mirror->mask[c];i++)
+	{
+		mirror->weights[c][i]=weight*(i*255/mirror->mask[c]);
+	}
+}
+// source is /dev/fbN, or path:WIDTHxHEIGHTxBITS for a raw file, with 8 bits
+// gray, 16 bits RGB565, 24 bits R,G,B or 32 bits B,G,R,X. region is WxH+X+Y, or NULL for all of it.
+int mirror_open(tMirror* mirror,const char* source,const char* region)
+{
+	struct fb_var_screeninfo var;
+	struct fb_fix_screeninfo fix;
+	struct stat st;
+	char path[256];
+	const char* geometry;
+	int bits;
+	int yoffset;
+	int i;
+
+	memset(mirror,0,sizeof(tMirror));
+	geometry=strrchr(source,':');
+	snprintf(path,sizeof(path),"%.*s",geometry?(int)(geometry-source):(int)strlen(source),source);
+	mirror->fd=open(path,O_RDONLY|O_CLOEXEC);
+	if (mirror->fd<0)
+	{
+		fprintf(stderr,"unable to open %s\n",path);
+		return RETVAL_NOK;
+	}
+	yoffset=0;
+	if (geometry!=NULL)
+	{
+		if (sscanf(geometry+1,"%dx%dx%d",&mirror->width,&mirror->height,&bits)!=3 || mirror->width<=0 || mirror->height<=0)
+		{
+			fprintf(stderr,"the geometry of a raw image is :WIDTHxHEIGHTxBITS\n");
+			close(mirror->fd);
+			return RETVAL_NOK;
+		}
+		mirror->bytes=bits/8;
+		mirror->stride=mirror->width*mirror->bytes;
+		switch (bits)
+		{
+			case 8:		mirror_channel(mirror,0,0,8,77);mirror_channel(mirror,1,0,8,150);mirror_channel(mirror,2,0,8,29);break;
+			case 16:	mirror_channel(mirror,0,11,5,77);mirror_channel(mirror,1,5,6,150);mirror_channel(mirror,2,0,5,29);break;
+			case 24:	mirror_channel(mirror,0,0,8,77);mirror_channel(mirror,1,8,8,150);mirror_channel(mirror,2,16,8,29);break;
+			case 32:	mirror_channel(mirror,0,16,8,77);mirror_channel(mirror,1,8,8,150);mirror_channel(mirror,2,0,8,29);break;
+			default:
+				fprintf(stderr,"a raw image has 8, 16, 24 or 32 bits per pixel, not %d\n",bits);
+				close(mirror->fd);
+				return RETVAL_NOK;
+		}
+	}
+	else if (ioctl(mirror->fd,FBIOGET_VSCREENINFO,&var)==0 && ioctl(mirror->fd,FBIOGET_FSCREENINFO,&fix)==0)
+	{
+		if (var.bits_per_pixel<8 || (var.bits_per_pixel%8)!=0 || var.bits_per_pixel>32)
+		{
+			fprintf(stderr,"%s has %d bits per pixel, which is not supported\n",path,var.bits_per_pixel);
+			close(mirror->fd);
+			return RETVAL_NOK;
+		}
+		mirror->width=var.xres;
+		mirror->height=var.yres;
+		mirror->bytes=var.bits_per_pixel/8;
+		mirror->stride=fix.line_length;
+		yoffset=var.yoffset;	// the visible part, when the framebuffer is panned
+		if (var.grayscale || fix.visual==FB_VISUAL_PSEUDOCOLOR)
+		{
+			for (i=0;i<3;i++) mirror_channel(mirror,i,0,8,(i==0)?77:((i==1)?150:29));
+		} else {
+			mirror_channel(mirror,0,var.red.offset,var.red.length,77);
+			mirror_channel(mirror,1,var.green.offset,var.green.length,150);
+			mirror_channel(mirror,2,var.blue.offset,var.blue.length,29);
+		}
+	} else {
+		fprintf(stderr,"%s is not a framebuffer. for a raw image, add :WIDTHxHEIGHTxBITS\n",path);
+		close(mirror->fd);
+		return RETVAL_NOK;
+	}
+	mirror->rw=mirror->width;
+	mirror->rh=mirror->height;
+	if (region!=NULL && (sscanf(region,"%dx%d+%d+%d",&mirror->rw,&mirror->rh,&mirror->rx,&mirror->ry)!=4
+		|| mirror->rw<=0 || mirror->rh<=0 || mirror->rx<0 || mirror->ry<0
+		|| mirror->rx+mirror->rw>mirror->width || mirror->ry+mirror->rh>mirror->height))
+	{
+		fprintf(stderr,"the region has to be WIDTHxHEIGHT+X+Y, inside of %dx%d\n",mirror->width,mirror->height);
+		close(mirror->fd);
+		return RETVAL_NOK;
+	}
+	mirror->maplen=(size_t)mirror->stride*(yoffset+mirror->height);
+	if (geometry!=NULL && (fstat(mirror->fd,&st)!=0 || st.st_size<mirror->maplen))
+	{
+		fprintf(stderr,"%s is smaller than %dx%dx%d\n",path,mirror->width,mirror->height,mirror->bytes*8);
+		close(mirror->fd);
+		return RETVAL_NOK;
+	}
+	mirror->map=mmap(NULL,mirror->maplen,PROT_READ,MAP_SHARED,mirror->fd,0);
+	if (mirror->map==MAP_FAILED)
+	{
+		fprintf(stderr,"unable to map %s\n",path);
+		close(mirror->fd);
+		return RETVAL_NOK;
+	}
+	mirror->mem=mirror->map+(size_t)mirror->stride*yoffset;
+	for (i=0;i<=BITMAP_WIDTH;i++)
+	{
+		mirror->xs[i]=mirror->rx+i*mirror->rw/BITMAP_WIDTH;
+	}
+	for (i=0;i<=BITMAP_HEIGHT;i++)
+	{
+		mirror->ys[i]=mirror->ry+i*mirror->rh/BITMAP_HEIGHT;
+	}
+	return RETVAL_OK;
+}
+void mirror_close(tMirror* mirror)
+{
+	munmap(mirror->map,mirror->maplen);
+	close(mirror->fd);
+}
+static inline const unsigned char* mirror_pixel(tMirror* mirror,int x,int y)
+{
+	return &mirror->mem[(size_t)y*mirror->stride+x*mirror->bytes];
+}
+// when the region is smaller than the display, its pixels are repeated
+static inline int mirror_end(const int* starts,int i)
+{
+	return (starts[i+1]>starts[i])?starts[i+1]:starts[i]+1;
+}
+unsigned long long mirror_hash(tMirror* mirror,int page,int tile)
+{
+	unsigned long long hash;
+	int x0,x1;
+	int y;
+	x0=mirror->xs[tile*8];
+	x1=mirror_end(mirror->xs,tile*8+7);
+	hash=0;
+	for (y=mirror->ys[page*8];y<mirror_end(mirror->ys,page*8+7);y++)
+	{
+		const unsigned char* src;
+		int len;
+		int i;
+		src=mirror_pixel(mirror,x0,y);
+		len=(x1-x0)*mirror->bytes;
+		for (i=0;i+8<=len;i+=8)
+		{
+			unsigned long long w;
+			memcpy(&w,&src[i],8);
+			hash=(hash+w)*0x9e3779b97f4a7c15ULL;
+			hash^=hash>>29;
+		}
+		for (;i<len;i++)
+		{
+			hash=(hash+src[i])*0x9e3779b97f4a7c15ULL;
+			hash^=hash>>29;
+		}
+	}
+	return hash;
+}
+// the average gray of the pixels which make up each of the 8x8 pixels of a tile
+void mirror_scale(tMirror* mirror,int page,int tile)
+{
+	int x,y;
+	for (y=page*8;y<page*8+8;y++)
+	{
+		for (x=tile*8;x<tile*8+8;x++)
+		{
+			unsigned int sum;
+			int n;
+			int sx,sy;
+			sum=0;
+			n=0;
+			for (sy=mirror->ys[y];sy<mirror_end(mirror->ys,y);sy++)
+			{
+				for (sx=mirror->xs[x];sx<mirror_end(mirror->xs,x);sx++)
+				{
+					const unsigned char* src;
+					unsigned int v;
+					int b;
+					src=mirror_pixel(mirror,sx,sy);
+					v=0;
+					for (b=0;b<mirror->bytes;b++) v|=src[b]<<(8*b);
+					sum+=mirror->weights[0][(v>>mirror->shift[0])&mirror->mask[0]]
+						+mirror->weights[1][(v>>mirror->shift[1])&mirror->mask[1]]
+						+mirror->weights[2][(v>>mirror->shift[2])&mirror->mask[2]];
+					n++;
+				}
+			}
+			mirror->gray[y*BITMAP_WIDTH+x]=(sum/n)>>8;
+		}
+	}
+}
+// returns the number of tiles which have changed. only then, the canvas is converted again.
+int mirror_poll(tMirror* mirror,unsigned char* canvas,int method)
+{
+	int changed;
+	int page;
+	int tile;
+	changed=0;
+	mirror->polls++;
+	for (page=0;page<CANVAS_PAGES;page++)
+	{
+		for (tile=0;tile<MIRROR_TILES;tile++)
+		{
+			unsigned long long hash;
+			hash=mirror_hash(mirror,page,tile);
+			if (mirror->hashed && hash==mirror->hashes[page][tile]) continue;
+			mirror->hashes[page][tile]=hash;
+			mirror_scale(mirror,page,tile);
+			changed++;
+		}
+	}
+	mirror->hashed=1;
+	if (changed)
+	{
+		convert_gray(canvas,mirror->gray,BITMAP_WIDTH,method,128);
+		mirror->changes++;
+		mirror->tiles+=changed;
+	}
+	return changed;
+}
+void demo_mirror(const char* source,const char* region,int method)
+{
+	static tMirror mirror;
+	unsigned char canvas[CANVAS_WIDTH*CANVAS_PAGES];
+	unsigned char shadow[CANVAS_WIDTH*CANVAS_PAGES];
+	double t0;
+	long bytes;
+
+	if (mirror_open(&mirror,source,region)!=RETVAL_OK) return;
+	printf("mirroring %dx%d+%d+%d of %s (%dx%d, %d bits)\n",mirror.rw,mirror.rh,mirror.rx,mirror.ry,source,mirror.width,mirror.height,mirror.bytes*8);
+	memset(shadow,0,sizeof(shadow));
+	oled_flush(shadow);
+	bytes=0;
+	t0=timestamp();
+	while (1)
+	{
+		if (mirror_poll(&mirror,canvas,method)) bytes+=oled_flush_changed(canvas,shadow);
+		if (timestamp()-t0>=MIRROR_REPORT)
+		{
+			printf("%ld polls, %ld changes, %.1f of %d tiles and %.0f bytes per change\n",mirror.polls,mirror.changes,
+				mirror.changes?mirror.tiles/(double)mirror.changes:0.0,CANVAS_PAGES*MIRROR_TILES,mirror.changes?bytes/(double)mirror.changes:0.0);
+			mirror.polls=mirror.changes=mirror.tiles=0;
+			bytes=0;
+			t0=timestamp();
+		}
+		DELAY_MS(MIRROR_POLL_MS);
+	}
+}
+
+// frames over a socket. a message is the difference to the previous frame:
+//   2 bytes   length of the rest, little endian
+//   1 byte    NET_MAGIC
+//   2 bytes   sequence number
+//   1 byte    the pages which have changed, one bit each
+// and for every one of these pages:
+//   1 byte    number of spans
+// and for every span:
+//   1 byte    first column
+//   1 byte    number of columns-1
+//   runs      until the span is complete. 0x80|(n-1) is one byte repeated n
+//             times, (n-1) is followed by n literal bytes.
+// the sender only sends when the socket has room, so a slow receiver makes it
+// skip frames. the receiver applies every message to its canvas, but only
+// sends it to the display when no newer message has arrived in the meantime.
+void net_usage()
+{
+	fprintf(stderr,"addresses are unix:/path/to/socket, or host:port for TCP (:port to listen on all interfaces)\n");
+}
+// fills in the address. returns the address family, or -1
+int net_address(const char* address,struct sockaddr_storage* addr,socklen_t* len)
+{
+	memset(addr,0,sizeof(*addr));
+	if (strncmp(address,"unix:",5)==0)
+	{
+		struct sockaddr_un* un=(struct sockaddr_un*)addr;
+		un->sun_family=AF_UNIX;
+		snprintf(un->sun_path,sizeof(un->sun_path),"%s",&address[5]);
+		*len=sizeof(*un);
+		return AF_UNIX;
+	} else {
+		struct sockaddr_in* in=(struct sockaddr_in*)addr;
+		char host[64];
+		const char* colon;
+		colon=strrchr(address,':');
+		if (colon==NULL || colon-address>=sizeof(host)) return -1;
+		memcpy(host,address,colon-address);
+		host[colon-address]=0;
+		in->sin_family=AF_INET;
+		in->sin_port=htons(atoi(colon+1));
+		if (host[0]==0) in->sin_addr.s_addr=htonl(INADDR_ANY);
+		else if (inet_pton(AF_INET,host,&in->sin_addr)!=1)
+		{
+			struct hostent* he;
+			he=gethostbyname(host);
+			if (he==NULL || he->h_addrtype!=AF_INET) return -1;
+			memcpy(&in->sin_addr,he->h_addr_list[0],sizeof(in->sin_addr));
+		}
+		*len=sizeof(*in);
+		return AF_INET;
+	}
+}
+int net_listen(const char* address)
+{
+	struct sockaddr_storage addr;
+	socklen_t len;
+	int family;
+	int fd;
+	int one;
+	family=net_address(address,&addr,&len);
+	if (family<0)
+	{
+		net_usage();
+		return -1;
+	}
+	fd=socket(family,SOCK_STREAM,0);
+	if (fd<0) return -1;
+	one=1;
+	if (family==AF_UNIX) unlink(((struct sockaddr_un*)&addr)->sun_path);
+	else {
+		int size;
+		setsockopt(fd,SOL_SOCKET,SO_REUSEADDR,&one,sizeof(one));
+		// a small window, so that the frames wait at the sender, where they can be skipped
+		size=NET_MAXINFLIGHT;
+		setsockopt(fd,SOL_SOCKET,SO_RCVBUF,&size,sizeof(size));
+	}
+	if (bind(fd,(struct sockaddr*)&addr,len)<0 || listen(fd,1)<0)
+	{
+		fprintf(stderr,"unable to listen on %s\n",address);
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+int net_connect(const char* address)
+{
+	struct sockaddr_storage addr;
+	socklen_t len;
+	int family;
+	int fd;
+	family=net_address(address,&addr,&len);
+	if (family<0)
+	{
+		net_usage();
+		return -1;
+	}
+	fd=socket(family,SOCK_STREAM,0);
+	if (fd<0) return -1;
+	if (connect(fd,(struct sockaddr*)&addr,len)<0)
+	{
+		fprintf(stderr,"unable to connect to %s\n",address);
+		close(fd);
+		return -1;
+	}
+	if (family==AF_INET)
+	{
+		int one;
+		one=1;
+		setsockopt(fd,IPPROTO_TCP,TCP_NODELAY,&one,sizeof(one));
+	}
+	return fd;
+}
+
+int net_rle(unsigned char* dst,const unsigned char* src,int len)
+{
+	int n;
+	int i;
+	n=0;
+	i=0;
+	while (i<len)
+	{
+		int run;
+		for (run=1;i+run<len && run<NET_MAXRUN && src[i+run]==src[i];run++);
+		if (run>=3)
+		{
+			dst[n++]=0x80|(run-1);
+			dst[n++]=src[i];
+			i+=run;
+		} else {
+			// literals, until the next run of 3
+			int lit;
+			for (lit=0;i+lit<len && lit<NET_MAXRUN;lit++)
+			{
+				if (i+lit+2<len && src[i+lit]==src[i+lit+1] && src[i+lit]==src[i+lit+2]) break;
+			}
+			dst[n++]=lit-1;
+			memcpy(&dst[n],&src[i],lit);
+			n+=lit;
+			i+=lit;
+		}
+	}
+	return n;
+}
+// encodes the difference between the canvas and what has been sent before.
+// returns the length of the message, or 0 when nothing has changed.
+int net_encode(unsigned char* msg,const unsigned char* canvas,const unsigned char* sent,int seq)
+{
+	int page;
+	int n;
+	n=2;
+	msg[n++]=NET_MAGIC;
+	msg[n++]=seq&0xff;
+	msg[n++]=(seq>>8)&0xff;
+	msg[n++]=0;
+	for (page=0;page<CANVAS_PAGES;page++)
+	{
+		const unsigned char* src;
+		const unsigned char* old;
+		int spans;
+		int spanpos;
+		int x;
+		src=&canvas[page*CANVAS_WIDTH];
+		old=&sent[page*CANVAS_WIDTH];
+		if (memcmp(src,old,CANVAS_WIDTH)==0) continue;
+		msg[5]|=(1<<page);
+		spanpos=n++;
+		spans=0;
+		x=0;
+		while (x<CANVAS_WIDTH)
+		{
+			int first;
+			int last;
+			int gap;
+			for (;x<CANVAS_WIDTH && src[x]==old[x];x++);
+			if (x==CANVAS_WIDTH) break;
+			first=x;
+			last=x;
+			// a gap of a few unchanged columns is cheaper to send than a new span
+			for (gap=0;x<CANVAS_WIDTH && gap<=NET_MAXGAP;x++)
+			{
+				if (src[x]!=old[x])
+				{
+					last=x;
+					gap=0;
+				} else {
+					gap++;
+				}
+			}
+			x=last+1;
+			msg[n++]=first;
+			msg[n++]=last-first;
+			n+=net_rle(&msg[n],&src[first],last-first+1);
+			spans++;
+		}
+		msg[spanpos]=spans;
+	}
+	if (msg[5]==0) return 0;
+	msg[0]=(n-2)&0xff;
+	msg[1]=(n-2)>>8;
+	return n;
+}
+// applies a message (without the length) to the canvas. when txn is not
+// NULL, the decoded spans go into the transaction as well.
+int net_decode(const unsigned char* msg,int len,unsigned char* canvas,tTransaction* txn)
+{
+	int page;
+	int n;
+	if (len<4 || msg[0]!=NET_MAGIC) return RETVAL_NOK;
+	n=4;
+	for (page=0;page<CANVAS_PAGES;page++)
+	{
+		int spans;
+		if (!(msg[3]&(1<<page))) continue;
+		if (n>=len) return RETVAL_NOK;
+		spans=msg[n++];
+		while (spans--)
+		{
+			unsigned char* dst;
+			int first;
+			int count;
+			int x;
+			if (n+2>len) return RETVAL_NOK;
+			first=msg[n++];
+			count=msg[n++]+1;
+			if (first+count>CANVAS_WIDTH) return RETVAL_NOK;
+			dst=&canvas[page*CANVAS_WIDTH+first];
+			x=0;
+			while (x<count)
+			{
+				int run;
+				if (n>=len) return RETVAL_NOK;
+				run=(msg[n]&0x7f)+1;
+				if (x+run>count) return RETVAL_NOK;
+				if (msg[n]&0x80)
+				{
+					if (n+2>len) return RETVAL_NOK;
+					memset(&dst[x],msg[n+1],run);
+					n+=2;
+				} else {
+					if (n+1+run>len) return RETVAL_NOK;
+					memcpy(&dst[x],&msg[n+1],run);
+					n+=1+run;
+				}
+				x+=run;
+			}
+			if (txn!=NULL)
+			{
+				// a span is two runs. a busy frame is sent in several pieces.
+				if (txn->runs+2>TXN_MAXRUNS) txn_submit(txn);
+				txn_address(txn,page,first);
+				txn_data(txn,dst,count);
+			}
+		}
+	}
+	return RETVAL_OK;
+}
+typedef struct _tNetStats
+{
+	int received;
+	int shown;
+	long wirebytes;
+	long displaybytes;
+} tNetStats;
+// receives frames from one sender, until it disconnects
+int net_receive(int fd,tNetStats* stats)
+{
+	static tStream stream;
+	unsigned char canvas[CANVAS_WIDTH*CANVAS_PAGES];
+	unsigned char shadow[CANVAS_WIDTH*CANVAS_PAGES];
+	unsigned char msg[NET_MAXMSG];
+	tTransaction txn;
+	int behind;
+
+	stream.fd=fd;
+	stream.live=1;
+	stream.pos=stream.len=0;
+	// a new sender starts from an empty frame
+	memset(canvas,0,sizeof(canvas));
+	memset(shadow,0,sizeof(shadow));
+	oled_flush(shadow);
+	behind=0;
+	while (1)
+	{
+		unsigned char hdr[2];
+		int len;
+		if (stream_read(&stream,hdr,2)) break;
+		len=hdr[0]|(hdr[1]<<8);
+		if (len>NET_MAXMSG || stream_read(&stream,msg,len))
+		{
+			fprintf(stderr,"broken message\n");
+			return RETVAL_NOK;
+		}
+		stats->received++;
+		stats->wirebytes+=len+2;
+		if (stream_available(&stream)>0)
+		{
+			// a newer frame is on its way. this one is only decoded.
+			if (net_decode(msg,len,canvas,NULL)) return RETVAL_NOK;
+			behind=1;
+		} else if (behind) {
+			// after skipping frames, only the difference to the display is sent
+			if (net_decode(msg,len,canvas,NULL)) return RETVAL_NOK;
+			stats->displaybytes+=oled_flush_changed(canvas,shadow);
+			stats->shown++;
+			behind=0;
+		} else {
+			// straight from the message into the transmit buffer
+			txn_init(&txn);
+			if (net_decode(msg,len,canvas,&txn)) return RETVAL_NOK;
+			stats->displaybytes+=txn.len;
+			if (txn.len) txn_submit(&txn);
+			memcpy(shadow,canvas,sizeof(shadow));
+			stats->shown++;
+		}
+	}
+	return RETVAL_OK;
+}
+void demo_receive(const char* address)
+{
+	int listenfd;
+	listenfd=net_listen(address);
+	if (listenfd<0) return;
+	printf("waiting for frames on %s\n",address);
+	while (1)
+	{
+		tNetStats stats;
+		int fd;
+		fd=accept(listenfd,NULL,NULL);
+		if (fd<0) break;
+		memset(&stats,0,sizeof(stats));
+		net_receive(fd,&stats);
+		close(fd);
+		printf("%d frames received, %d shown, %.0f bytes per frame on the wire\n",
+			stats.received,stats.shown,stats.received?stats.wirebytes/(double)stats.received:0.0);
+	}
+	close(listenfd);
+}
+// sends a frame when the previous ones have (nearly) left the socket. returns
+// the bytes sent, 0 when the frame was skipped or unchanged, and -1 when the
+// receiver is gone.
+int net_send(int fd,const unsigned char* canvas,unsigned char* sent,int* seq)
+{
+	unsigned char msg[NET_MAXMSG];
+	struct pollfd pfd;
+	int queued;
+	int len;
+	int n;
+	pfd.fd=fd;
+	pfd.events=POLLOUT;
+	if (poll(&pfd,1,0)==1 && (pfd.revents&(POLLERR|POLLHUP))) return RETVAL_NOK;
+	len=net_encode(msg,canvas,sent,*seq);
+	if (len==0) return 0;
+	// POLLOUT alone would let the whole send buffer fill up with old frames.
+	// SIOCOUTQ counts what has not been taken by the receiver yet (unix) or
+	// not been acknowledged yet (tcp).
+	if (ioctl(fd,SIOCOUTQ,&queued)<0) return RETVAL_NOK;
+	if (queued>0 && queued+len>NET_MAXINFLIGHT) return 0;	// the receiver is behind
+	for (n=0;n<len;)
+	{
+		int m;
+		m=write(fd,&msg[n],len-n);
+		if (m<=0) return RETVAL_NOK;
+		n+=m;
+	}
+	memcpy(sent,canvas,CANVAS_WIDTH*CANVAS_PAGES);
+	(*seq)++;
+	return len;
+}
+// sends the PBM/PGM stream from stdin to a receiver. does not need the display.
+int demo_send(const char* address,int method)
+{
+	static tStream stream;
+	unsigned char canvas[CANVAS_WIDTH*CANVAS_PAGES];
+	unsigned char sent[CANVAS_WIDTH*CANVAS_PAGES];
+	int frames;
+	int sentframes;
+	long bytes;
+	int seq;
+	int fd;
+	int n;
+
+	fd=net_connect(address);
+	if (fd<0) return RETVAL_NOK;
+	signal(SIGPIPE,SIG_IGN);
+	stream.fd=STDIN_FILENO;
+	stream.live=1;
+	memset(sent,0,sizeof(sent));
+	frames=sentframes=0;
+	bytes=0;
+	seq=0;
+	while (stream_frame(&stream,canvas,method)>0)
+	{
+		frames++;
+		n=net_send(fd,canvas,sent,&seq);
+		if (n<0) break;
+		if (n>0)
+		{
+			sentframes++;
+			bytes+=n;
+		}
+	}
+	close(fd);
+	printf("%d frames, %d sent, %.0f bytes per sent frame\n",frames,sentframes,sentframes?bytes/(double)sentframes:0.0);
+	return RETVAL_OK;
+}
+// a dashboard-like frame: a fixed background, a moving ball and a bar
+void net_testframe(unsigned char* canvas,tSprite* ball,int frame)
+{
+	int x;
+	for (x=0;x<CANVAS_WIDTH*CANVAS_PAGES;x++)
+	{
+		canvas[x]=((x/CANVAS_WIDTH)==0)?0xff:(((x%CANVAS_WIDTH)%16)==0)?0x55:0x00;
+	}
+	for (x=0;x<(frame%CANVAS_WIDTH);x++)
+	{
+		canvas[7*CANVAS_WIDTH+x]=0x7e;
+	}
+	x=frame%(2*(CANVAS_WIDTH-16));
+	if (x>=CANVAS_WIDTH-16) x=2*(CANVAS_WIDTH-16)-x;
+	sprite_blit(canvas,ball,x,8+(frame*3)%40,BLIT_MASKED);
+}
+// a sender and a receiver on the same machine. the receiver uses the
+// recording transport, with a syscall per pin change, so it is about as
+// slow as the real thing, and frames have to be dropped.
+int bench_net_pair(const char* address,tGpioRecorder* rec,tSprite* ball)
+{
+	#define	BENCH_NET_FRAMES	2000
+	unsigned char canvas[CANVAS_WIDTH*CANVAS_PAGES];
+	unsigned char sent[CANVAS_WIDTH*CANVAS_PAGES];
+	tNetStats stats;
+	double t0,t1;
+	int listenfd;
+	int fd;
+	pid_t pid;
+	int i;
+
+	listenfd=net_listen(address);
+	if (listenfd<0) return RETVAL_NOK;
+	fflush(stdout);
+	pid=fork();
+	if (pid==0)
+	{
+		int seq;
+		int sentframes;
+		long bytes;
+		close(listenfd);
+		fd=net_connect(address);
+		if (fd<0) exit(1);
+		memset(sent,0,sizeof(sent));
+		seq=0;
+		sentframes=0;
+		bytes=0;
+		for (i=0;i<BENCH_NET_FRAMES;i++)
+		{
+			int n;
+			net_testframe(canvas,ball,i);
+			n=net_send(fd,canvas,sent,&seq);
+			if (n<0) exit(1);
+			if (n>0) {sentframes++;bytes+=n;}
+			usleep(500);
+		}
+		// the last frame has to arrive, so that the receiver can check it
+		while (memcmp(canvas,sent,sizeof(sent)))
+		{
+			int n;
+			n=net_send(fd,canvas,sent,&seq);
+			if (n<0) exit(1);
+			if (n>0) {sentframes++;bytes+=n;}
+			usleep(1000);
+		}
+		printf("sender:   %d frames, %d sent, %.0f bytes per sent frame (raw: %d, or %d as a bitmap)\n",
+			BENCH_NET_FRAMES,sentframes,bytes/(double)sentframes,CANVAS_WIDTH*CANVAS_PAGES,BITMAP_WIDTH*BITMAP_HEIGHT);
+		close(fd);
+		exit(0);
+	}
+	fd=accept(listenfd,NULL,NULL);
+	close(listenfd);
+	if (fd<0) return RETVAL_NOK;
+	memset(&stats,0,sizeof(stats));
+	rec->num=0;
+	t0=timestamp();
+	i=net_receive(fd,&stats);
+	t1=timestamp();
+	close(fd);
+	waitpid(pid,NULL,0);
+	printf("receiver: %d frames received, %d shown, %.0f bytes per shown frame to the display, %.1f frames/s\n",
+		stats.received,stats.shown,stats.shown?stats.displaybytes/(double)stats.shown:0.0,stats.shown/(t1-t0));
+	// the display has to end up with the last frame
+	net_testframe(canvas,ball,BENCH_NET_FRAMES-1);
+	model_canvas(rec->model,sent);
+	printf("the display shows the last frame: %s\n",memcmp(canvas,sent,sizeof(sent))?"NO":"yes");
+	if (memcmp(canvas,sent,sizeof(sent))) i=RETVAL_NOK;
+	return i;
+}
+int bench_net()
+{
+	unsigned char pixels[16*16];
+	unsigned char mask[16*16];
+	unsigned char canvas[CANVAS_WIDTH*CANVAS_PAGES];
+	unsigned char sent[CANVAS_WIDTH*CANVAS_PAGES];
+	unsigned char decoded[CANVAS_WIDTH*CANVAS_PAGES];
+	unsigned char msg[NET_MAXMSG];
+	char path[64];
+	tGpioRecorder rec;
+	tDisplayModel model;
+	tSprite ball;
+	double t0,t1,t2;
+	long bytes;
+	int retval;
+	int i;
+
+	retval=RETVAL_OK;
+	sprite_ball(pixels,mask);
+	sprite_create(&ball,pixels,mask,16,16);
+	// encoding and decoding alone
+	memset(sent,0,sizeof(sent));
+	memset(decoded,0,sizeof(decoded));
+	bytes=0;
+	t1=t2=0;
+	for (i=0;i<BENCH_NET_FRAMES;i++)
+	{
+		int len;
+		net_testframe(canvas,&ball,i);
+		t0=timestamp();
+		len=net_encode(msg,canvas,sent,i);
+		t1+=timestamp()-t0;
+		memcpy(sent,canvas,sizeof(sent));
+		t0=timestamp();
+		if (len && net_decode(&msg[2],len-2,decoded,NULL)) retval=RETVAL_NOK;
+		t2+=timestamp()-t0;
+		bytes+=len;
+		if (memcmp(decoded,canvas,sizeof(canvas))) retval=RETVAL_NOK;
+	}
+	printf("%d frames: %.0f bytes per frame, encoding %.2f us, decoding %.2f us   %s\n",
+		BENCH_NET_FRAMES,bytes/(double)BENCH_NET_FRAMES,t1*1e6/BENCH_NET_FRAMES,t2*1e6/BENCH_NET_FRAMES,
+		retval?"MISMATCH":"ok");
+
+	rec.max=0;
+	rec.pins=NULL;
+	rec.values=NULL;
+	rec.model=&model;
+	memset(&model,0,sizeof(model));
+	rec.fd=open("/dev/null",O_WRONLY);
+	gpio_record(&rec);
+	snprintf(path,sizeof(path),"unix:/tmp/oledtest.%d",(int)getpid());
+	printf("over %s\n",path);
+	retval|=bench_net_pair(path,&rec,&ball);
+	unlink(&path[5]);
+	printf("over 127.0.0.1:%d\n",NET_BENCHPORT);
+	snprintf(path,sizeof(path),"127.0.0.1:%d",NET_BENCHPORT);
+	retval|=bench_net_pair(path,&rec,&ball);
+	gpio_record(NULL);
+	close(rec.fd);
+	return retval;
+}
+
+// an arrow pointing up, in a frame, so that the orientation can be checked
+void portrait_testimage(unsigned char* portrait,int frame)
+{
+	int x,y;
+	memset(portrait,0,PORTRAIT_WIDTH*PORTRAIT_PAGES);
+	for (y=0;y<PORTRAIT_PAGES*8;y++)
+	{
+		for (x=0;x<PORTRAIT_WIDTH;x++)
+		{
+			int on;
+			on=(x==0 || y==0 || x==PORTRAIT_WIDTH-1 || y==PORTRAIT_PAGES*8-1);
+			if (y>=16 && y<48 && abs(x-32)<=(y-16)) on=1;		// the head
+			if (y>=48 && y<112 && abs(x-32)<6) on=1;		// the shaft
+			if (y==(frame%(PORTRAIT_PAGES*8))) on=!on;		// a moving line
+			if (on) portrait[(y/8)*PORTRAIT_WIDTH+x]|=(1<<(y%8));
+		}
+	}
+}
+void demo_portrait()
+{
+	unsigned char portrait[PORTRAIT_WIDTH*PORTRAIT_PAGES];
+	unsigned char canvas[CANVAS_WIDTH*CANVAS_PAGES];
+	int frame;
+	for (frame=0;frame<PORTRAIT_PAGES*8;frame++)
+	{
+		portrait_testimage(portrait,frame);
+		rotate_portrait(canvas,portrait);
+		oled_flush(canvas);
+	}
+}
+int bench_rotate()
+{
+	#define	BENCH_ROTATIONS	100000
+	unsigned char portrait[PORTRAIT_WIDTH*PORTRAIT_PAGES];
+	unsigned char canvas1[CANVAS_WIDTH*CANVAS_PAGES];
+	unsigned char canvas2[CANVAS_WIDTH*CANVAS_PAGES];
+	double t0,t1,t2;
+	int i;
+
+	srand(1);
+	for (i=0;i<sizeof(portrait);i++)
+	{
+		portrait[i]=rand();
+	}
+	t0=timestamp();
+	for (i=0;i<BENCH_ROTATIONS;i++)
+	{
+		portrait[i%sizeof(portrait)]^=1;
+		rotate_portrait(canvas1,portrait);
+	}
+	t1=timestamp();
+	for (i=0;i<BENCH_ROTATIONS/100;i++)
+	{
+		portrait[i%sizeof(portrait)]^=1;
+		rotate_portrait_naive(canvas2,portrait);
+	}
+	t2=timestamp();
+	rotate_portrait(canvas1,portrait);	// the same input as the last naive one
+	printf("rotating a 64x128 frame:  transposed blocks: %7.2f us   pixel by pixel: %7.2f us   %s\n",
+		(t1-t0)*1e6/BENCH_ROTATIONS,(t2-t1)*1e6/(BENCH_ROTATIONS/100),
+		memcmp(canvas1,canvas2,sizeof(canvas1))?"MISMATCH":"ok");
+	return memcmp(canvas1,canvas2,sizeof(canvas1))?RETVAL_NOK:RETVAL_OK;
+}
+
+// what a device on the SPI bus would see: the level of MOSI and SCLK at
+// every write to SCLK. redundant writes to MOSI do not change it.
+int bench_waveform_clocks(tGpioRecorder* rec,unsigned char* clocks)
+{
+	int mosi;
+	int num;
+	int i;
+	mosi=0;
+	num=0;
+	for (i=0;i<rec->num && i<rec->max;i++)
+	{
+		if (rec->pins[i]==PIN_MOSI) mosi=rec->values[i];
+		else if (rec->pins[i]==PIN_SCLK) clocks[num++]=(rec->values[i]<<1)|mosi;
+	}
+	return num;
+}
+int bench_waveform()
+{
+	#define	BENCH_FRAMES	200
+	#define	BENCH_MAXWRITES	(CANVAS_WIDTH*CANVAS_PAGES*WAVE_MAXSTEPS+2)
+	unsigned char frame[CANVAS_WIDTH*CANVAS_PAGES];
+	unsigned char* clocks1;
+	unsigned char* clocks2;
+	tGpioRecorder rec;
+	int mode;
+	int msbfirst;
+	int pass;
+	int i;
+	int retval;
+
+	retval=RETVAL_OK;
+	rec.max=BENCH_MAXWRITES;
+	rec.model=NULL;
+	rec.pins=malloc(rec.max*sizeof(int));
+	rec.values=malloc(rec.max);
+	clocks1=malloc(rec.max);
+	clocks2=malloc(rec.max);
+	if (rec.pins==NULL || rec.values==NULL || clocks1==NULL || clocks2==NULL) return RETVAL_NOK;
+	srand(1);
+	for (i=0;i<sizeof(frame);i++)
+	{
+		frame[i]=rand();
+	}
+	gpio_record(&rec);
+	for (pass=0;pass<2;pass++)
+	{
+		int frames;
+		// the second pass adds a syscall per write, which is closer to what the sysfs files cost
+		rec.fd=pass?open("/dev/null",O_WRONLY):-1;
+		frames=pass?BENCH_FRAMES/10:BENCH_FRAMES;
+		printf("%d frames of %d random bytes, into a recording transport%s\n",frames,(int)sizeof(frame),pass?" with one syscall per write":"");
+		for (mode=SPI_MODE0;mode<=SPI_MODE3;mode++)
+		{
+			for (msbfirst=SPI_LSBFIRST;msbfirst<=SPI_MSBFIRST;msbfirst++)
+			{
+				double t0,t1,t2;
+				int writes1,writes2;
+				int num1,num2;
+
+				t0=timestamp();
+				for (i=0;i<frames;i++)
+				{
+					rec.num=0;
+					spi_writebuf_bitwise(frame,sizeof(frame),mode,msbfirst);
+				}
+				t1=timestamp();
+				writes1=rec.num;
+				num1=bench_waveform_clocks(&rec,clocks1);
+
+				wave_get(mode,msbfirst);	// the table is built outside of the measurement
+				t1=timestamp();
+				for (i=0;i<frames;i++)
+				{
+					rec.num=0;
+					gpio_record(&rec);	// every frame is a recording of its own
+					spi_writebuf(frame,sizeof(frame),mode,msbfirst);
+				}
+				t2=timestamp();
+				writes2=rec.num;
+				num2=bench_waveform_clocks(&rec,clocks2);
+
+				printf("mode %d %s  bitwise: %7.1f ns/byte %5.2f writes/byte   table: %7.1f ns/byte %5.2f writes/byte   %s\n",
+					mode,msbfirst?"MSB":"LSB",
+					(t1-t0)*1e9/frames/sizeof(frame),writes1/(double)sizeof(frame),
+					(t2-t1)*1e9/frames/sizeof(frame),writes2/(double)sizeof(frame),
+					(num1==num2 && memcmp(clocks1,clocks2,num1)==0)?"ok":"MISMATCH");
+				if (num1!=num2 || memcmp(clocks1,clocks2,num1)!=0) retval=RETVAL_NOK;
+			}
+		}
+		if (rec.fd>=0) close(rec.fd);
+	}
+	gpio_record(NULL);
+	free(rec.pins);
+	free(rec.values);
+	free(clocks1);
+	free(clocks2);
+	return retval;
+}
+
+// what the trace costs per pin change, with the recording transport
+int bench_trace()
+{
+	#define	BENCH_TRACE_FRAMES	200
+	unsigned char frame[CANVAS_WIDTH*CANVAS_PAGES];
+	tGpioRecorder rec;
+	tTrace* trace;
+	double t0,t1,t2;
+	int writes;
+	int i;
+
+	rec.max=0;
+	rec.pins=NULL;
+	rec.values=NULL;
+	rec.fd=-1;
+	rec.model=NULL;
+	trace=malloc(sizeof(tTrace));
+	if (trace==NULL) return RETVAL_NOK;
+	memset(trace,0,sizeof(tTrace));
+	srand(1);
+	for (i=0;i<sizeof(frame);i++)
+	{
+		frame[i]=rand();
+	}
+	gpio_record(&rec);
+	rec.num=0;
+	t0=timestamp();
+	for (i=0;i<BENCH_TRACE_FRAMES;i++)
+	{
+		spi_writebuf(frame,sizeof(frame),SPI_MODE0,SPI_MSBFIRST);
+	}
+	t1=timestamp();
+	writes=rec.num;
+	gpio_trace=trace;
+	for (i=0;i<BENCH_TRACE_FRAMES;i++)
+	{
+		spi_writebuf(frame,sizeof(frame),SPI_MODE0,SPI_MSBFIRST);
+	}
+	t2=timestamp();
+	gpio_record(NULL);
+	printf("%d pin changes:  without trace %6.1f ns each   with trace %6.1f ns each   overhead %6.1f ns\n",
+		writes,(t1-t0)*1e9/writes,(t2-t1)*1e9/writes,((t2-t1)-(t1-t0))*1e9/writes);
+	gpio_trace=NULL;
+	i=trace_vcd(trace,"/dev/null");
+	free(trace);
+	return i;
+}
+
+void demo_sprites(unsigned char* bitmap)
+{
+	#define	DEMO_BALLS	3
+	unsigned char pixels[16*16];
+	unsigned char mask[16*16];
+	unsigned char cursor[8*8];
+	unsigned char background[CANVAS_WIDTH*CANVAS_PAGES];
+	unsigned char canvas[CANVAS_WIDTH*CANVAS_PAGES];
+	tSprite ball;
+	tSprite arrow;
+	int x[DEMO_BALLS]={ 0,40,90};
+	int y[DEMO_BALLS]={ 3,20,41};
+	int dx[DEMO_BALLS]={ 1,-2, 3};
+	int dy[DEMO_BALLS]={ 1, 3,-2};
+	int i;
+	int frame;
+
+	sprite_ball(pixels,mask);
+	sprite_create(&ball,pixels,mask,16,16);
+	for (i=0;i<8*8;i++)
+	{
+		cursor[i]=((i%8)<=(i/8));	// a triangle
+	}
+	sprite_create(&arrow,cursor,NULL,8,8);
+	oled_bitmap2canvas(background,bitmap);
+	for (frame=0;frame<200;frame++)
+	{
+		memcpy(canvas,background,sizeof(canvas));
+		for (i=0;i<DEMO_BALLS;i++)
+		{
+			sprite_blit(canvas,&ball,x[i],y[i],BLIT_MASKED);
+			x[i]+=dx[i];
+			y[i]+=dy[i];
+			if (x[i]<0 || x[i]>CANVAS_WIDTH-16)  {dx[i]=-dx[i];x[i]+=2*dx[i];}
+			if (y[i]<0 || y[i]>BITMAP_HEIGHT-16) {dy[i]=-dy[i];y[i]+=2*dy[i];}
+		}
+		sprite_blit(canvas,&arrow,frame%CANVAS_WIDTH,(frame/2)%BITMAP_HEIGHT,BLIT_XOR);
+		oled_flush(canvas);
+		printf("%d\n",frame);
+	}
+}
+// a raw image file as a stand-in for /dev/fb0: a 320x240 desktop with a
+// gradient, and a clock in the corner which changes every frame. every 20
+// frames, a window is moved. the display model checks what arrives.
+void bench_mirror_draw(unsigned char* fb,int frame)
+{
+	int x,y;
+	for (y=0;y<240;y++)
+	{
+		for (x=0;x<320;x++)
+		{
+			unsigned char* px;
+			int v;
+			px=&fb[(y*320+x)*4];
+			v=(x+y)*255/560;
+			if (x>=40+(frame/20)%5*30 && x<160+(frame/20)%5*30 && y>=60 && y<160) v=240;	// the window
+			if (x>=260 && y>=220) v=((x/4+y/4+frame)&1)?255:0;				// the clock
+			px[0]=v/2;
+			px[1]=v;
+			px[2]=255-v;
+			px[3]=0;
+		}
+	}
+}
+int bench_mirror()
+{
+	#define	BENCH_MIRROR_FRAMES	200
+	static tMirror mirror;
+	unsigned char canvas[CANVAS_WIDTH*CANVAS_PAGES];
+	unsigned char shadow[CANVAS_WIDTH*CANVAS_PAGES];
+	unsigned char shown[CANVAS_WIDTH*CANVAS_PAGES];
+	unsigned char expected[CANVAS_WIDTH*CANVAS_PAGES];
+	char source[128];
+	char path[64];
+	tGpioRecorder rec;
+	tDisplayModel model;
+	unsigned char* fb;
+	double tidle,tpoll,tfull;
+	long bytes;
+	long tiles;
+	int mismatches;
+	int fd;
+	int i;
+
+	snprintf(path,sizeof(path),"/tmp/oledtest.fb.%d",(int)getpid());
+	snprintf(source,sizeof(source),"%s:320x240x32",path);
+	fd=open(path,O_RDWR|O_CREAT|O_TRUNC,0600);
+	if (fd<0 || ftruncate(fd,320*240*4)!=0) return RETVAL_NOK;
+	// the program which draws
+	fb=mmap(NULL,320*240*4,PROT_READ|PROT_WRITE,MAP_SHARED,fd,0);
+	close(fd);
+	if (fb==MAP_FAILED) return RETVAL_NOK;
+	bench_mirror_draw(fb,0);
+	if (mirror_open(&mirror,source,NULL)!=RETVAL_OK) return RETVAL_NOK;
+
+	memset(&model,0,sizeof(model));
+	rec.max=0;
+	rec.pins=NULL;
+	rec.values=NULL;
+	rec.model=&model;
+	rec.fd=-1;
+	gpio_record(&rec);
+	memset(shadow,0,sizeof(shadow));
+	oled_flush(shadow);
+	mirror_poll(&mirror,canvas,DITHER_BAYER);
+	oled_flush_changed(canvas,shadow);
+	// nothing changes: only the hashing
+	tidle=timestamp();
+	for (i=0;i<BENCH_MIRROR_FRAMES;i++)
+	{
+		mirror_poll(&mirror,canvas,DITHER_BAYER);
+	}
+	tidle=timestamp()-tidle;
+	mirror.polls=mirror.changes=mirror.tiles=0;
+	bytes=0;
+	mismatches=0;
+	tpoll=0;
+	for (i=1;i<=BENCH_MIRROR_FRAMES;i++)
+	{
+		static tMirror fresh;
+		double t0;
+		bench_mirror_draw(fb,i);
+		t0=timestamp();
+		if (mirror_poll(&mirror,canvas,DITHER_BAYER)) bytes+=oled_flush_changed(canvas,shadow);
+		tpoll+=timestamp()-t0;
+		// everything from scratch, which is what the display should show
+		if (i%20==0 || i==BENCH_MIRROR_FRAMES)
+		{
+			mirror_open(&fresh,source,NULL);
+			mirror_poll(&fresh,expected,DITHER_BAYER);
+			mirror_close(&fresh);
+			model_canvas(&model,shown);
+			if (memcmp(shown,expected,sizeof(shown))) mismatches++;
+		}
+	}
+	tiles=mirror.tiles;
+	// the whole frame, every time
+	tfull=timestamp();
+	for (i=0;i<BENCH_MIRROR_FRAMES/10;i++)
+	{
+		mirror.hashed=0;
+		mirror_poll(&mirror,canvas,DITHER_BAYER);
+		oled_flush(canvas);
+	}
+	tfull=(timestamp()-tfull)*10;
+	gpio_record(NULL);
+	printf("a 320x240x32 image file, %d frames with a clock, and a window which moves every 20 frames\n",BENCH_MIRROR_FRAMES);
+	printf("poll without a change: %7.1f us\n",tidle*1e6/BENCH_MIRROR_FRAMES);
+	printf("changed tiles:   %7.1f of %d, %7.1f bytes sent, %7.1f us per frame\n",
+		tiles/(double)BENCH_MIRROR_FRAMES,CANVAS_PAGES*MIRROR_TILES,bytes/(double)BENCH_MIRROR_FRAMES,tpoll*1e6/BENCH_MIRROR_FRAMES);
+	printf("everything:      %7d of %d, %7d bytes sent, %7.1f us per frame\n",
+		CANVAS_PAGES*MIRROR_TILES,CANVAS_PAGES*MIRROR_TILES,CANVAS_PAGES*(CANVAS_WIDTH+3),tfull*1e6/BENCH_MIRROR_FRAMES);
+	printf("the display shows what it should: %s\n",mismatches?"NO":"yes");
+	mirror_close(&mirror);
+	munmap(fb,320*240*4);
+	unlink(path);
+	return mismatches?RETVAL_NOK:RETVAL_OK;
+}
 int main(int argc,char** argv)
 {
 	unsigned char bitmap[BITMAP_WIDTH*BITMAP_HEIGHT]={0};
 	unsigned char bitmap2[BITMAP_WIDTH*BITMAP_HEIGHT]={0};
 	int i;
+	int opt;
+	int sprites;
+	int layers;
+	int charts;
+	int dither;
+	int graybits;
+	int stream;
+	int orientation;
+	const char* listen;
+	const char* bench;
+	const char* mirror;
+	const char* region;
+
+	listen=NULL;
+	mirror=NULL;
+	region=NULL;
+	bench=NULL;
+	if (BOARD_DEFAULT>=0) board_select(boards[BOARD_DEFAULT].name);
+	sprites=0;
+	layers=0;
+	charts=0;
+	stream=0;
+	orientation=ORIENT_0;
+	dither=-1;
+	graybits=0;
+	while ((opt=getopt(argc,argv,"slmud:g:pr:t:n:c:b:w:f:a:"))!=-1)
+	{
+		switch (opt)
+		{
+			case 's':	sprites=1;break;
+			case 'l':	layers=1;break;
+			case 'm':	charts=1;break;
+			case 'u':	gpio_transport_set(GPIO_SYSFS_URING);break;
+			case 'p':	stream=1;break;
+			case 't':	tracepath=optarg;break;
+			case 'n':	listen=optarg;break;
+			case 'c':	return demo_send(optarg,(dither>=0)?dither:DITHER_BAYER)?1:0;
+			case 'b':	bench=optarg;break;
+			case 'f':	mirror=optarg;break;
+			case 'a':	region=optarg;break;
+			case 'w':
+				if (board_select(optarg)<0)
+				{
+					fprintf(stderr,"unknown board %s\n",optarg);
+					return 1;
+				}
+				break;
+			case 'r':
+				orientation=oled_orientation_parse(optarg);
+				if (orientation<0)
+				{
+					fprintf(stderr,"unknown orientation %s\n",optarg);
+					return 1;
+				}
+				break;
+			case 'd':
+				dither=dither_method(optarg);
+				if (dither<0)
+				{
+					fprintf(stderr,"unknown dithering %s\n",optarg);
+					return 1;
+				}
+				break;
+			case 'g':
+				graybits=atoi(optarg);
+				if (graybits<2 || graybits>GRAY_MAXBITS)
+				{
+					fprintf(stderr,"the number of bits has to be between 2 and %d\n",GRAY_MAXBITS);
+					return 1;
+				}
+				break;
+			default:
+				fprintf(stderr,"usage: %s [-s] [-l] [-m] [-u] [-d method] [-g bits] [-p] [-r orientation] [-t file.vcd] [-n address] [-c address] [-f source [-a region]] [-w board] [-b sprites|waveform|dither|gray|rotate|trace|net|layers|charts|lanes|uring|mirror]\n",argv[0]);
+				fprintf(stderr,"  -s          show moving sprites instead of the two bitmaps\n");
+				fprintf(stderr,"  -l          show layers: a background, a bar, a popup and a cursor\n");
+				fprintf(stderr,"  -m          show live charts: a sweep graph, bars and a strip chart\n");
+				fprintf(stderr,"  -u          write the GPIOs through io_uring, a page at a time\n");
+				fprintf(stderr,"  -d method   show a grayscale image, dithered with threshold, bayer, floyd or atkinson\n");
+				fprintf(stderr,"  -g bits     show a grayscale image with 2^bits levels, by cycling through its bit-planes\n");
+				fprintf(stderr,"  -p          show a stream of PBM/PGM images from stdin, dithered with -d (default bayer)\n");
+				fprintf(stderr,"  -r orientation  0, 90, 180, 270, mirrorx or mirrory. 90 and 270 show a portrait test image\n");
+				fprintf(stderr,"  -t file.vcd trace the last %d pin changes, and write them to the file when quitting\n",TRACE_SIZE);
+				fprintf(stderr,"  -n address  show the frames a sender sends to this address (unix:/path or host:port)\n");
+				fprintf(stderr,"  -c address  send the PBM/PGM stream from stdin to a receiver (does not need the display)\n");
+				fprintf(stderr,"  -f source   mirror a framebuffer (/dev/fb0), or a raw image file (path:WIDTHxHEIGHTxBITS), dithered with -d\n");
+				fprintf(stderr,"  -a region   the part of it which is shown, WIDTHxHEIGHT+X+Y (default all of it)\n");
+				fprintf(stderr,"  -w board    %s, instead of the one from the sourcecode\n",BOARD_NAMES);
+				fprintf(stderr,"  -b sprites  benchmark the sprite blitter (does not need the display)\n");
+				fprintf(stderr,"  -b waveform benchmark the bit-banged SPI (does not need the display)\n");
+				fprintf(stderr,"  -b dither   benchmark the grayscale conversion (does not need the display)\n");
+				fprintf(stderr,"  -b gray     benchmark the bit-plane cycling (does not need the display)\n");
+				fprintf(stderr,"  -b rotate   benchmark the portrait rotation (does not need the display)\n");
+				fprintf(stderr,"  -b trace    benchmark the pin trace (does not need the display)\n");
+				fprintf(stderr,"  -b net      benchmark a sender and a receiver on this machine (does not need the display)\n");
+				fprintf(stderr,"  -b layers   benchmark the compositor (does not need the display)\n");
+				fprintf(stderr,"  -b charts   benchmark the chart updates (does not need the display)\n");
+				fprintf(stderr,"  -b lanes    benchmark sending to several panels at once (does not need the display)\n");
+				fprintf(stderr,"  -b uring    benchmark the ways of writing the sysfs GPIOs (does not need the display)\n");
+				fprintf(stderr,"  -b mirror   benchmark mirroring a raw image file which keeps changing (does not need the display)\n");
+				return 1;
+		}
+	}
+	if (bench!=NULL)
+	{
+		// the benchmarks only record the pins. any board will do.
+		if (physicalmapping==NULL) board_select(boards[BOARD_BENCH].name);
+		if (strcmp(bench,"sprites")==0) return bench_sprites()?1:0;
+		if (strcmp(bench,"waveform")==0) return bench_waveform()?1:0;
+		if (strcmp(bench,"dither")==0) return bench_dither()?1:0;
+		if (strcmp(bench,"gray")==0) return bench_gray()?1:0;
+		if (strcmp(bench,"rotate")==0) return bench_rotate()?1:0;
+		if (strcmp(bench,"trace")==0) return bench_trace()?1:0;
+		if (strcmp(bench,"net")==0) return bench_net()?1:0;
+		if (strcmp(bench,"layers")==0) return bench_layers()?1:0;
+		if (strcmp(bench,"charts")==0) return bench_charts()?1:0;
+		if (strcmp(bench,"lanes")==0) return bench_lanes()?1:0;
+		if (strcmp(bench,"uring")==0) return bench_uring()?1:0;
+		if (strcmp(bench,"mirror")==0) return bench_mirror()?1:0;
+		fprintf(stderr,"unknown benchmark %s\n",bench);
+		return 1;
+	}
+	if (physicalmapping==NULL)
+	{
+		fprintf(stderr,BOARD_MISSING,"-w");
+		return 1;
+	}
 	
 	signal(SIGINT, graceFulExit);
+	if (tracepath!=NULL)
+	{
+		gpio_trace=malloc(sizeof(tTrace));
+		if (gpio_trace==NULL) return 1;
+		memset(gpio_trace,0,sizeof(tTrace));
+	}
 	if (sh1106_up())
 	{
 		fprintf(stderr,"unable to start up display. sorry");
@@ -513,8 +4720,48 @@ int main(int argc,char** argv)
 	{
 		bitmap2[i+i*BITMAP_WIDTH]=1;
 	}
+	oled_orientation(orientation);
+	if (listen!=NULL)
+	{
+		demo_receive(listen);
+		graceFulExit(0);
+	}
+	if (stream)
+	{
+		demo_stream(STDIN_FILENO,(dither>=0)?dither:DITHER_BAYER);
+		graceFulExit(0);
+	}
+	if (mirror!=NULL)
+	{
+		demo_mirror(mirror,region,(dither>=0)?dither:DITHER_BAYER);
+		graceFulExit(0);
+	}
+	if (orientation&ORIENT_PORTRAIT)
+	{
+		demo_portrait();
+	}
+	else if (sprites)
+	{
+		demo_sprites(bitmap);
+	}
+	else if (layers)
+	{
+		demo_layers();
+	}
+	else if (charts)
+	{
+		demo_charts();
+	}
+	else if (dither>=0)
+	{
+		demo_dither(dither);
+	}
+	else if (graybits)
+	{
+		demo_gray(graybits);
+	}
 	// draw the two bitmaps, one after the other
-	for (i=0;i<10;i++)
+	else for (i=0;i<10;i++)
 	{
 		oled_draw(bitmap);
 		printf("%d\n",i);
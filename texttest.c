@@ -32,6 +32,14 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <unistd.h>
 #include <sys/types.h>
 #include <fcntl.h>
+#include <string.h>
+#include <time.h>
+#include "oledd.h"
+
+// the large fonts are made by fontc.c
+#include "fonts/segment16.h"
+#include "fonts/segment24.h"
+#include "fonts/segment32.h"
 
 #define	RETVAL_OK	0
 #define	RETVAL_NOK	-1
@@ -51,101 +59,34 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #define	SPI_LSBFIRST	0
 #define	SPI_MSBFIRST	1
-#define SPI_DELAY	//DELAY_US(1)
+#define SPI_DELAY	do {} while (0)	//DELAY_US(1)
+
+#define	WAVE_MOSI	0x00	// a step of a waveform: bit 1 is the pin, bit 0 the level
+#define	WAVE_SCLK	0x02
+#define	WAVE_MAXSTEPS	25	// 8 bits with 3 steps each, and the clock back to idle
+
+#define	TXN_COMMAND	0
+#define	TXN_DATA	1
+#define	TXN_MAXLEN	2048
+#define	TXN_MAXRUNS	64
+
+#define	OLED_COLUMN_OFFSET	2	// the SH1106 has 132 columns of RAM, the panel shows columns 2..129
 
 #define	BITMAP_HEIGHT	64
 #define	BITMAP_WIDTH	128
 
+#define	CANVAS_WIDTH	128
+#define	CANVAS_PAGES	8
+
+#define	TEXT_MAXSCALE	4	// a 4x glyph column is 32 bits, 4 pages
+
 
 //// depends on the development board
 
 // the way I understand this is, that the physical pins are mapped into
 // the system memory. to accces those, there is some sort of memory
 // offset maybe
-#if defined(PINOUT_JETSONNANO)
-#warning "This mapping is for the Jetson Nano board."
-// Jetson Nano
-// source: https://maker.pro/nvidia-jetson/tutorial/how-to-use-gpio-pins-on-jetson-nano-developer-kit
-const short physicalmapping[41]={
-	0,	// placeholder. there is no PIN0
-	 -1, -1,// PIN1 =3.3V DC, PIN2 =5V DC
-	 -1, -1,// 3,4
-	 -1, -1,// 5,6
-	216, -1, //PIN7 = AUDIO_MCLK
-	 -1, -1, //9,10
-	 50, 79, //PIN11=UART_2_RTS,PIN12=I2S_4_CLK
-	 14, -1, //13,14
-	194,232, //15,16
-	 -1, 15, //17,18
-	 16, -1, //19,20
-	 17, 13, //21,22
-	 18, 19, //23,24
-	 -1, 20, //25,26
-	 -1, -1, //27,28
-	149, -1, //29,30
-	200,168, //31,32
-	 38, -1, //33,34
-	 76, 51, //35,36
-	 12, 77, //37,38
-	 -1, 78  //39,40
-};
-#elif defined(PINOUT_BANANAPI)
-#warning "This mapping is for the Banana Pi board."
-// source: https://wiki.fw-web.de/doku.php?id=en:bpi-r64:gpio
-const short physicalmapping[41]={
-	0,	// placeholder. there is no PIN0
-	 -1, -1,// PIN1 =3.3V DC, PIN2 =5V DC
-	 56, -1,// 3,4
-	 55, -1,// 5,6
-	101, 59, //PIN7 = PWM7,8
-	 -1, 60,// 9,10
-	 51, -1, //PIN11=UART_2_RTS,PIN12=I2S_4_CLK
-	 52, -1, //13,14
-	 98, 61, //15,16
-	 -1, 62, //17,18
-	 68, -1, //19,20
-	 69, 63, //21,22
-	 67, 70, //23,24
-	 -1, 66, //25,26
-	 58, 57, //27,28
-	 85, -1, //29,30
-	 82, 64, //31,32
-	 -1, -1, //33,34
-	 -1, 65, //35,36
-	 86, -1, //37,38
-	 -1, -1  //39,40
-};
-#elif defined(PINOUT_RASPBERRYPI) 
-#warning "This mapping is for the Raspberry Pi (Zero) board"
-// source: https://www.theengineeringprojects.com/wp-content/uploads/2021/03/raspberry-pi-zero-5.png
-// NOTE: GPIO16 was actually missing in the diagram.
-const short physicalmapping[41]={
-	0,	// placeholder. there is no PIN0
-	 -1, -1,// PIN1 =3.3V DC, PIN2 =5V DC
-	  2, -1,// 3,4
-	  3, -1,// 5,6
-	  4, 14, //PIN7 = PWM7,8
-	 -1, 15,// 9,10
-	 17, 18, //PIN11=UART_2_RTS,PIN12=I2S_4_CLK
-	 27, -1, //13,14
-	 22, 23, //15,16
-	 -1, 24, //17,18
-	 10, -1, //19,20
-	  9, 25, //21,22
-	 11,  8, //23,24
-	 -1,  7, //25,26
-	  0,  1, //27,28
-	  5, -1, //29,30
-	  6, 12, //31,32
-	 13, -1, //33,34
-	 19, 16, //35,36	
-	 26, 20, //37,38
-	 -1, 21  //39,40
-};
-#else
-#error "The physical pins need to be mapped to the GPIO numbers. For some reason, those numbers are different for each board out there. So please have a look at the sourcecode, lines 21-26, and select the one that works best for you."
-const int physicalmapping[41]={0};
-#endif
+#include "boards.h"
 
 // this is the GPIO pinout for the waveshare OLED 1.3 SH1106 hat
 // source: https://www.waveshare.com/1.3inch-oled-hat.htm
@@ -254,10 +195,12 @@ int gpio_direction(int pin,int direction)
 	
 	return RETVAL_OK;
 }
+int wave_mosi=-1;		// the current level of MOSI, -1 when unknown
 int gpio_write(int pin,int value)
 {
 	int fd;
 	char buffer[MAXBUFLEN];
+	if (pin==PIN_MOSI) wave_mosi=-1;	// spi_writebuf() sets it again after its last write
 	snprintf(buffer,MAXBUFLEN,"/sys/class/gpio/gpio%d/value",pin);
 	fd=open(buffer,O_WRONLY);
 	if (fd<0)
@@ -299,6 +242,8 @@ int gpio_pins_up()
 	int retval;
 
 	retval=RETVAL_OK;
+	// the reset pin goes low, so the display forgets what a warm oledd left on it
+	unlink(OLEDD_STATE);
 	// start with the GPIO configuration
 	retval|=gpio_export(PIN_RST);	
 	retval|=gpio_export(PIN_DC);	
@@ -319,6 +264,7 @@ int gpio_pins_up()
 	retval|=gpio_direction(PIN_SCLK, GPIO_OUTPUT);
 	retval|=gpio_direction(PIN_MOSI, GPIO_OUTPUT);
 	retval|=gpio_direction(PIN_MISO, GPIO_INPUT);
+	wave_mosi=-1;
 
 	return retval;
 }
@@ -328,6 +274,7 @@ int gpio_pins_down()
 	int retval;
 
 	retval=RETVAL_OK;
+	unlink(OLEDD_STATE);
 	retval|=gpio_write(PIN_RST,0);
 	retval|=gpio_write(PIN_DC,0);
 	retval|=gpio_write(PIN_BL,0);
@@ -347,47 +294,206 @@ int gpio_pins_down()
 	return retval;
 }
 
-void spi_writebyte(unsigned char byte,int mode,int msbfirst)
+// the bit-banged SPI is table driven. for every mode and bit order, the
+// sequence of pin changes for each byte value is computed once. writes to
+// MOSI which would not change its level are left out. since that depends on
+// the last bit of the previous byte, there are two tables.
+typedef struct _tWaveform
+{
+	int valid;
+	int cpol0;				// the idle level of the clock
+	unsigned char num[2][256];		// [MOSI level before the byte][byte]
+	unsigned char steps[2][256][WAVE_MAXSTEPS];
+} tWaveform;
+tWaveform waveforms[4][2];
+
+tWaveform* wave_get(int mode,int msbfirst)
 {
-	int cpol;
-	int cpol0;
+	tWaveform* wave;
 	int cpha;
-	int bits;
+	int prev;
+	int byte;
 
+	mode&=3;
+	msbfirst=(msbfirst==SPI_MSBFIRST);
+	wave=&waveforms[mode][msbfirst];
+	if (wave->valid) return wave;
 	switch (mode)
 	{
-		case SPI_MODE0:	cpol=0;cpha=0;break;
-		case SPI_MODE1:	cpol=0;cpha=1;break;
-		case SPI_MODE2:	cpol=1;cpha=0;break;
-		case SPI_MODE3:	cpol=1;cpha=1;break;
+		default:
+		case SPI_MODE0:	wave->cpol0=0;cpha=0;break;
+		case SPI_MODE1:	wave->cpol0=0;cpha=1;break;
+		case SPI_MODE2:	wave->cpol0=1;cpha=0;break;
+		case SPI_MODE3:	wave->cpol0=1;cpha=1;break;
 	}
-	cpol0=cpol;
-	gpio_write(PIN_SCLK,cpol);
-	if (!cpha)
+	for (prev=0;prev<2;prev++)
 	{
-		cpol=1-cpol;	// when CPHA=1, the new value is being sampled at the first clock edge
-		SPI_DELAY;
+		for (byte=0;byte<256;byte++)
+		{
+			unsigned char* steps;
+			int num;
+			int mosi;
+			int cpol;
+			int bits;
+			int b;
+
+			steps=wave->steps[prev][byte];
+			num=0;
+			mosi=prev;
+			b=byte;
+			cpol=wave->cpol0;
+			if (!cpha) cpol=1-cpol;	// when CPHA=1, the new value is being sampled at the first clock edge
+			for (bits=0;bits<8;bits++)
+			{
+				int bit;
+				if (msbfirst)
+				{
+					bit=(b>>7)&1;
+					b<<=1;
+				} else {
+					bit=b&1;
+					b>>=1;
+				}
+				if (bit!=mosi) steps[num++]=WAVE_MOSI|bit;	// set the value
+				mosi=bit;
+				steps[num++]=WAVE_SCLK|cpol;	// 1st clock edge
+				cpol=1-cpol;
+				steps[num++]=WAVE_SCLK|cpol;	// 2nd clock edge
+				cpol=1-cpol;
+			}
+			if (cpha) steps[num++]=WAVE_SCLK|wave->cpol0;	// make sure that the SPI clk is the same as before. with CPHA=0, it already is.
+			wave->num[prev][byte]=num;
+		}
 	}
-	for (bits=0;bits<8;bits++)
+	wave->valid=1;
+	return wave;
+}
+
+// sends a buffer over the bit-banged SPI.
+void spi_writebuf(unsigned char* buf,int len,int mode,int msbfirst)
+{
+	tWaveform* wave;
+	int pins[2];
+	int mosi;
+	int i;
+
+	wave=wave_get(mode,msbfirst);
+	pins[0]=PIN_MOSI;
+	pins[1]=PIN_SCLK;
+	gpio_write(PIN_SCLK,wave->cpol0);
+	mosi=wave_mosi;
+	if (mosi<0)
 	{
-		int bit;
-		if (msbfirst==SPI_MSBFIRST)
+		mosi=0;
+		gpio_write(PIN_MOSI,mosi);
+	}
+	for (i=0;i<len;i++)
+	{
+		unsigned char* steps;
+		int num;
+		int j;
+		steps=wave->steps[mosi][buf[i]];
+		num=wave->num[mosi][buf[i]];
+		for (j=0;j<num;j++)
 		{
-			bit=(byte>>7)&1;
-			byte<<=1;
-		} else {
-			bit=(byte)&1;
-			byte>>=1;
+			gpio_write(pins[steps[j]>>1],steps[j]&1);
+			if (steps[j]&WAVE_SCLK) SPI_DELAY;
 		}
-		gpio_write(PIN_MOSI,bit);	// set the value	
-		gpio_write(PIN_SCLK,cpol);	// 1st clock edge
-		cpol=1-cpol;
-		SPI_DELAY;		
-		gpio_write(PIN_SCLK,cpol);	// 2nd clock edge
-		cpol=1-cpol;
-		SPI_DELAY;
+		mosi=(msbfirst==SPI_MSBFIRST)?(buf[i]&1):(buf[i]>>7);
 	}
-	gpio_write(PIN_SCLK,cpol0);		// make sure that the SPI clk is the same as before
+	wave_mosi=mosi;
+}
+void spi_writebyte(unsigned char byte,int mode,int msbfirst)
+{
+	spi_writebuf(&byte,1,mode,msbfirst);
+}
+
+// a transaction collects command and data bytes for the display in one buffer.
+// consecutive bytes of the same kind form a run, and the DC line only has to
+// be switched between runs. a whole frame is handed over with one call to
+// txn_submit().
+typedef struct _tTransaction
+{
+	int len;
+	int runs;
+	int runstart[TXN_MAXRUNS];
+	int rundc[TXN_MAXRUNS];		// level of the DC pin: TXN_COMMAND or TXN_DATA
+	unsigned char buf[TXN_MAXLEN];
+} tTransaction;
+
+void txn_init(tTransaction* txn)
+{
+	txn->len=0;
+	txn->runs=0;
+}
+int txn_append(tTransaction* txn,int dc,const unsigned char* bytes,int len)
+{
+	if (txn->runs==0 || txn->rundc[txn->runs-1]!=dc)
+	{
+		if (txn->runs==TXN_MAXRUNS)
+		{
+			fprintf(stderr,"Too many runs in transaction\n");
+			return RETVAL_NOK;
+		}
+		txn->runstart[txn->runs]=txn->len;
+		txn->rundc[txn->runs]=dc;
+		txn->runs++;
+	}
+	if (txn->len+len>TXN_MAXLEN)
+	{
+		fprintf(stderr,"Transaction buffer overflow\n");
+		return RETVAL_NOK;
+	}
+	if (len>0) memcpy(&txn->buf[txn->len],bytes,len);
+	txn->len+=len;
+	return RETVAL_OK;
+}
+// room for len bytes at the end of the transaction, for renderers which
+// write straight into the buffer instead of copying. NULL when it is full.
+unsigned char* txn_reserve(tTransaction* txn,int dc,int len)
+{
+	unsigned char* ptr;
+	if (txn->len+len>TXN_MAXLEN)
+	{
+		fprintf(stderr,"Transaction buffer overflow\n");
+		return NULL;
+	}
+	if (txn_append(txn,dc,NULL,0)!=RETVAL_OK) return NULL;
+	ptr=&txn->buf[txn->len];
+	txn->len+=len;
+	return ptr;
+}
+int txn_command(tTransaction* txn,unsigned char byte)
+{
+	return txn_append(txn,TXN_COMMAND,&byte,1);
+}
+int txn_data(tTransaction* txn,const unsigned char* bytes,int len)
+{
+	return txn_append(txn,TXN_DATA,bytes,len);
+}
+// all the SH1106 commands for addressing are one byte each.
+int txn_address(tTransaction* txn,int page,int column)
+{
+	int retval;
+	column+=OLED_COLUMN_OFFSET;
+	retval=RETVAL_OK;
+	retval|=txn_command(txn,0xb0+page);		// set page address
+	retval|=txn_command(txn,0x00|(column&0xf));	// set low column address
+	retval|=txn_command(txn,0x10|(column>>4));	// set high column address
+	return retval;
+}
+void txn_submit(tTransaction* txn)
+{
+	int i;
+	for (i=0;i<txn->runs;i++)
+	{
+		int end;
+		end=(i+1<txn->runs)?txn->runstart[i+1]:txn->len;
+		gpio_write(PIN_DC,txn->rundc[i]);
+		spi_writebuf(&txn->buf[txn->runstart[i]],end-txn->runstart[i],SPI_MODE0,SPI_MSBFIRST);
+	}
+	txn->len=0;
+	txn->runs=0;
 }
 void oled_reset()
 {
@@ -407,134 +513,492 @@ void oled_init()
 		0xda,0x12,0xdb,0x40, 0x20,0x02,0xa4,0xa6,	// set com pins hardare, ???, set vcomh, set vcom deselect level, set page addr mode, ???, disable entire display on, disable inverse display on, 
 		0xaf	// turn on oled panel
 	};
-	int i;
-	gpio_write(PIN_DC,0);			
-	for (i=0;i<sizeof(oled_commands);i++)
-	{
-		spi_writebyte(oled_commands[i],SPI_MODE0,SPI_MSBFIRST);	
-	}
+	tTransaction txn;
+	txn_init(&txn);
+	txn_append(&txn,TXN_COMMAND,oled_commands,sizeof(oled_commands));
+	txn_submit(&txn);
 }
 
+// the 8x8 font. one character is 8 columns, one byte each, the first column in the lowest byte.
+const unsigned long long font8x8[95]={
+	0x0000000000000000,//  
+	0x0000065f5f060000,// !
+	0x0000030300030300,// "
+	0x00147f7f147f7f14,// #
+	0x0000123a6b6b2e24,// $
+	0x0062660c18306646,// %
+	0x00487a375d4f7a30,// &
+	0x0000000000030704,// '
+	0x00000041633e1c00,// (
+	0x0000001c3e634100,// )
+	0x082a3e1c1c3e2a08,// *
+	0x000008083e3e0808,// +
+	0x0000000060e08000,// ,
+	0x0000080808080808,// -
+	0x0000000060600000,// .
+	0x000103060c183060,// /
+	0x003e7f4d59717f3e,// 0
+	0x000040407f7f4240,// 1
+	0x0000666f49597362,// 2
+	0x0000367f49496322,// 3
+	0x00507f7f53161c18,// 4
+	0x0000397d45456727,// 5
+	0x00003079494b7e3c,// 6
+	0x0000070f79710303,// 7
+	0x0000367f49497f36,// 8
+	0x00001e3f69494f06,// 9
+	0x0000000066660000,// :
+	0x0000000066e68000,// ;
+	0x0000004163361c08,// <
+	0x0000242424242424,// =
+	0x0000081c36634100,// >
+	0x0000060f59510302,// ?
+	0x001e1f5d5d417f3e,// @
+	0x00007c7e13137e7c,// A
+	0x00367f49497f7f41,// B
+	0x0022634141633e1c,// C
+	0x001c3e63417f7f41,// D
+	0x0063415d497f7f41,// E
+	0x0003011d497f7f41,// F
+	0x0072735141633e1c,// G
+	0x00007f7f08087f7f,// H
+	0x000000417f7f4100,// I
+	0x00013f7f41407030,// J
+	0x0063771c087f7f41,// K
+	0x00706040417f7f41,// L
+	0x007f7f0e1c0e7f7f,// M
+	0x007f7f180c067f7f,// N
+	0x001c3e6341633e1c,// O
+	0x00060f09497f7f41,// P
+	0x00005e7f71213f1e,// Q
+	0x00667f19097f7f41,// R
+	0x00003273594d6f26,// S
+	0x000003417f7f4103,// T
+	0x00007f7f40407f7f,// U
+	0x00001f3f60603f1f,// V
+	0x007f7f3018307f7f,// W
+	0x0043673c183c6743,// X
+	0x0000074f78784f07,// Y
+	0x0073674d59716347,// Z
+	0x00000041417f7f00,// [
+	0x006030180c060301,// 
+	0x0000007f7f414100,// ]
+	0x00080c0603060c08,// ^
+	0x8080808080808080,// _
+	0x0000000407030000,// `
+	0x0040783c54547420,// a
+	0x00307848483f7f41,// b
+	0x0000286c44447c38,// c
+	0x00407f3f49487830,// d
+	0x0000185c54547c38,// e
+	0x00000203497f7e48,// f
+	0x00047cf8a4a4bc98,// g
+	0x00787c04087f7f41,// h
+	0x000000407d7d4400,// i
+	0x00007dfd8080e060,// j
+	0x00446c38107f7f41,// k
+	0x000000407f7f4100,// l
+	0x00787c1c38187c7c,// m
+	0x0000787c04047c7c,// n
+	0x0000387c44447c38,// o
+	0x00183c24a4f8fc84,// p
+	0x0084fcf8a4243c18,// q
+	0x00181c044c787c44,// r
+	0x0000247454545c48,// s
+	0x000024447f3e0400,// t
+	0x00407c3c40407c3c,// u
+	0x00001c3c60603c1c,// v
+	0x003c7c7038707c3c,// w
+	0x00446c3810386c44,// x
+	0x00007cfca0a0bc9c,// y
+	0x0000644c5c74644c,// z
+	0x00004141773e0808,// {
+	0x0000007777000000,// |
+	0x000008083e774141,// }
+	0x0001030203010302,// ~
+};
+
 void oled_text(char *text,int line,int inverted)
 {
-	const unsigned long long font[95]={
-		0x0000000000000000,//  
-		0x0000065f5f060000,// !
-		0x0000030300030300,// "
-		0x00147f7f147f7f14,// #
-		0x0000123a6b6b2e24,// $
-		0x0062660c18306646,// %
-		0x00487a375d4f7a30,// &
-		0x0000000000030704,// '
-		0x00000041633e1c00,// (
-		0x0000001c3e634100,// )
-		0x082a3e1c1c3e2a08,// *
-		0x000008083e3e0808,// +
-		0x0000000060e08000,// ,
-		0x0000080808080808,// -
-		0x0000000060600000,// .
-		0x000103060c183060,// /
-		0x003e7f4d59717f3e,// 0
-		0x000040407f7f4240,// 1
-		0x0000666f49597362,// 2
-		0x0000367f49496322,// 3
-		0x00507f7f53161c18,// 4
-		0x0000397d45456727,// 5
-		0x00003079494b7e3c,// 6
-		0x0000070f79710303,// 7
-		0x0000367f49497f36,// 8
-		0x00001e3f69494f06,// 9
-		0x0000000066660000,// :
-		0x0000000066e68000,// ;
-		0x0000004163361c08,// <
-		0x0000242424242424,// =
-		0x0000081c36634100,// >
-		0x0000060f59510302,// ?
-		0x001e1f5d5d417f3e,// @
-		0x00007c7e13137e7c,// A
-		0x00367f49497f7f41,// B
-		0x0022634141633e1c,// C
-		0x001c3e63417f7f41,// D
-		0x0063415d497f7f41,// E
-		0x0003011d497f7f41,// F
-		0x0072735141633e1c,// G
-		0x00007f7f08087f7f,// H
-		0x000000417f7f4100,// I
-		0x00013f7f41407030,// J
-		0x0063771c087f7f41,// K
-		0x00706040417f7f41,// L
-		0x007f7f0e1c0e7f7f,// M
-		0x007f7f180c067f7f,// N
-		0x001c3e6341633e1c,// O
-		0x00060f09497f7f41,// P
-		0x00005e7f71213f1e,// Q
-		0x00667f19097f7f41,// R
-		0x00003273594d6f26,// S
-		0x000003417f7f4103,// T
-		0x00007f7f40407f7f,// U
-		0x00001f3f60603f1f,// V
-		0x007f7f3018307f7f,// W
-		0x0043673c183c6743,// X
-		0x0000074f78784f07,// Y
-		0x0073674d59716347,// Z
-		0x00000041417f7f00,// [
-		0x006030180c060301,// 
-		0x0000007f7f414100,// ]
-		0x00080c0603060c08,// ^
-		0x8080808080808080,// _
-		0x0000000407030000,// `
-		0x0040783c54547420,// a
-		0x00307848483f7f41,// b
-		0x0000286c44447c38,// c
-		0x00407f3f49487830,// d
-		0x0000185c54547c38,// e
-		0x00000203497f7e48,// f
-		0x00047cf8a4a4bc98,// g
-		0x00787c04087f7f41,// h
-		0x000000407d7d4400,// i
-		0x00007dfd8080e060,// j
-		0x00446c38107f7f41,// k
-		0x000000407f7f4100,// l
-		0x00787c1c38187c7c,// m
-		0x0000787c04047c7c,// n
-		0x0000387c44447c38,// o
-		0x00183c24a4f8fc84,// p
-		0x0084fcf8a4243c18,// q
-		0x00181c044c787c44,// r
-		0x0000247454545c48,// s
-		0x000024447f3e0400,// t
-		0x00407c3c40407c3c,// u
-		0x00001c3c60603c1c,// v
-		0x003c7c7038707c3c,// w
-		0x00446c3810386c44,// x
-		0x00007cfca0a0bc9c,// y
-		0x0000644c5c74644c,// z
-		0x00004141773e0808,// {
-		0x0000007777000000,// |
-		0x000008083e774141,// }
-		0x0001030203010302,// ~
-	};
 	#define	TEXT_WIDTH	16
 	#define	FONT_XRES	8
 	int i;
 	int j;
+	tTransaction txn;
 
-	gpio_write(PIN_DC,0);			// write command
-	spi_writebyte(0xb0+line,SPI_MODE0,SPI_MSBFIRST);	// set page address
-	spi_writebyte(0x02,SPI_MODE0,SPI_MSBFIRST);	// set low column address
-	spi_writebyte(0x10,SPI_MODE0,SPI_MSBFIRST);	// set high column address
-	gpio_write(PIN_DC,1);			// write data
-	
+	txn_init(&txn);
+	txn_address(&txn,line,0);
 	for (i=0;i<TEXT_WIDTH;i++)
 	{
 		unsigned long long x;
-		x=font[text[i]-' '];
+		unsigned char column[FONT_XRES];
+		x=font8x8[text[i]-' '];
 		if (inverted) x=~x;
 		for (j=0;j<FONT_XRES;j++)
 		{
-			spi_writebyte(x&0xff,SPI_MODE0,SPI_MSBFIRST);
+			column[j]=x&0xff;
 			x>>=8;
 		}
+		txn_data(&txn,column,FONT_XRES);
+	}
+	txn_submit(&txn);
+}
+
+// the fonts from fontc are already in the page format. a glyph is its pages,
+// one after the other, so drawing text means copying bytes. characters
+// which are not in the font are skipped.
+const tGlyph* font_glyph(const tFont* font,int c)
+{
+	if (c<font->first || c>font->last) return NULL;
+	if (font->glyphs[c-font->first].width==0) return NULL;
+	return &font->glyphs[c-font->first];
+}
+int font_width(const tFont* font,const char* text)
+{
+	int width;
+	width=0;
+	for (;*text;text++)
+	{
+		const tGlyph* glyph;
+		glyph=font_glyph(font,(unsigned char)*text);
+		if (glyph!=NULL) width+=glyph->width;
+	}
+	return width;
+}
+// straight into the transmit buffer, for text starting at a page: one run of data per page.
+int font_txn(tTransaction* txn,const tFont* font,int page,int column,const char* text)
+{
+	int retval;
+	int p;
+	if (page<0 || column<0 || column>=CANVAS_WIDTH)
+	{
+		fprintf(stderr,"text has to start on the display, not on page %d, column %d\n",page,column);
+		return RETVAL_NOK;
+	}
+	retval=RETVAL_OK;
+	for (p=0;p<font->pages && page+p<CANVAS_PAGES;p++)
+	{
+		const char* ptr;
+		int x;
+		retval|=txn_address(txn,page+p,column);
+		x=column;
+		for (ptr=text;*ptr && x<CANVAS_WIDTH;ptr++)
+		{
+			const tGlyph* glyph;
+			int width;
+			glyph=font_glyph(font,(unsigned char)*ptr);
+			if (glyph==NULL) continue;
+			width=glyph->width;
+			if (x+width>CANVAS_WIDTH) width=CANVAS_WIDTH-x;
+			retval|=txn_data(txn,&font->bitmaps[glyph->offset+p*glyph->width],width);
+			x+=width;
+		}
+	}
+	return retval;
+}
+// into a canvas, at any pixel position. when y is not at the start of a
+// page, every byte is split between two pages. returns the width.
+int font_blit(unsigned char* canvas,const tFont* font,int x,int y,const char* text)
+{
+	int shift;
+	int page0;
+	int start;
+	start=x;
+	shift=y&7;		// also correct for negative y
+	page0=(y-shift)/8;
+	for (;*text;text++)
+	{
+		const tGlyph* glyph;
+		int p;
+		glyph=font_glyph(font,(unsigned char)*text);
+		if (glyph==NULL) continue;
+		for (p=0;p<font->pages;p++)
+		{
+			const unsigned char* src;
+			int page;
+			int i;
+			src=&font->bitmaps[glyph->offset+p*glyph->width];
+			page=page0+p;
+			for (i=0;i<glyph->width;i++)
+			{
+				if (x+i<0 || x+i>=CANVAS_WIDTH) continue;
+				if (page>=0 && page<CANVAS_PAGES) canvas[page*CANVAS_WIDTH+x+i]|=src[i]<<shift;
+				if (shift && page+1>=0 && page+1<CANVAS_PAGES) canvas[(page+1)*CANVAS_WIDTH+x+i]|=src[i]>>(8-shift);
+			}
+		}
+		x+=glyph->width;
+	}
+	return x-start;
+}
+// the 8x8 font, 2, 3 or 4 times as large. every bit of a glyph column
+// becomes scale bits, which is one lookup per column: text_spread[scale][byte]
+// holds the column for all the pages, and page p is byte p of it. those bytes
+// are then written scale times, straight into the transmit buffer.
+static unsigned int text_spread[TEXT_MAXSCALE+1][256];
+static int text_spread_ready=0;
+void text_spread_init()
+{
+	int scale;
+	int byte;
+	int bit;
+	for (scale=1;scale<=TEXT_MAXSCALE;scale++)
+	{
+		for (byte=0;byte<256;byte++)
+		{
+			unsigned int spread;
+			spread=0;
+			for (bit=0;bit<8;bit++)
+			{
+				if (byte&(1<<bit)) spread|=((1u<<scale)-1)<<(bit*scale);
+			}
+			text_spread[scale][byte]=spread;
+		}
+	}
+	text_spread_ready=1;
+}
+// one run of data for each of the scale pages. characters outside the font are blanks.
+int text_scaled_txn(tTransaction* txn,const char* text,int page,int column,int scale,int inverted)
+{
+	int retval;
+	int len;
+	int p;
+	if (scale<1 || scale>TEXT_MAXSCALE)
+	{
+		fprintf(stderr,"text can be scaled 1 to %d times, not %d\n",TEXT_MAXSCALE,scale);
+		return RETVAL_NOK;
+	}
+	if (page<0 || column<0)
+	{
+		fprintf(stderr,"text has to start on the display, not on page %d, column %d\n",page,column);
+		return RETVAL_NOK;
+	}
+	if (!text_spread_ready) text_spread_init();
+	retval=RETVAL_OK;
+	len=strlen(text)*8*scale;
+	if (column+len>CANVAS_WIDTH) len=CANVAS_WIDTH-column;
+	if (len<=0) return retval;
+	for (p=0;p<scale && page+p<CANVAS_PAGES;p++)
+	{
+		const unsigned int* spread;
+		const char* ptr;
+		unsigned char* dst;
+		int x;
+		retval|=txn_address(txn,page+p,column);
+		dst=txn_reserve(txn,TXN_DATA,len);
+		if (dst==NULL) return RETVAL_NOK;
+		spread=text_spread[scale];
+		x=0;
+		for (ptr=text;x<len;ptr++)
+		{
+			unsigned long long glyph;
+			int c;
+			int j;
+			c=(unsigned char)*ptr;
+			glyph=(c>=' ' && c<' '+95)?font8x8[c-' ']:0;
+			if (inverted) glyph=~glyph;
+			for (j=0;j<8 && x<len;j++)
+			{
+				unsigned char b;
+				int k;
+				b=spread[glyph&0xff]>>(p*8);
+				glyph>>=8;
+				for (k=0;k<scale && x<len;k++) dst[x++]=b;
+			}
+		}
+	}
+	return retval;
+}
+// the same, pixel by pixel into a canvas. only there to check the tables.
+void text_scaled_naive(unsigned char* canvas,const char* text,int page,int column,int scale,int inverted)
+{
+	int width;
+	int x,y;
+	width=strlen(text)*8*scale;
+	for (y=0;y<8*scale && page*8+y<CANVAS_PAGES*8;y++)
+	{
+		for (x=0;x<width && column+x<CANVAS_WIDTH;x++)
+		{
+			unsigned long long glyph;
+			unsigned char* dst;
+			int pixel;
+			int c;
+			c=(unsigned char)text[x/(8*scale)];
+			glyph=(c>=' ' && c<' '+95)?font8x8[c-' ']:0;
+			pixel=(glyph>>(((x/scale)%8)*8+y/scale))&1;
+			if (inverted) pixel=!pixel;
+			dst=&canvas[(page+y/8)*CANVAS_WIDTH+column+x];
+			if (pixel) *dst|=(1<<(y&7));
+			else *dst&=~(1<<(y&7));
+		}
+	}
+}
+// what a transaction leaves in the memory of the display
+void txn_canvas(const tTransaction* txn,unsigned char* canvas)
+{
+	int page;
+	int column;
+	int i;
+	page=column=0;
+	for (i=0;i<txn->runs;i++)
+	{
+		int end;
+		int j;
+		end=(i+1<txn->runs)?txn->runstart[i+1]:txn->len;
+		for (j=txn->runstart[i];j<end;j++)
+		{
+			unsigned char b;
+			b=txn->buf[j];
+			if (txn->rundc[i]==TXN_DATA)
+			{
+				int x;
+				x=column-OLED_COLUMN_OFFSET;
+				if (page<CANVAS_PAGES && x>=0 && x<CANVAS_WIDTH) canvas[page*CANVAS_WIDTH+x]=b;
+				column++;
+			}
+			else if ((b&0xf0)==0xb0) page=b&0x0f;
+			else if ((b&0xf0)==0x00) column=(column&0xf0)|(b&0x0f);
+			else if ((b&0xf0)==0x10) column=(column&0x0f)|((b&0x0f)<<4);
+		}
+	}
+}
+double timestamp()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return ts.tv_sec+ts.tv_nsec*1e-9;
+}
+// checks the scaled text against the pixel by pixel version, on the edges of
+// the display as well, and compares the cost of each scale with 1x.
+int bench_scaled()
+{
+	#define	BENCH_SCALED_LINES	100000
+	const char* texts[4]={"Hello","12:34","~{|}",""};
+	const int positions[5][2]={{0,0},{1,5},{5,100},{7,120},{3,127}};	// page, column
+	unsigned char expected[CANVAS_WIDTH*CANVAS_PAGES];
+	unsigned char shown[CANVAS_WIDTH*CANVAS_PAGES];
+	char line[CANVAS_WIDTH/8+1];
+	tTransaction txn;
+	double t0,t1,t2;
+	double onex;
+	int rejected;
+	int retval;
+	int scale;
+	int i;
+
+	retval=RETVAL_OK;
+	onex=0;
+	for (scale=1;scale<=TEXT_MAXSCALE;scale++)
+	{
+		int ok;
+		int len;
+		ok=1;
+		for (i=0;i<4*5*2;i++)
+		{
+			const char* text;
+			int page,column,inverted;
+			text=texts[i%4];
+			page=positions[(i/4)%5][0];
+			column=positions[(i/4)%5][1];
+			inverted=i/20;
+			memset(expected,0x5a,sizeof(expected));
+			memset(shown,0x5a,sizeof(shown));
+			text_scaled_naive(expected,text,page,column,scale,inverted);
+			txn_init(&txn);
+			if (text_scaled_txn(&txn,text,page,column,scale,inverted)!=RETVAL_OK) ok=0;
+			txn_canvas(&txn,shown);
+			if (memcmp(expected,shown,sizeof(shown))) ok=0;
+		}
+		if (!ok) retval=RETVAL_NOK;
+
+		// a line as wide as the display
+		len=CANVAS_WIDTH/8/scale;
+		for (i=0;i<len;i++) line[i]='A'+i;
+		line[len]=0;
+		t0=timestamp();
+		for (i=0;i<BENCH_SCALED_LINES;i++)
+		{
+			txn_init(&txn);
+			text_scaled_txn(&txn,line,0,0,scale,i&1);
+		}
+		t1=timestamp();
+		for (i=0;i<BENCH_SCALED_LINES/100;i++)
+		{
+			text_scaled_naive(shown,line,0,0,scale,i&1);
+		}
+		t2=timestamp();
+		if (scale==1) onex=t1-t0;
+		printf("%dx: %4d bytes, %6.3f us per line, %4.1f times 1x   pixel by pixel: %7.3f us   %s\n",
+			scale,txn.len,(t1-t0)*1e6/BENCH_SCALED_LINES,(t1-t0)/onex,(t2-t1)*1e6/(BENCH_SCALED_LINES/100),ok?"ok":"MISMATCH");
+	}
+	// text which starts before the display is not drawn
+	txn_init(&txn);
+	rejected=(text_scaled_txn(&txn,"x",-1,0,2,0)!=RETVAL_OK && text_scaled_txn(&txn,"x",0,-8,2,0)!=RETVAL_OK && txn.len==0);
+	// the same for the fonts from fontc
+	rejected&=(font_txn(&txn,&segment16,-1,0,"1")!=RETVAL_OK && font_txn(&txn,&segment16,0,-8,"1")!=RETVAL_OK
+		&& font_txn(&txn,&segment16,0,CANVAS_WIDTH,"1")!=RETVAL_OK && txn.len==0);
+	if (!rejected) retval=RETVAL_NOK;
+	printf("text off the display rejected: %s\n",rejected?"yes":"NO");
+	return retval;
+}
+// a counter at 4x and a clock at 3x. at the end, it prints how long the
+// rendering took, next to the same text at 1x.
+void demo_scaled()
+{
+	struct timespec t0,t1;
+	tTransaction txn;
+	char text[32];
+	double scaledns,smallns;
+	int i;
+	scaledns=smallns=0;
+	for (i=0;i<1000;i++)
+	{
+		txn_init(&txn);
+		clock_gettime(CLOCK_MONOTONIC,&t0);
+		snprintf(text,sizeof(text),"%4d",i);
+		text_scaled_txn(&txn,text,0,0,4,0);
+		snprintf(text,sizeof(text),"%02d:%02d",(i/60)%60,i%60);
+		text_scaled_txn(&txn,text,4,4,3,0);
+		clock_gettime(CLOCK_MONOTONIC,&t1);
+		scaledns+=(t1.tv_sec-t0.tv_sec)*1e9+(t1.tv_nsec-t0.tv_nsec);
+
+		// the same text, unscaled, to compare
+		clock_gettime(CLOCK_MONOTONIC,&t0);
+		snprintf(text,sizeof(text),"%4d%02d:%02d",i,(i/60)%60,i%60);
+		text_scaled_txn(&txn,text,7,0,1,0);
+		clock_gettime(CLOCK_MONOTONIC,&t1);
+		smallns+=(t1.tv_sec-t0.tv_sec)*1e9+(t1.tv_nsec-t0.tv_nsec);
+		txn_submit(&txn);
+	}
+	printf("rendering: %.2f us per frame at 4x and 3x (%d bytes), %.2f us at 1x (72 bytes)\n",scaledns/i/1000,4*128+3*120,smallns/i/1000);
+}
+// a large counter in the upper half, sent directly from the font. in the
+// lower half, a clock which moves up and down, drawn into a canvas.
+void demo_numbers()
+{
+	unsigned char canvas[CANVAS_WIDTH*CANVAS_PAGES];
+	char text[32];
+	tTransaction txn;
+	int column;
+	int i;
+	int page;
+	for (i=0;i<1000;i++)
+	{
+		txn_init(&txn);
+		snprintf(text,sizeof(text),"%6.1f",i/10.0);
+		// right aligned. when it is too wide, the end is cut off instead
+		column=CANVAS_WIDTH-font_width(&segment32,text);
+		if (column<0) column=0;
+		font_txn(&txn,&segment32,0,column,text);
+
+		memset(canvas,0,sizeof(canvas));
+		snprintf(text,sizeof(text),"%02d:%02d",(i/60)%60,i%60);
+		font_blit(canvas,&segment24,(CANVAS_WIDTH-font_width(&segment24,text))/2,32+abs((i%14)-7),text);
+		for (page=4;page<CANVAS_PAGES;page++)
+		{
+			txn_address(&txn,page,0);
+			txn_data(&txn,&canvas[page*CANVAS_WIDTH],CANVAS_WIDTH);
+		}
+		txn_submit(&txn);
 	}
 }
 
@@ -574,6 +1038,45 @@ int main(int argc,char** argv)
 {
 	int i;
 	char buf[16];
+	int opt;
+	int numbers;
+	int scaled;
+	int bench;
+
+	numbers=0;
+	scaled=0;
+	bench=0;
+	if (BOARD_DEFAULT>=0) board_select(boards[BOARD_DEFAULT].name);
+	while ((opt=getopt(argc,argv,"nsw:b"))!=-1)
+	{
+		switch (opt)
+		{
+			case 'n':	numbers=1;break;
+			case 's':	scaled=1;break;
+			case 'b':	bench=1;break;
+			case 'w':
+				if (board_select(optarg)<0)
+				{
+					fprintf(stderr,"unknown board %s\n",optarg);
+					return 1;
+				}
+				break;
+			default:
+				fprintf(stderr,"usage: %s [-n] [-s] [-w board] [-b]\n",argv[0]);
+				fprintf(stderr,"  -n          show large numbers, with the fonts from fontc\n");
+				fprintf(stderr,"  -s          show the 8x8 font scaled up 3 and 4 times\n");
+				fprintf(stderr,"  -w board    %s, instead of the one from the sourcecode\n",BOARD_NAMES);
+				fprintf(stderr,"  -b          check the scaled text against a pixel by pixel version, and\n");
+				fprintf(stderr,"              compare the cost with 1x (does not need the display)\n");
+				return 1;
+		}
+	}
+	if (bench) return bench_scaled()?1:0;
+	if (physicalmapping==NULL)
+	{
+		fprintf(stderr,BOARD_MISSING,"-w");
+		return 1;
+	}
 	
 	signal(SIGINT, graceFulExit);
 	if (sh1106_up())
@@ -581,6 +1084,14 @@ int main(int argc,char** argv)
 		fprintf(stderr,"unable to start up display. sorry");
 		return 1;
 	}
+	if (numbers || scaled)
+	{
+		if (numbers) demo_numbers();
+		else demo_scaled();
+		printf("press Enter to quit\n");
+		fgets(buf,sizeof(buf),stdin);	
+		graceFulExit(0);
+	}
 
 	oled_text("----------------",0,0);
 	oled_text("-     HELL0    -",1,0);